@@ -22,391 +22,714 @@ Author: Matthew Amy
 #include "circuit.h"
 #include <algorithm>
 #include <sstream>
+#include <iterator>
+#include <cerrno>
+#include <cstring>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <unordered_map>
 
 //----------------------------------------- DOTQC stuff
 
-void ignore_white(istream& in) {
-  while (in.peek() == ' ' || in.peek() == ';') in.ignore();
+// Blanks separate tokens; a line break ends the line
+bool is_blank(char c) {
+  return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
 }
 
-void dotqc::input(istream& in) {
-  string buf, tmp;
-  list<string> namelist;
-  n = 0;
+// Open addressing hash table from qubit names to their indices in names
+class name_table {
+  public:
+    name_table(const vector<string>& names) : names(names), slots(64, -1) {}
 
-  // Inputs
-  while (buf != ".v") in >> buf;
-  ignore_white(in);
-  while(in.peek() != '\n' && in.peek() != '\r') {
-    in >> buf;
-    names.push_back(buf);
-    zero[buf] = 1;
-    ignore_white(in);
-  }
+    // Index of the name [s, s + len), or -1
+    int find(const char* s, int len) const {
+      for (size_t i = hash(s, len) & (slots.size() - 1); slots[i] != -1; i = (i + 1) & (slots.size() - 1)) {
+        const string& name = names[slots[i]];
+        if (name.size() == (size_t)len && memcmp(name.data(), s, len) == 0) return slots[i];
+      }
+      return -1;
+    }
 
-  // Primary inputs
-  while (buf != ".i") in >> buf;
-  ignore_white(in);
-  while (in.peek() != '\n' && in.peek() != '\r') {
-    n++;
-    in >> buf;
-    zero[buf] = 0;
-    ignore_white(in);
-  }
+    // Add names[index], keeping the table at most half full
+    void insert(int index) {
+      if (2 * (size_t)(index + 1) > slots.size()) {
+        slots.assign(2 * slots.size(), -1);
+        for (int i = 0; i < index; i++) place(i);
+      }
+      place(index);
+    }
 
-  m = names.size() - n;
+  private:
+    const vector<string>& names;
+    vector<int> slots;
+
+    static size_t hash(const char* s, int len) {
+      size_t h = 14695981039346656037ULL;   // FNV-1a
+      for (int i = 0; i < len; i++) h = (h ^ (unsigned char)s[i]) * 1099511628211ULL;
+      return h;
+    }
 
-  // Circuit
-  while (buf != "BEGIN") in >> buf;
-  in >> tmp;
-  while (tmp != "END") {
-    namelist.clear();
-    // Build up a list of the applied qubits
-    ignore_white(in);
-    while (in.peek() != '\n' && in.peek() != '\r' && in.peek() != ';') {
-      in >> buf;
-      int pos = buf.find(';');
-      if (pos != string::npos) {
-        for (int i = buf.length() - 1; i > pos; i--) {
-          in.putback(buf[i]);
+    void place(int index) {
+      size_t i = hash(names[index].data(), names[index].size()) & (slots.size() - 1);
+      while (slots[i] != -1) i = (i + 1) & (slots.size() - 1);
+      slots[i] = index;
+    }
+};
+
+// Get the next token of the line [p, eol), stopping at stop characters.
+//   Returns the length of the token, 0 at the end of the line or at a stop character
+int next_token(const char*& p, const char* eol, const char*& tok, bool stop_at_semicolon) {
+  while (p < eol && (is_blank(*p) || (*p == ';' && !stop_at_semicolon))) p++;
+  tok = p;
+  while (p < eol && !is_blank(*p) && *p != ';') p++;
+  return p - tok;
+}
+
+// Reject a gate on the wrong number of qubits: T, T*, P, P*, Y and H act on
+//   one qubit, Z and Z* on one to three, X and tof on any non-zero number.
+//   Only Z and Z* may repeat a qubit: they stay diagonal (Z a b a is Z a b),
+//   while tof a a would XOR a wire into itself
+void check_operands(int line, gate_type type, const vector<int>& qubits, const vector<string>& names) {
+  bool diagonal = type == GATE_Z || type == GATE_ZDAG;
+  size_t most = 1;
+  if (diagonal) most = 3;
+  else if (type == GATE_X || type == GATE_TOF) most = qubits.size();
+
+  string gate = "gate \"" + string(gate_name(type)) + "\"";
+  if (qubits.empty()) throw qc_error(line, gate + " has no qubits");
+  if (qubits.size() > most) {
+    throw qc_error(line, gate + (most == 1 ? " takes 1 qubit" : " takes at most " + to_string(most) + " qubits") +
+                         ", got " + to_string(qubits.size()));
+  }
+  for (size_t i = 1; i < qubits.size() && !diagonal; i++) {
+    if (find(qubits.begin(), qubits.begin() + i, qubits[i]) != qubits.begin() + i) {
+      throw qc_error(line, gate + " uses qubit \"" + names[qubits[i]] + "\" twice");
+    }
+  }
+}
+
+void dotqc::input(const char* buf, size_t len) {
+  const char* p = buf;
+  const char* end = buf + len;
+  const char* eol;
+  const char* tok;
+  int tok_len, line = 0;
+  bool begin = false, done = false, have_names = false;
+  name_table name_map(names);
+  int q;
+  string key;
+  vector<int> qubits;
+  gate_type type;
+
+  clear();
+  for (; p < end && !done; p = eol + 1) {
+    line++;
+    eol = (const char*)memchr(p, '\n', end - p);
+    if (eol == NULL) eol = end;
+
+    tok_len = next_token(p, eol, tok, false);
+    if (tok_len == 0 || *tok == '#') continue;
+
+    if (!begin) {
+      // Header: .v lists the qubits, .i the ones not initialized to |0>
+      key.assign(tok, tok_len);
+      if (key == ".v") {
+        have_names = true;
+        while ((tok_len = next_token(p, eol, tok, false)) > 0) {
+          key.assign(tok, tok_len);
+          if (name_map.find(tok, tok_len) != -1) throw qc_error(line, "duplicate qubit \"" + key + "\"");
+          names.push_back(key);
+          zero.push_back(1);
+          name_map.insert(names.size() - 1);
+        }
+      } else if (key == ".i") {
+        while ((tok_len = next_token(p, eol, tok, false)) > 0) {
+          q = name_map.find(tok, tok_len);
+          if (q == -1) throw qc_error(line, "no such qubit \"" + string(tok, tok_len) + "\"");
+          zero[q] = 0;
         }
-        in.putback('\n');
-        buf.erase(pos, buf.length() - pos);
+      } else if (key == "BEGIN") {
+        if (!have_names) throw qc_error(line, "missing .v line");
+        begin = true;
+      }
+      continue;
+    }
+
+    // Circuit: gates separated by line breaks or ';'
+    p = tok;
+    while (!done && p < eol) {
+      if (*p == ';') {
+        p++;
+        continue;
       }
-      if (find(names.begin(), names.end(), buf) == names.end()) {
-        cout << "ERROR: no such qubit \"" << buf << "\"\n" << flush;
-        exit(1);
+      tok_len = next_token(p, eol, tok, true);
+      if (tok_len == 0) continue;
+      if (tok_len == 3 && memcmp(tok, "END", 3) == 0) {
+        done = true;
+      } else if (!find_gate(tok, tok_len, type)) {
+        throw qc_error(line, "no such gate \"" + string(tok, tok_len) + "\"");
       } else {
-        namelist.push_back(buf);
+        qubits.clear();
+        while ((tok_len = next_token(p, eol, tok, true)) > 0) {
+          q = name_map.find(tok, tok_len);
+          if (q == -1) throw qc_error(line, "no such qubit \"" + string(tok, tok_len) + "\"");
+          qubits.push_back(q);
+        }
+        check_operands(line, type, qubits, names);
+        circ.push_back(gate(type, qubits));
       }
-      ignore_white(in);
     }
-    if (tmp == "TOF") tmp = "tof";
-    circ.push_back(make_pair(tmp, namelist));
-    in >> tmp;
   }
+
+  if (!begin) throw qc_error(line, "missing BEGIN");
+  if (!done) throw qc_error(line, "missing END");
+
+  n = 0;
+  for (size_t i = 0; i < zero.size(); i++) {
+    if (!zero[i]) n++;
+  }
+  m = names.size() - n;
 }
 
-void dotqc::output(ostream& out) {
-  list<string>::iterator name_it;
-  gatelist::iterator it;
-  list<string>::iterator ti;
+void dotqc::input(istream& in) {
+  string buf((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+  input(buf.data(), buf.size());
+}
+
+void dotqc::input(int fd) {
+  struct stat st;
+
+  // Regular files are mapped, anything else (pipes, terminals) is read into memory
+  if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+    void* buf = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (buf != MAP_FAILED) {
+      try {
+        input((const char*)buf, st.st_size);
+      } catch (...) {
+        munmap(buf, st.st_size);
+        throw;
+      }
+      munmap(buf, st.st_size);
+      return;
+    }
+  }
+
+  vector<char> buf;
+  char chunk[1 << 16];
+  ssize_t count;
+  while ((count = read(fd, chunk, sizeof(chunk))) != 0) {
+    if (count < 0) {
+      if (errno == EINTR) continue;
+      throw runtime_error("cannot read input: " + string(strerror(errno)));
+    }
+    buf.insert(buf.end(), chunk, chunk + count);
+  }
+  input(buf.data(), buf.size());
+}
+
+void qc_writer::write(const char* s, size_t len) {
+  if (len > buf.size() - used) {
+    flush();
+    if (len > buf.size()) {
+      out.write(s, len);
+      return;
+    }
+  }
+  memcpy(&buf[used], s, len);
+  used += len;
+}
+
+qc_writer& qc_writer::operator<<(long v) {
+  char digits[24];
+  char* p = digits + sizeof(digits);
+  unsigned long u = (v < 0) ? -(unsigned long)v : v;
+
+  do {
+    *--p = '0' + u % 10;
+    u /= 10;
+  } while (u != 0);
+  if (v < 0) *--p = '-';
+  write(p, digits + sizeof(digits) - p);
+  return *this;
+}
+
+void qc_writer::flush() {
+  if (used > 0) out.write(&buf[0], used);
+  used = 0;
+}
+
+void dotqc::output_header(qc_writer& out) const {
+  size_t i;
 
   // Inputs
   out << ".v";
-  for (name_it = names.begin(); name_it != names.end(); name_it++) {
-    out << " " << *name_it;
+  for (i = 0; i < names.size(); i++) {
+    out << ' ' << names[i];
   }
 
   // Primary inputs
   out << "\n.i";
-  for (name_it = names.begin(); name_it != names.end(); name_it++) {
-    if (zero[*name_it] == 0) out << " " << *name_it;
+  for (i = 0; i < names.size(); i++) {
+    if (zero[i] == 0) out << ' ' << names[i];
   }
 
   // Outputs
   out << "\n.o";
-  for (name_it = names.begin(); name_it != names.end(); name_it++) {
-    out << " " << *name_it;
+  for (i = 0; i < names.size(); i++) {
+    out << ' ' << names[i];
   }
 
-  // Circuit
   out << "\n\nBEGIN\n";
-  for (it = circ.begin(); it != circ.end(); it++) {
-    out << it->first;
-    for (ti = (it->second).begin(); ti != (it->second).end(); ti++) {
-      out << " " << *ti;
-    }
-    out << "\n";
-  }
-  out << "END\n";
 }
 
-int max_depth(map<string, int> & depths, list<string> & names) {
-  list<string>::const_iterator it;
-  int max = 0;
+void dotqc::output_gates(qc_writer& out, const gatelist& gates) const {
+  gatelist::const_iterator it;
+  const int* ti;
 
-  for (it = names.begin(); it != names.end(); it++) {
-    if (depths[*it] > max) max = depths[*it];
-  }
-
-  return max;
-}
-
-// Compute T-depth
-int dotqc::count_t_depth() {
-  gatelist::reverse_iterator it;
-  list<string>::const_iterator ti;
-  map<string, int> current_t_depth;
-
-  for (ti = names.begin(); ti != names.end(); ti++) {
-    current_t_depth[*ti] = 0;
-  }
-
-  for (it = circ.rbegin(); it != circ.rend(); it++) {
-    int d = max_depth(current_t_depth, it->second);
-    if ((it->first == "T") || (it->first == "T*")) {
-      d = d + 1;
-    } else if ((it->first == "Z") && (it->second.size() >= 3)) {
-      d = d + 3;
-    }
-    for (ti = it->second.begin(); ti != it->second.end(); ti++) {
-      current_t_depth[*ti] = d;
+  for (it = gates.begin(); it != gates.end(); it++) {
+    out << gate_name(it->type);
+    for (ti = it->begin(); ti != it->end(); ti++) {
+      out << ' ' << names[*ti];
     }
+    out << '\n';
   }
+}
 
-  return max_depth(current_t_depth, names);
+void dotqc::output(qc_writer& out) {
+  output_header(out);
+  output_gates(out, circ);
+  out << "END\n";
 }
 
-int dotqc::count_depth() {
-  gatelist::reverse_iterator it;
-  list<string>::const_iterator ti;
-  map<string, int> current_depth;
-  int d;
+void dotqc::output(ostream& out) {
+  qc_writer writer(out);
+  output(writer);
+}
 
-  for (ti = names.begin(); ti != names.end(); ti++) {
-    current_depth[*ti] = 0;
-  }
+void qc_stream::begin(const dotqc& circuit) {
+  header.n = circuit.n;
+  header.m = circuit.m;
+  header.names = circuit.names;
+  header.zero = circuit.zero;
+  header.output_header(out);
+}
 
-  for (it = circ.rbegin(); it != circ.rend(); it++) {
-    d = max_depth(current_depth, it->second);
-    if ((it->first == "Z") && (it->second.size() >= 3)) {
-      d = d + 9;
-    } else {
-      d = d + 1;
-    }
-    for (ti = it->second.begin(); ti != it->second.end(); ti++) {
-      current_depth[*ti] = d;
-    }
-  }
+void qc_stream::emit(const gatelist& gates) {
+  header.output_gates(out, gates);
+  count += gates.size();
+}
 
-  return max_depth(current_depth, names);
+void qc_stream::end() {
+  out << "END\n";
 }
 
-// Gather statistics and print
-void dotqc::print_stats() {
-  int H = 0;
-  int cnot = 0;
-  int X = 0;
-  int T = 0;
-  int P = 0;
-  int Z = 0;
-  int tdepth = 0;
+// Gather all statistics in one pass. Depths are the lengths of the critical
+//   paths through the circuit, tracked per qubit. A Toffoli phase (Z a b c)
+//   counts as its T-depth 3 decomposition: 7 T gates in layers of 3, 3 and 1,
+//   7 CNOTs with CNOT-depth 6, and depth 9
+qc_stats dotqc::stats() const {
+  qc_stats ret;
+  int d, td, cd;
+  const int* it;
   bool tlayer = false;
-  gatelist::iterator ti;
-  set<string> qubits;
-  list<string>::iterator it;
+  vector<int> depth(names.size(), 0), t_depth(names.size(), 0), cnot_depth(names.size(), 0);
+  vector<bool> qubits(names.size(), false);
+
+  ret.qubits = names.size();
+
+  for (size_t i = 0; i < circ.size(); i++) {
+    const gate & g = circ[i];
+    bool t = g.type == GATE_T || g.type == GATE_TDAG;
+    bool ccz = g.type == GATE_Z && g.size() == 3;
+    bool cnot = g.type == GATE_TOF && g.size() == 2;
+
+    ret.gates += ccz ? 14 : 1;
+    d = td = cd = 0;
+    for (it = g.begin(); it != g.end(); it++) {
+      if (!qubits[*it]) {
+        qubits[*it] = true;
+        ret.used++;
+      }
+      d = max(d, depth[*it]);
+      td = max(td, t_depth[*it]);
+      cd = max(cd, cnot_depth[*it]);
+    }
 
-  for (ti = circ.begin(); ti != circ.end(); ti++) {
-    for (it = ti->second.begin(); it != ti->second.end(); it++) qubits.insert(*it);
-    if (ti->first == "T" || ti->first == "T*") {
-      T++;
+    if (t) {
+      ret.T++;
       if (!tlayer) {
         tlayer = true;
-        tdepth++;
+        ret.tdepth_partitions++;
       }
-    } else if (ti->first == "P" || ti->first == "P*") P++;
-    else if (ti->first == "Z" && ti->second.size() == 3) {
-      tdepth += 3;
-      T += 7;
-      cnot += 7;
-    } else if (ti->first == "Z") Z++;
+    } else if (g.type == GATE_P || g.type == GATE_PDAG) ret.P++;
+    else if (ccz) {
+      ret.tdepth_partitions += 3;
+      ret.T += 7;
+      ret.cnot += 7;
+    } else if (g.type == GATE_Z) ret.Z++;
     else {
-      if (ti->first == "tof" && ti->second.size() == 2) cnot++;
-      else if (ti->first == "tof" || ti->first == "X") X++;
-      else if (ti->first == "H") H++;
+      if (cnot) ret.cnot++;
+      else if (g.type == GATE_TOF || g.type == GATE_X) ret.X++;
+      else if (g.type == GATE_H) ret.H++;
 
       if (tlayer) tlayer = false;
     }
+
+    // T-layers this gate falls into
+    if (t) {
+      if (ret.t_layers.size() <= (size_t)td) ret.t_layers.resize(td + 1, 0);
+      ret.t_layers[td]++;
+    } else if (ccz) {
+      if (ret.t_layers.size() <= (size_t)td + 2) ret.t_layers.resize(td + 3, 0);
+      ret.t_layers[td] += 3;
+      ret.t_layers[td + 1] += 3;
+      ret.t_layers[td + 2] += 1;
+    }
+
+    d += ccz ? 9 : 1;
+    td += ccz ? 3 : (t ? 1 : 0);
+    cd += ccz ? 6 : (cnot ? 1 : 0);
+    for (it = g.begin(); it != g.end(); it++) {
+      depth[*it] = d;
+      t_depth[*it] = td;
+      cnot_depth[*it] = cd;
+    }
+    ret.depth = max(ret.depth, d);
+    ret.tdepth = max(ret.tdepth, td);
+    ret.cnot_depth = max(ret.cnot_depth, cd);
   }
 
-  cout << "#   qubits: " << names.size() << "\n";
-  cout << "#   qubits used: " << qubits.size() << "\n";
-  cout << "#   H: " << H << "\n";
-  cout << "#   cnot: " << cnot << "\n";
-  cout << "#   X: " << X << "\n";
-  cout << "#   T: " << T << "\n";
-  cout << "#   P: " << P << "\n";
-  cout << "#   Z: " << Z << "\n";
-  cout << "#   tdepth (by partitions): " << tdepth << "\n";
-  cout << "#   depth  (by critical paths): " << count_depth() << "\n";
-  cout << "#   tdepth (by critical paths): " << count_t_depth() << "\n";
+  return ret;
+}
+
+void qc_stats::print(ostream& out) const {
+  out << "#   qubits: " << qubits << "\n";
+  out << "#   qubits used: " << used << "\n";
+  out << "#   H: " << H << "\n";
+  out << "#   cnot: " << cnot << "\n";
+  out << "#   X: " << X << "\n";
+  out << "#   T: " << T << "\n";
+  out << "#   P: " << P << "\n";
+  out << "#   Z: " << Z << "\n";
+  out << "#   tdepth (by partitions): " << tdepth_partitions << "\n";
+  out << "#   depth  (by critical paths): " << depth << "\n";
+  out << "#   tdepth (by critical paths): " << tdepth << "\n";
+}
+
+void qc_stats::print_json(ostream& out) const {
+  out << "{\"qubits\": " << qubits << ", \"qubits_used\": " << used;
+  out << ", \"gates\": " << gates << ", \"H\": " << H << ", \"cnot\": " << cnot;
+  out << ", \"X\": " << X << ", \"T\": " << T << ", \"P\": " << P << ", \"Z\": " << Z;
+  out << ", \"tdepth_partitions\": " << tdepth_partitions << ", \"depth\": " << depth;
+  out << ", \"tdepth\": " << tdepth << ", \"cnot_depth\": " << cnot_depth;
+  out << ", \"t_layers\": [";
+  for (size_t i = 0; i < t_layers.size(); i++) out << (i ? ", " : "") << t_layers[i];
+  out << "]}";
+}
 
+// Print the statistics in the .qc comment format
+void dotqc::print_stats() {
+  stats().print(cout);
 }
 
 // Count the Hadamard gates
 int count_h(dotqc & qc) {
   int ret = 0;
-  list<pair<string,list<string> > >::iterator it;
+  gatelist::iterator it;
 
   for (it = qc.circ.begin(); it != qc.circ.end(); it++) {
-    if (it->first == "H") ret++;
+    if (it->type == GATE_H) ret++;
   }
 
   return ret;
 }
 
-bool find_name(const list<string> & names, const string & name) {
-  list<string>::const_iterator it;
-  for (it = names.begin(); it != names.end(); it++) {
-    if (*it == name) return true;
-  }
-  return false;
-}
+// Qubit indices sorted by name
+vector<int> order_by_name(const vector<string> & names) {
+  vector<int> ret(names.size());
 
-void dotqc::append(pair<string, list<string> > gate) {
-  circ.push_back(gate);
+  for (size_t i = 0; i < names.size(); i++) ret[i] = i;
+  sort(ret.begin(), ret.end(), [&names](int a, int b) { return names[a] < names[b]; });
 
-  for (list<string>::iterator it = gate.second.begin(); it != gate.second.end(); it++) {
-    if (!find_name(names, *it)) names.push_back(*it);
-  }
+  return ret;
 }
 
-// Optimizations
-void dotqc::remove_swaps() {
-  gatelist::iterator it, tt, ttt;
-  list<string>::iterator iti;
-  map<string, string>::iterator pit;
-  string q1, q2, q1_map, q2_map, tmp;
-  bool flg, found_q1, found_q2;
-  int i;
-  map<string, string> perm;
+bool is_cnot(const gate & g) {
+  return g.type == GATE_TOF && g.size() == 2;
+}
 
-  for (it = circ.begin(), i = 0; i < (circ.size() - 3);) {
-    flg = false;
-    if (it->first == "tof" && it->second.size() == 2) {
-      iti = it->second.begin();
-      q1 = *(iti++);
-      q2 = *iti;
-
-      tt = it;
-      tt++;
-      ttt = tt;
-      ttt++;
-      if (tt->first == "tof" && tt->second.size() == 2 && ttt->first == "tof" && ttt->second.size() == 2) {
-        flg = true;
-        iti = tt->second.begin();
-        flg &= *(iti++) == q2;
-        flg &= *(iti) == q1;
-        iti = ttt->second.begin();
-        flg &= *(iti++) == q1;
-        flg &= *(iti) == q2;
-
-        if (flg) {
-          circ.erase(it);
-          circ.erase(tt);
-          it = circ.erase(ttt);
-          found_q1 = found_q2 = false;
-          q1_map = (perm.find(q2) != perm.end()) ? perm[q2] : q2;
-          q2_map = (perm.find(q1) != perm.end()) ? perm[q1] : q1;
-          perm[q1] = q1_map;
-          perm[q2] = q2_map;
-        }
-      }
-    }
-    if (!flg) {
-      // Apply permutation
-      for (iti = it->second.begin(); iti != it->second.end(); iti++) {
-        if (perm.find(*iti) != perm.end()) *iti = perm[*iti];
-      }
+// Optimizations
+// Remove CNOT triples that swap two qubits by relabelling the gates after
+//   them. If outputs is given, it receives the qubit each output ends up on
+//   and the circuit is left permuted; otherwise swaps are added at the end
+//   to put every output back in place
+void dotqc::remove_swaps(vector<int>* outputs) {
+  int num = circ.size(), i, j, q1, q2;
+  vector<int> perm(names.size());
+  int* iti;
+
+  for (size_t p = 0; p < perm.size(); p++) perm[p] = p;
+
+  // j is where the next kept gate goes
+  for (i = 0, j = 0; num - i > 3;) {
+    const gate & g1 = circ[i], & g2 = circ[i + 1], & g3 = circ[i + 2];
+    if (is_cnot(g1) && is_cnot(g2) && is_cnot(g3) &&
+        g2[0] == g1[1] && g2[1] == g1[0] && g3[0] == g1[0] && g3[1] == g1[1]) {
+      q1 = g1[0];
+      q2 = g1[1];
+      i += 3;
+      swap(perm[q1], perm[q2]);
+    } else {
+      for (iti = circ[i].begin(); iti != circ[i].end(); iti++) *iti = perm[*iti];
+      if (i != j) circ[j] = std::move(circ[i]);
       i++;
-      it++;
+      j++;
     }
   }
-  for (; i < circ.size(); i++) {
-    for (iti = it->second.begin(); iti != it->second.end(); iti++) {
-      if (perm.find(*iti) != perm.end()) *iti = perm[*iti];
-    }
-    it++;
+  for (; i < num; i++, j++) {
+    for (iti = circ[i].begin(); iti != circ[i].end(); iti++) *iti = perm[*iti];
+    if (i != j) circ[j] = std::move(circ[i]);
   }
+  circ.erase(circ.begin() + j, circ.end());
 
-  // fix outputs
-  while(!perm.empty()) {
-    pit = perm.begin();
-    if (pit->first == pit->second) perm.erase(pit);
-    else {
-      list<string> tmp_list1, tmp_list2;
-      q1 = pit->second;
-      q2 = perm[pit->second];
-      tmp_list1.push_back(q1);
-      tmp_list1.push_back(q2);
-      tmp_list2.push_back(q2);
-      tmp_list2.push_back(q1);
-      circ.push_back(make_pair("tof", tmp_list1));
-      circ.push_back(make_pair("tof", tmp_list2));
-      circ.push_back(make_pair("tof", tmp_list1));
-
-      pit->second = q2;
+  if (outputs != NULL) {
+    *outputs = std::move(perm);
+    return;
+  }
+
+  // fix outputs, qubits in the order of their names
+  vector<int> order = order_by_name(names);
+  for (size_t p = 0; p < order.size(); p++) {
+    int q = order[p];
+    while (perm[q] != q) {
+      q1 = perm[q];
+      q2 = perm[q1];
+      circ.push_back(gate(GATE_TOF, q1, q2));
+      circ.push_back(gate(GATE_TOF, q2, q1));
+      circ.push_back(gate(GATE_TOF, q1, q2));
+
+      perm[q] = q2;
       perm[q1] = q1;
     }
   }
 }
 
-int list_compare(const list<string> & a, const list<string> & b) {
-  list<string>::const_iterator it, ti;
-  bool disjoint = true, equal = true, elt, strongelt;
-  int i = a.size(), j = b.size();
-
-  for (it = a.begin(), i = 0; i < a.size(); i++, it++) {
-    elt = false;
-    strongelt = false;
-    for (ti = b.begin(), j = 0; j < b.size(); j++, ti++) {
-      if (*it == *ti) {
-        elt = true;
-        disjoint = false;
-        if (i == j) {
-          strongelt = true;
-        }
-      }
+bool is_inverse(gate_type a, gate_type b) {
+  switch (a) {
+    case GATE_TOF:
+    case GATE_Z:
+    case GATE_H:
+      return b == a;
+    case GATE_P:
+      return b == GATE_PDAG;
+    case GATE_PDAG:
+      return b == GATE_P;
+    case GATE_T:
+      return b == GATE_TDAG;
+    case GATE_TDAG:
+      return b == GATE_T;
+    default:
+      return false;
+  }
+}
+
+// Cancel adjacent inverse gates in one pass. A gate cancels with the gate
+//   before it on its qubits if that gate acts on exactly the same qubits
+//   and is its inverse. Removing the pair joins the gates around it, so
+//   cancellations cascade
+void dotqc::remove_ids() {
+  gate_dag dag(*this);
+  int num = dag.nodes.size(), j, k, p;
+  bool cancel;
+
+  for (j = 0; j < num; j++) {
+    const gate & g = dag.nodes[j];
+    p = (g.size() > 0) ? dag.prev[dag.offset[j]] : gate_dag::none;
+    cancel = (p != gate_dag::none) && (dag.nodes[p].size() == g.size()) &&
+             is_inverse(dag.nodes[p].type, g.type);
+    for (k = 0; cancel && k < g.size(); k++) {
+      cancel = (dag.nodes[p][k] == g[k]) && (dag.prev[dag.offset[j] + k] == p);
+    }
+
+    if (cancel) {
+      dag.remove(j);
+      dag.remove(p);
     }
-    if (!strongelt) equal = false;
   }
 
-  if (equal) return 3;
-  else if (!disjoint) return 2;
-  else return 1;
+  dag.to_dotqc(*this);
 }
 
-void dotqc::remove_ids() {
-  gatelist::iterator it, ti;
-  bool mod = true, flg = true;
-  int i;
-  map<string, string> ids;
-
-  ids["tof"] = "tof";
-  ids["Z"] = "Z";
-  ids["H"] = "H";
-  ids["P"] = "P*";
-  ids["P*"] = "P";
-  ids["T"] = "T*";
-  ids["T*"] = "T";
-
-  while (mod) {
-    mod = false;
-    for (it = circ.begin(); it != circ.end(); it++) {
-      flg = false;
-      ti = it;
-      ti++;
-      for (; ti != circ.end() && !flg; ti++) {
-        i = list_compare(it->second, ti->second);
-        switch (i) {
-          case 3:
-            if (ids[it->first] == ti->first) {
-              ti = circ.erase(ti);
-              it = circ.erase(it);
-              mod = true;
-            }
-            flg = true;
-            break;
-          case 2:
-            flg = true;
-            break;
-          default:
-            break;
+// Gates applying a phase of w^angle to a qubit
+void phase_gates(gatelist & acc, int angle, int q) {
+  if (angle <= 4) {
+    if (angle / 4 == 1) acc.push_back(gate(GATE_Z, q));
+    if (angle / 2 == 1) acc.push_back(gate(GATE_P, q));
+    if (angle % 2 == 1) acc.push_back(gate(GATE_T, q));
+  } else {
+    if (angle == 5 || angle == 6) acc.push_back(gate(GATE_PDAG, q));
+    if (angle % 2 == 1) acc.push_back(gate(GATE_TDAG, q));
+  }
+}
+
+int phase_angle(const gate & g) {
+  switch (g.type) {
+    case GATE_T:    return 1;
+    case GATE_TDAG: return 7;
+    case GATE_P:    return 2;
+    case GATE_PDAG: return 6;
+    default:        return 4;
+  }
+}
+
+// What a gate does to the parities on the wires
+enum fold_kind {
+  FOLD_PHASE,     // rotation of a single qubit
+  FOLD_CNOT,
+  FOLD_NOT,       // X, or Y which is a Z followed by an X
+  FOLD_DIAGONAL,  // controlled Z, leaves the wires alone
+  FOLD_TARGET,    // H or Toffoli, gives its target a new variable
+  FOLD_OPAQUE     // anything else, gives every qubit a new variable
+};
+
+fold_kind fold_kind_of(const gate & g) {
+  if (g.size() == 1) {
+    switch (g.type) {
+      case GATE_T: case GATE_TDAG: case GATE_P: case GATE_PDAG: case GATE_Z: case GATE_ZDAG:
+        return FOLD_PHASE;
+      case GATE_X: case GATE_Y: case GATE_TOF:
+        return FOLD_NOT;
+      case GATE_H:
+        return FOLD_TARGET;
+      default:
+        return FOLD_OPAQUE;
+    }
+  }
+  if (g.type == GATE_TOF) return (g.size() == 2) ? FOLD_CNOT : FOLD_TARGET;
+  if (g.type == GATE_Z || g.type == GATE_ZDAG) return FOLD_DIAGONAL;
+  return FOLD_OPAQUE;
+}
+
+// Hash of the variables in a parity
+struct parity_hash {
+  size_t operator()(const vector<int> & vars) const {
+    size_t ret = 2166136261u;
+    for (size_t i = 0; i < vars.size(); i++) ret = (ret ^ vars[i]) * 16777619u;
+    return ret;
+  }
+};
+
+// Phase folding: track the parity of the values on each wire, merge all
+//   phase rotations applied to the same parity into the first of them and
+//   drop the rest. Toffoli phases (Z a b c) are expanded with a fixed CNOT
+//   network first; Hadamards and Toffolis give their target a new variable.
+//   Nothing else is resynthesized, so the pass is linear in the circuit
+void dotqc::fold_phases() {
+  gatelist lin;
+  int vars = 0, k, q, t;
+  size_t i, b;
+  fold_kind kind;
+
+  // Expand Toffoli phases and count the variables
+  lin.reserve(circ.size());
+  for (i = 0; i < names.size(); i++) {
+    if (!zero[i]) vars++;
+  }
+  for (i = 0; i < circ.size(); i++) {
+    const gate & g = circ[i];
+    if ((g.type == GATE_Z || g.type == GATE_ZDAG) && g.size() == 3) {
+      int a = g[0], b = g[1], c = g[2];
+      lin.push_back(gate(GATE_T, a));
+      lin.push_back(gate(GATE_T, b));
+      lin.push_back(gate(GATE_T, c));
+      lin.push_back(gate(GATE_TOF, a, b));
+      lin.push_back(gate(GATE_TDAG, b));      // a + b
+      lin.push_back(gate(GATE_TOF, b, c));
+      lin.push_back(gate(GATE_T, c));         // a + b + c
+      lin.push_back(gate(GATE_TOF, a, c));
+      lin.push_back(gate(GATE_TDAG, c));      // b + c
+      lin.push_back(gate(GATE_TOF, b, c));
+      lin.push_back(gate(GATE_TDAG, c));      // a + c
+      lin.push_back(gate(GATE_TOF, a, c));
+      lin.push_back(gate(GATE_TOF, a, b));
+    } else {
+      kind = fold_kind_of(g);
+      if (kind == FOLD_TARGET) vars++;
+      else if (kind == FOLD_OPAQUE) vars += g.size();
+      lin.push_back(std::move(circ[i]));
+    }
+  }
+
+  // Find the parity of every rotation. Angles are kept for the parity itself,
+  //   a rotation on its negation adding the opposite angle and a global phase
+  vector<xor_func> wires(names.size(), xor_func(vars + 1, 0));
+  unordered_map<vector<int>, int, parity_hash> classes;
+  vector<int> cls(lin.size(), -1);      // class of each rotation, -1 if dropped
+  vector<char> first(lin.size(), 0);    // 1 for the first rotation of a class,
+                                        //   2 if it was applied to the negation
+  vector<int> angle;
+  vector<int> key;
+  int global_phase = 0, v = 0;
+
+  for (i = 0; i < names.size(); i++) {
+    if (!zero[i]) wires[i].set(v++);
+  }
+  for (i = 0; i < lin.size(); i++) {
+    const gate & g = lin[i];
+    kind = fold_kind_of(g);
+    if (kind == FOLD_PHASE) {
+      const xor_func & f = wires[g[0]];
+      int a = phase_angle(g);
+      bool neg = f.test(vars);
+
+      if (neg) global_phase += a;
+      key.clear();
+      for (b = f.find_first(); b != xor_func::npos && b < (size_t)vars; b = f.find_next(b)) key.push_back(b);
+      if (key.empty()) continue;
+
+      auto res = classes.insert(make_pair(key, (int)angle.size()));
+      if (res.second) {
+        angle.push_back(0);
+        first[i] = neg ? 2 : 1;
+      }
+      cls[i] = res.first->second;
+      angle[cls[i]] = (angle[cls[i]] + (neg ? 8 - a : a)) % 8;
+    } else if (kind == FOLD_CNOT) {
+      wires[g[1]] ^= wires[g[0]];
+    } else if (kind == FOLD_NOT) {
+      wires[g[0]].flip(vars);
+    } else if (kind == FOLD_TARGET) {
+      t = g[g.size() - 1];
+      wires[t].reset();
+      wires[t].set(v++);
+    } else if (kind == FOLD_OPAQUE) {
+      for (k = 0; k < g.size(); k++) {
+        wires[g[k]].reset();
+        wires[g[k]].set(v++);
+      }
+    }
+  }
+
+  // Emit the merged rotations where their parity first appeared
+  circ.clear();
+  circ.reserve(lin.size());
+  for (i = 0; i < lin.size(); i++) {
+    if (fold_kind_of(lin[i]) != FOLD_PHASE) {
+      circ.push_back(std::move(lin[i]));
+    } else if (first[i] != 0) {
+      q = lin[i][0];
+      t = angle[cls[i]];
+      if (t != 0) {
+        if (first[i] == 2) {
+          global_phase += t;
+          t = (8 - t) % 8;
         }
+        phase_gates(circ, t, q);
       }
     }
   }
+  append(circ, global_phase_synth(names.size(), global_phase % 8));
 }
 
 //-------------------------------------- End of DOTQC stuff
@@ -458,17 +781,64 @@ void character::output(ostream& out) {
   }
 }
 
-int insert_phase (unsigned char c, xor_func f, vector<exponent> & phases) {
+// Output iterator mixing the blocks of a bitset into a hash (FNV-1a over
+//   whole blocks)
+struct block_hash {
+  size_t* h;
+
+  block_hash(size_t* h) : h(h) {}
+  block_hash& operator=(xor_func::block_type b) { *h = (*h ^ b) * 1099511628211ull; return *this; }
+  block_hash& operator*() { return *this; }
+  block_hash& operator++() { return *this; }
+  block_hash& operator++(int) { return *this; }
+};
+
+size_t hash_parity(const xor_func & f) {
+  size_t ret = 14695981039346656037ull;
+  to_block_range(f, block_hash(&ret));
+  return ret ^ (ret >> 32);
+}
+
+int phase_table::find_or_add(const xor_func& f, vector<exponent>& phases) {
+  size_t hash = hash_parity(f), mask;
   int i;
 
-  for (i = 0; i < phases.size(); i++) {
-    if (phases[i].second == f) {
-      phases[i].first = (phases[i].first + c) % 8;
-      return i;
-    }
+  if (2 * (size_t)(count + 1) > slots.size()) grow();
+  mask = slots.size() - 1;
+  for (i = hash & mask; slots[i] != -1; i = (i + 1) & mask) {
+    if (hashes[i] == hash && phases[slots[i]].second == f) return slots[i];
+  }
+
+  slots[i] = phases.size();
+  hashes[i] = hash;
+  count++;
+  phases.push_back(make_pair(0, f));
+  return slots[i];
+}
+
+// Double the table, or start it, and reinsert what is already there
+void phase_table::grow() {
+  vector<int> old_slots;
+  vector<size_t> old_hashes;
+  size_t mask, j;
+
+  old_slots.swap(slots);
+  old_hashes.swap(hashes);
+  slots.assign(max((size_t)16, 2 * old_slots.size()), -1);
+  hashes.resize(slots.size());
+  mask = slots.size() - 1;
+  for (size_t i = 0; i < old_slots.size(); i++) {
+    if (old_slots[i] == -1) continue;
+    for (j = old_hashes[i] & mask; slots[j] != -1; j = (j + 1) & mask);
+    slots[j] = old_slots[i];
+    hashes[j] = old_hashes[i];
   }
+}
+
+int insert_phase(unsigned char c, const xor_func & f, vector<exponent> & phases, phase_table & index) {
+  int i = index.find_or_add(f, phases);
 
-  phases.push_back(make_pair(c, xor_func(f)));
+  phases[i].first = (phases[i].first + c) % 8;
   return i;
 }
 
@@ -481,32 +851,33 @@ void character::parse_circuit(dotqc & input) {
   h = count_h(input);
 
   hadamards.clear();
-  map<string, int> name_map, gate_lookup;
-  gate_lookup["T"] = 1;
-  gate_lookup["T*"] = 7;
-  gate_lookup["P"] = 2;
-  gate_lookup["P*"] = 6;
-  gate_lookup["Z"] = 4;
-  gate_lookup["Y"] = 4;
+  snapshots.clear();
+  phase_h.clear();
+  map<gate_type, int> gate_lookup;
+  gate_lookup[GATE_T] = 1;
+  gate_lookup[GATE_TDAG] = 7;
+  gate_lookup[GATE_P] = 2;
+  gate_lookup[GATE_PDAG] = 6;
+  gate_lookup[GATE_Z] = 4;
+  gate_lookup[GATE_Y] = 4;
 
   // Initialize names and wires
   names = vector<string>(n + m + h);
   zero  = vector<bool>  (n + m);
   auto wires = vector<xor_func>(n+m);
-  for (list<string>::iterator it = input.names.begin(); it != input.names.end(); it++) {
-    // name_map maps a name to a wire
-    name_map[*it] = name_max;
+  auto saved = vector<xor_func>(n+m);   // wires while the rank is taken in place
+  // Qubits of the input are wires in the same order
+  for (name_max = 0; name_max < (int)input.names.size(); name_max++) {
     // names maps a wire to a name
-    names[name_max] = *it;
+    names[name_max] = input.names[name_max];
     // zero mapping
-    zero[name_max]  = input.zero[*it];
+    zero[name_max]  = input.zero[name_max];
     // each wire has an initial value j, unless it starts in the 0 state
     wires[name_max] = xor_func(n + h + 1, 0);
     if (!zero[name_max]) {
       wires[name_max].set(val_max);
       val_map[val_max++] = name_max;
     }
-    name_max++;
   }
 
   bool flg;
@@ -514,32 +885,31 @@ void character::parse_circuit(dotqc & input) {
   gatelist::iterator it;
   for (it = input.circ.begin(); it != input.circ.end(); it++) {
     flg = false;
-    if (it->first == "tof" && it->second.size() == 2) {
-      wires[name_map[*(++(it->second.begin()))]] ^= wires[name_map[*(it->second.begin())]];
-    } else if ((it->first == "tof" || it->first == "X") && it->second.size() == 1) {
-      wires[name_map[*(it->second.begin())]].flip(n + h);
-    } else if (it->first == "Y" && it->second.size() == 1) {
-      a = name_map[*(it->second.begin())];
-      insert_phase(gate_lookup[it->first], wires[a], phase_expts);
-      wires[name_map[*(it->second.begin())]].flip(n + h);
-    } else if (it->first == "T" || it->first == "T*" ||
-        it->first == "P" || it->first == "P*" ||
-        (it->first == "Z" && it->second.size() == 1)) {
-      a = name_map[*(it->second.begin())];
-      insert_phase(gate_lookup[it->first], wires[a], phase_expts);
-    } else if (it->first == "Z" && it->second.size() == 3) {
-      list<string>::iterator tmp_it = it->second.begin();
-      a = name_map[*(tmp_it++)];
-      b = name_map[*(tmp_it++)];
-      c = name_map[*tmp_it];
-      insert_phase(1, wires[a], phase_expts);
-      insert_phase(1, wires[b], phase_expts);
-      insert_phase(1, wires[c], phase_expts);
-      insert_phase(7, wires[a] ^ wires[b], phase_expts);
-      insert_phase(7, wires[a] ^ wires[c], phase_expts);
-      insert_phase(7, wires[b] ^ wires[c], phase_expts);
-      insert_phase(1, wires[a] ^ wires[b] ^ wires[c], phase_expts);
-    } else if (it->first == "H") {
+    if (it->type == GATE_TOF && it->size() == 2) {
+      wires[(*it)[1]] ^= wires[(*it)[0]];
+    } else if ((it->type == GATE_TOF || it->type == GATE_X) && it->size() == 1) {
+      wires[(*it)[0]].flip(n + h);
+    } else if (it->type == GATE_Y && it->size() == 1) {
+      a = (*it)[0];
+      insert_phase(gate_lookup[it->type], wires[a], phase_expts, phase_index);
+      wires[a].flip(n + h);
+    } else if (it->type == GATE_T || it->type == GATE_TDAG ||
+        it->type == GATE_P || it->type == GATE_PDAG ||
+        (it->type == GATE_Z && it->size() == 1)) {
+      a = (*it)[0];
+      insert_phase(gate_lookup[it->type], wires[a], phase_expts, phase_index);
+    } else if (it->type == GATE_Z && it->size() == 3) {
+      a = (*it)[0];
+      b = (*it)[1];
+      c = (*it)[2];
+      insert_phase(1, wires[a], phase_expts, phase_index);
+      insert_phase(1, wires[b], phase_expts, phase_index);
+      insert_phase(1, wires[c], phase_expts, phase_index);
+      insert_phase(7, wires[a] ^ wires[b], phase_expts, phase_index);
+      insert_phase(7, wires[a] ^ wires[c], phase_expts, phase_index);
+      insert_phase(7, wires[b] ^ wires[c], phase_expts, phase_index);
+      insert_phase(1, wires[a] ^ wires[b] ^ wires[c], phase_expts, phase_index);
+    } else if (it->type == GATE_H) {
       // This WILL confuse you later on you idiot
       //   You zero the "destroyed" qubit, compute the rank, then replace the
       //   value with each of the phase exponents to see if the rank increases
@@ -548,25 +918,28 @@ void character::parse_circuit(dotqc & input) {
       //   rank, then adding each phase exponent and checking the rank you do it
       //   in place
       Hadamard new_h;
-      new_h.qubit = name_map[*(it->second.begin())];
+      new_h.qubit = (*it)[0];
       new_h.prep  = val_max++;
-      new_h.wires = vector<xor_func>(n + m);
+      new_h.snapshot = snapshots.push(wires);
       for (int i = 0; i < n + m; i++) {
-        new_h.wires[i] = wires[i];
+        saved[i] = wires[i];
       }
 
-      // Check previous exponents to see if they're inconsistent
+      // Check previous exponents to see if they're inconsistent. Once an
+      //   exponent has to be applied before some hadamard it is gone by the
+      //   later ones, so only the first is recorded
       wires[new_h.qubit].reset();
       compute_rank_dest(n + m, n + h, wires);
+      phase_h.resize(phase_expts.size(), -1);
       for (int i = 0; i < phase_expts.size(); i++) {
-        if (phase_expts[i].first != 0) {
-          if (is_indep(n + h, wires, phase_expts[i].second)) new_h.in.insert(i);
+        if (phase_expts[i].first != 0 && phase_h[i] == -1) {
+          if (is_indep(n + h, wires, phase_expts[i].second)) phase_h[i] = hadamards.size();
         }
       }
 
       // Reset the current wire values
       for (int i = 0; i < n + m; i++) {
-        wires[i] = new_h.wires[i];
+        wires[i] = saved[i];
       }
       /*
       wires[new_h.qubit].reset();
@@ -574,7 +947,7 @@ void character::parse_circuit(dotqc & input) {
       for (int i = 0; i < phase_expts.size(); i++) {
         if (phase_expts[i].first != 0) {
           wires[new_h.qubit] = phase_expts[i].second;
-          if (compute_rank(n + m, n + h, wires) > rank) new_h.in.insert(i);
+          if (compute_rank(n + m, n + h, wires) > rank) phase_h[i] = hadamards.size();
         }
       }
       */
@@ -594,8 +967,11 @@ void character::parse_circuit(dotqc & input) {
     } else {
       cout << "ERROR: not a {H, CNOT, X, Y, Z, P, T} circuit\n";
       phase_expts.clear();
+      phase_index.clear();
+      phase_h.clear();
     }
   }
+  phase_h.resize(phase_expts.size(), -1);
   //Outputs are all wires until ancilla are added
   outputs = std::move(wires);
 }
@@ -610,13 +986,10 @@ void character::add_ancillae(int num) {
   auto new_zero    = vector<bool>(num_qubits);
   auto new_out = vector<xor_func>(num_qubits);
 
-  for (list<Hadamard>::iterator it = hadamards.begin(); it != hadamards.end(); it++) {
-    vector<xor_func> new_wires(num_qubits);
-    for (i = 0; i < num_qubits; i++) {
-      if (i < (n + m)) new_wires[i] = it->wires[i];
-      else new_wires[i] = xor_func(n + h + 1, 0);
-    }
-    it->wires = std::move(new_wires);
+  // Ancillae from earlier calls keep their names
+  int anc = 0;
+  for (i = 0; i < (n + m); i++) {
+    if (names[i].compare(0, 5, "__anc") == 0) anc++;
   }
 
   cout << "num bits: " << num_qubits  << endl;
@@ -627,7 +1000,7 @@ void character::add_ancillae(int num) {
       new_out[i]   = outputs[i];
     } else {
       ss.str("");
-      ss << "__anc" << i - (n + m);
+      ss << "__anc" << anc + i - (n + m);
       new_names[i] = ss.str();
       new_zero[i] = true;
       new_out[i] = xor_func(n + h + 1, 0);
@@ -642,34 +1015,76 @@ void character::add_ancillae(int num) {
 
 void character::remove_x() {
   int i, ind;
-  list<Hadamard>::iterator it;
 
   for (i = 0; i < phase_expts.size(); i++) {
     if (phase_expts[i].second.test(n + h)) {
       xor_func tmp = phase_expts[i].second;
       tmp.reset(n + h);
-      insert_phase(phase_expts[i].first, xor_func(n + h + 1, 0), phase_expts);
-      ind = insert_phase((phase_expts[i].first*7) % 8, tmp, phase_expts);
-      for (it = hadamards.begin(); it != hadamards.end(); it++) {
-	      if (it->in.find(i) != it->in.end()) it->in.insert(ind);
+      insert_phase(phase_expts[i].first, xor_func(n + h + 1, 0), phase_expts, phase_index);
+      ind = insert_phase((phase_expts[i].first*7) % 8, tmp, phase_expts, phase_index);
+      phase_h.resize(phase_expts.size(), -1);
+      if (phase_h[i] != -1 && (phase_h[ind] == -1 || phase_h[i] < phase_h[ind])) {
+        phase_h[ind] = phase_h[i];
       }
       phase_expts[i].first = 0;
     }
   }
 }
 
+//---------------------------- Hadamard snapshots
+
+int wire_snapshots::push(const vector<xor_func>& wires) {
+  int k = size();
+  size_t i;
+  bool full = (k % interval == 0);
+  xor_func::size_type b;
+
+  if (last.size() < wires.size()) last.resize(wires.size(), xor_func(wires[0].size(), 0));
+  for (i = 0; i < wires.size(); i++) {
+    if (!full && wires[i] == last[i]) continue;
+    arena.push_back(i);
+    arena.push_back(wires[i].count());
+    for (b = wires[i].find_first(); b != xor_func::npos; b = wires[i].find_next(b)) arena.push_back(b);
+    last[i] = wires[i];
+  }
+  start.push_back(arena.size());
+
+  return k;
+}
+
+void wire_snapshots::apply(int k, vector<xor_func>& wires) const {
+  int q, bits;
+
+  for (size_t p = start[k]; p < start[k + 1];) {
+    q = arena[p++];
+    bits = arena[p++];
+    wires[q].reset();
+    for (; bits > 0; bits--) wires[q].set(arena[p++]);
+  }
+}
+
+void wire_snapshots::get(int k, vector<xor_func>& wires, int num, bool from_prev) const {
+  int i = from_prev ? k : k - k % interval;
+  xor_func zero(last[0].size(), 0);
+
+  if (!from_prev) wires.assign(num, zero);
+  else if (wires.size() < (size_t)num) wires.resize(num, zero);
+  for (; i <= k; i++) apply(i, wires);
+}
+
 //---------------------------- Synthesis
 
-dotqc character::synthesize() {
+dotqc character::synthesize(gate_sink* sink) {
   auto floats = vector<partitioning>(2);
   auto frozen = vector<partitioning>(2);
   dotqc ret;
   xor_func mask(n + h + 1, 0);      // Tells us what values we have prepared
   vector<xor_func> wires(n + m);        // Current state of the wires
+  vector<xor_func> h_wires;             // State of the wires at the current hadamard
+  vector<set<int> > in(hadamards.size()); // Terms each hadamard needs applied first
   vector<list<int> > remaining(2);          // Which terms we still have to partition
   int dim = n, tmp, h_count = 1, applied = 0, j;
   ind_oracle oracle(n + m, dim, n + h);
-  list<pair<string, list<string> > > circ;
   list<Hadamard>::iterator it;
   int global_phase = 0;
 
@@ -679,13 +1094,18 @@ dotqc character::synthesize() {
   mask.set(n + h);
   for (int i = 0, j = 0; i < n + m; i++) {
     ret.names.push_back(names[i]);
-    ret.zero[names[i]] = zero[i];
+    ret.zero.push_back(zero[i]);
     wires[i] = xor_func(n + h + 1, 0);
     if (!zero[i]) {
       wires[i].set(j);
       mask.set(j++);
     }
   }
+  if (sink) sink->begin(ret);
+
+  for (size_t i = 0; i < phase_h.size(); i++) {
+    if (phase_h[i] != -1) in[phase_h[i]].insert(i);
+  }
 
   // initialize the remaining list
   for (int i = 0; i < phase_expts.size(); i++) {
@@ -717,22 +1137,28 @@ dotqc character::synthesize() {
 
     // determine frozen partitions
     for (j = 0; j < 2; j++) {
-      frozen[j] = freeze_partitions(floats[j], it->in);
+      frozen[j] = freeze_partitions(floats[j], in[h_count - 1]);
       applied += num_elts(frozen[j]);
     }
 
     // Construct {CNOT, T} subcircuit for the frozen partitions
-    ret.circ.splice(ret.circ.end(),
-        construct_circuit(phase_expts, frozen[0], wires, wires, n + m, n + h, names));
-    ret.circ.splice(ret.circ.end(),
-        construct_circuit(phase_expts, frozen[1], wires, it->wires, n + m, n + h, names));
+    snapshots.get(it->snapshot, h_wires, n + m, h_count > 1);
+    append(ret.circ,
+        construct_circuit(phase_expts, frozen[0], wires, wires, n + m, n + h));
+    append(ret.circ,
+        construct_circuit(phase_expts, frozen[1], wires, h_wires, n + m, n + h));
     for (int i = 0; i < n + m; i++) {
-      wires[i] = it->wires[i];
+      wires[i] = h_wires[i];
     }
     if (disp_log) cerr << "    " << applied << "/" << phase_expts.size() << " phase rotations applied\n" << flush;
 
     // Apply Hadamard gate
-    ret.circ.push_back(make_pair("H", list<string>(1, names[it->qubit])));
+    ret.circ.push_back(gate(GATE_H, it->qubit));
+    // Stream out the finished block
+    if (sink) {
+      sink->emit(ret.circ);
+      ret.circ.clear();
+    }
     wires[it->qubit].reset();
     wires[it->qubit].set(it->prep);
     mask.set(it->prep);
@@ -763,14 +1189,20 @@ dotqc character::synthesize() {
 
   applied += num_elts(floats[0]) + num_elts(floats[1]);
   // Construct the final {CNOT, T} subcircuit
-  ret.circ.splice(ret.circ.end(),
-      construct_circuit(phase_expts, floats[0], wires, wires, n + m, n + h, names));
-  ret.circ.splice(ret.circ.end(),
-      construct_circuit(phase_expts, floats[1], wires, outputs, n + m, n + h, names));
+  append(ret.circ,
+      construct_circuit(phase_expts, floats[0], wires, wires, n + m, n + h));
+  append(ret.circ,
+      construct_circuit(phase_expts, floats[1], wires, outputs, n + m, n + h));
   if (disp_log) cerr << "  " << applied << "/" << phase_expts.size() << " phase rotations applied\n" << flush;
 
   // Add the global phase
-  ret.circ.splice(ret.circ.end(), global_phase_synth(n + m, global_phase, names));
+  append(ret.circ, global_phase_synth(n + m, global_phase));
+
+  if (sink) {
+    sink->emit(ret.circ);
+    sink->end();
+    ret.circ.clear();
+  }
 
   return ret;
 }
@@ -780,10 +1212,11 @@ dotqc character::synthesize_unbounded() {
   dotqc ret;
   xor_func mask(n + h + 1, 0);      // Tells us what values we have prepared
   auto wires = vector<xor_func>(n + m); // Current state of the wires
+  vector<xor_func> h_wires;             // State of the wires at the current hadamard
+  vector<set<int> > in(hadamards.size()); // Terms each hadamard needs applied first
   list<int> remaining[2];          // Which terms we still have to partition
   int dim = n, tmp1, tmp2, h_count = 1, applied = 0, j;
   ind_oracle oracle(n + m, dim, n + h);
-  list<pair<string, list<string> > > circ;
   list<Hadamard>::iterator it;
   int global_phase = 0;
 
@@ -797,6 +1230,10 @@ dotqc character::synthesize_unbounded() {
     }
   }
 
+  for (size_t i = 0; i < phase_h.size(); i++) {
+    if (phase_h[i] != -1) in[phase_h[i]].insert(i);
+  }
+
   // initialize the remaining list
   for (int i = 0; i < phase_expts.size(); i++) {
     if (phase_expts[i].second == xor_func(n + h + 1, 0)) global_phase = phase_expts[i].first;
@@ -829,7 +1266,7 @@ dotqc character::synthesize_unbounded() {
     tmp1 = compute_rank(n + m, n + h, wires);
     // determine frozen partitions
     for (j = 0; j < 2; j++) {
-      frozen[j] = freeze_partitions(floats[j], it->in);
+      frozen[j] = freeze_partitions(floats[j], in[h_count - 1]);
       applied += num_elts(frozen[j]);
       // determine if we need to add ancillae
       if (frozen[j].size() != 0) {
@@ -846,17 +1283,18 @@ dotqc character::synthesize_unbounded() {
 
     if (disp_log) cerr << "    Synthesizing T-layer\n" << flush;
     // Construct {CNOT, T} subcircuit for the frozen partitions
-    ret.circ.splice(ret.circ.end(),
-        construct_circuit(phase_expts, frozen[0], wires, wires, n + m, n + h, names));
-    ret.circ.splice(ret.circ.end(),
-        construct_circuit(phase_expts, frozen[1], wires, it->wires, n + m, n + h, names));
+    snapshots.get(it->snapshot, h_wires, n + m, h_count > 1);
+    append(ret.circ,
+        construct_circuit(phase_expts, frozen[0], wires, wires, n + m, n + h));
+    append(ret.circ,
+        construct_circuit(phase_expts, frozen[1], wires, h_wires, n + m, n + h));
     for (int i = 0; i < n + m; i++) {
-      wires[i] = it->wires[i];
+      wires[i] = h_wires[i];
     }
     if (disp_log) cerr << "    " << applied << "/" << phase_expts.size() << " phase rotations applied\n" << flush;
 
     // Apply Hadamard gate
-    ret.circ.push_back(make_pair("H", list<string>(1, names[it->qubit])));
+    ret.circ.push_back(gate(GATE_H, it->qubit));
     wires[it->qubit].reset();
     wires[it->qubit].set(it->prep);
     mask.set(it->prep);
@@ -900,32 +1338,77 @@ dotqc character::synthesize_unbounded() {
     }
   }
 
-  ret.circ.splice(ret.circ.end(),
-      construct_circuit(phase_expts, floats[0], wires, wires, n + m, n + h, names));
-  ret.circ.splice(ret.circ.end(),
-      construct_circuit(phase_expts, floats[1], wires, outputs, n + m, n + h, names));
+  append(ret.circ,
+      construct_circuit(phase_expts, floats[0], wires, wires, n + m, n + h));
+  append(ret.circ,
+      construct_circuit(phase_expts, floats[1], wires, outputs, n + m, n + h));
   if (disp_log) cerr << "  " << applied << "/" << phase_expts.size() << " phase rotations applied\n" << flush;
 
   ret.n = n;
   ret.m = m;
   for (int i = 0; i < n + m; i++) {
     ret.names.push_back(names[i]);
-    ret.zero[names[i]] = zero[i];
+    ret.zero.push_back(zero[i]);
   }
 
   // Add the global phase
-  ret.circ.splice(ret.circ.end(), global_phase_synth(n + m, global_phase, names));
+  append(ret.circ, global_phase_synth(n + m, global_phase));
 
   return ret;
 }
 
 //-------------------------------- old {CNOT, T} version code. Still used for the "no hadamards" option
 
+bool is_cnott(const gate & g) {
+  switch (g.type) {
+    case GATE_T:
+    case GATE_TDAG:
+    case GATE_P:
+    case GATE_PDAG:
+    case GATE_X:
+    case GATE_Y:
+      return g.size() == 1;
+    case GATE_Z:
+      return g.size() == 1 || g.size() == 3;
+    case GATE_TOF:
+      return g.size() == 1 || g.size() == 2;
+    default:
+      return false;
+  }
+}
+
+// Finish a subcircuit. Every qubit that was still |0> at its start belongs to
+//   it, those not touched by any of its gates are added in the order of their names
+void close_subcircuit(subcircuit & sub, const vector<string> & names, const vector<bool> & zero,
+    const vector<int> & by_name, vector<int> & local) {
+  size_t i;
+  int q;
+
+  sub.circ.m = 0;
+  for (i = 0; i < by_name.size(); i++) {
+    q = by_name[i];
+    if (zero[q]) {
+      sub.circ.m += 1;
+      if (local[q] == -1) {
+        local[q] = sub.qubits.size();
+        sub.qubits.push_back(q);
+        sub.circ.names.push_back(names[q]);
+      }
+    }
+  }
+  sub.circ.n = sub.circ.names.size() - sub.circ.m;
+
+  for (i = 0; i < sub.qubits.size(); i++) {
+    q = sub.qubits[i];
+    sub.circ.zero.push_back(zero[q]);
+    local[q] = -1;
+  }
+}
+
 void metacircuit::partition_dotqc(dotqc & input) {
-  list<pair<string, list<string> > >::iterator it;
-  list<string>::iterator iti;
-  map<string, bool>::iterator ti;
-  circuit_type current = UNKNOWN;
+  gatelist::iterator it;
+  int* iti;
+  circuit_type current = UNKNOWN, type;
 
   n = input.n;
   m = input.m;
@@ -933,99 +1416,71 @@ void metacircuit::partition_dotqc(dotqc & input) {
   names = input.names;
   zero  = input.zero;
 
-  dotqc acc;
-  map<string, bool> zero_acc = input.zero;
+  subcircuit acc;
+  vector<bool> zero_acc = input.zero, zero_start = input.zero;
+  vector<int> by_name = order_by_name(names);
+  vector<int> local(names.size(), -1);   // index of each qubit in acc, or -1
 
-  acc.zero = zero_acc;
   for (it = input.circ.begin(); it != input.circ.end(); it++) {
-    if ((it->first == "T"   && it->second.size() == 1) ||
-        (it->first == "T*"  && it->second.size() == 1) ||
-        (it->first == "P"   && it->second.size() == 1) ||
-        (it->first == "P*"  && it->second.size() == 1) ||
-        (it->first == "X"   && it->second.size() == 1) ||
-        (it->first == "Y"   && it->second.size() == 1) ||
-        (it->first == "Z"   && (it->second.size() == 1 || it->second.size() == 3)) ||
-        (it->first == "tof" && (it->second.size() == 1 || it->second.size() == 2))) {
-      if (current == UNKNOWN) {
-        current = CNOTT;
-      } else if (current != CNOTT) {
-        acc.n = acc.m = 0;
-        for (ti = acc.zero.begin(); ti != acc.zero.end(); ti++) {
-          if (ti->second) {
-            acc.m += 1;
-            if (!find_name(acc.names, ti->first)) acc.names.push_back(ti->first);
-          }
-        }
-        acc.n = acc.names.size() - acc.m;
-        circuit_list.push_back(make_pair(current, acc));
-
-        acc.clear();
-        acc.zero = zero_acc;
-        current = CNOTT;
-      }
-    } else {
-      if (current == UNKNOWN) {
-        current = OTHER;
-      } else if (current != OTHER) {
-        acc.n = acc.m = 0;
-        for (ti = acc.zero.begin(); ti != acc.zero.end(); ti++) {
-          if (ti->second) {
-            acc.m += 1;
-            if (!find_name(acc.names, ti->first)) acc.names.push_back(ti->first);
-          }
-        }
-        acc.n = acc.names.size() - acc.m;
-        circuit_list.push_back(make_pair(current, acc));
-
-        acc.clear();
-        acc.zero = zero_acc;
-        current = OTHER;
-      }
+    type = is_cnott(*it) ? CNOTT : OTHER;
+    if (current == UNKNOWN) {
+      current = type;
+    } else if (current != type) {
+      acc.type = current;
+      close_subcircuit(acc, names, zero_start, by_name, local);
+      circuit_list.push_back(std::move(acc));
+
+      acc = subcircuit();
+      zero_start = zero_acc;
+      current = type;
     }
-    for (iti = it->second.begin(); iti != it->second.end(); iti++) {
+    gate g = *it;
+    for (iti = g.begin(); iti != g.end(); iti++) {
       zero_acc[*iti] = false;
+      if (local[*iti] == -1) {
+        local[*iti] = acc.qubits.size();
+        acc.qubits.push_back(*iti);
+        acc.circ.names.push_back(names[*iti]);
+      }
+      *iti = local[*iti];
     }
-    acc.append(*it);
+    acc.circ.circ.push_back(std::move(g));
   }
 
-  acc.n = acc.m = 0;
-  for (ti = acc.zero.begin(); ti != acc.zero.end(); ti++) {
-    if (ti->second) {
-      acc.m += 1;
-      if (!find_name(acc.names, ti->first)) acc.names.push_back(ti->first);
-    }
-  }
-  acc.n = acc.names.size() - acc.m;
-  circuit_list.push_back(make_pair(current, acc));
+  acc.type = current;
+  close_subcircuit(acc, names, zero_start, by_name, local);
+  circuit_list.push_back(std::move(acc));
 }
 
 void metacircuit::output(ostream& out) {
-  list<pair<circuit_type, dotqc> >::iterator it;
+  list<subcircuit>::iterator it;
   for (it = circuit_list.begin(); it != circuit_list.end(); it++) {
-    if (it->first == CNOTT) {
+    if (it->type == CNOTT) {
       character tmp;
-      tmp.parse_circuit(it->second);
+      tmp.parse_circuit(it->circ);
       out << "CNOT, T circuit: " << tmp.n << " " << tmp.m << "\n";
       tmp.output(out);
     }
-    else out << "Other: " << it->second.n << " " << it->second.m << "\n";
-    it->second.output(out);
+    else out << "Other: " << it->circ.n << " " << it->circ.m << "\n";
+    it->circ.output(out);
     out << "\n";
   }
 }
 
 dotqc metacircuit::to_dotqc() {
   dotqc ret;
-  list<pair<circuit_type, dotqc> >::iterator it;
+  list<subcircuit>::iterator it;
   gatelist::iterator ti;
+  int* iti;
   ret.n = n;
   ret.m = m;
   ret.names = names;
   ret.zero = zero;
 
   for (it = circuit_list.begin(); it != circuit_list.end(); it++) {
-    for (ti = it->second.circ.begin(); ti != it->second.circ.end(); ti++) {
+    for (ti = it->circ.circ.begin(); ti != it->circ.circ.end(); ti++) {
       ret.circ.push_back(*ti);
+      for (iti = ret.circ.back().begin(); iti != ret.circ.back().end(); iti++) *iti = it->qubits[*iti];
     }
   }
 
@@ -1033,12 +1488,12 @@ dotqc metacircuit::to_dotqc() {
 }
 
 void metacircuit::optimize() {
-  list<pair<circuit_type, dotqc> >::iterator it;
+  list<subcircuit>::iterator it;
   for (it =circuit_list.begin(); it != circuit_list.end(); it++) {
-    if (it->first == CNOTT) {
+    if (it->type == CNOTT) {
       character tmp;
-      tmp.parse_circuit(it->second);
-      it->second = tmp.synthesize();
+      tmp.parse_circuit(it->circ);
+      it->circ = tmp.synthesize();
     }
   }
 }
@@ -24,6 +24,8 @@ Author: Matthew Amy
 #include <iostream>
 #include <set>
 #include <map>
+#include <stdexcept>
+#include <cstring>
 #include "matroid.h"
 #include "util.h"
 
@@ -31,24 +33,130 @@ using namespace std;
 
 // Recognized gates are T, T*, P, P*, Z, Z*, Z a b c, tof a b, tof a, X, H
 
+// Syntax error in a .qc file
+struct qc_error : public runtime_error {
+  int line;                // line of the file the error is on
+
+  qc_error(int l, const string& msg) : runtime_error("line " + to_string(l) + ": " + msg), line(l) {}
+};
+
+// Buffered text output: collects writes in a large buffer and passes them
+//   on to the stream in big chunks
+class qc_writer {
+  public:
+    qc_writer(ostream& out, size_t capacity = 1 << 20) : out(out), buf(capacity), used(0) {}
+    ~qc_writer() { flush(); }
+
+    void write(const char* s, size_t len);
+    qc_writer& operator<<(const string& s) { write(s.data(), s.size()); return *this; }
+    qc_writer& operator<<(const char* s) { write(s, strlen(s)); return *this; }
+    qc_writer& operator<<(char c) { if (used == buf.size()) flush(); buf[used++] = c; return *this; }
+    qc_writer& operator<<(long v);
+    qc_writer& operator<<(int v) { return *this << (long)v; }
+    void flush();
+
+  private:
+    ostream& out;
+    vector<char> buf;
+    size_t used;
+};
+
+struct dotqc;
+
+// Statistics of a circuit, gathered by dotqc::stats in a single pass
+struct qc_stats {
+  int qubits;              // number of qubits declared
+  int used;                // number of qubits some gate acts on
+  int gates;               // number of gates, a Toffoli phase Z a b c counting
+                           //   as the 7 T and 7 CNOT gates of its expansion
+  int H, cnot, X, T, P, Z; // gate counts, with Toffoli phases expanded
+  int tdepth_partitions;   // T-depth counting runs of consecutive T gates
+  int depth;
+  int tdepth;
+  int cnot_depth;
+  vector<int> t_layers;    // number of T gates in each T-layer
+
+  qc_stats() : qubits(0), used(0), gates(0), H(0), cnot(0), X(0), T(0), P(0), Z(0),
+               tdepth_partitions(0), depth(0), tdepth(0), cnot_depth(0) {}
+  void print(ostream& out) const;       // .qc comments, as tpar prints them
+  void print_json(ostream& out) const;  // a single JSON object
+};
+
+// Receives a circuit while it is being synthesized: first its qubits, then
+//   its gates in blocks, then the end of the circuit
+struct gate_sink {
+  virtual ~gate_sink() {}
+  virtual void begin(const dotqc& header) = 0;
+  virtual void emit(const gatelist& gates) = 0;
+  virtual void end() = 0;
+};
+
 // Internal representation of a .qc circuit circuit
 struct dotqc {
   int n;                   // number of unknown inputs
   int m;                   // number of known inputs (initialized to |0>)
-  list<string> names;      // names of qubits
-  map<string, bool> zero;  // mapping from qubits to 0 (non-zero) or 1 (zero)
+  vector<string> names;    // names of qubits, indexed by the gate operands
+  vector<bool> zero;       // mapping from qubits to 0 (non-zero) or 1 (zero)
   gatelist circ;           // Circuit
 
+  void input(const char* buf, size_t len);   // throws qc_error
   void input(istream& in);
+  void input(int fd);                        // maps fd if it is a regular file
   void output(ostream& out);
+  void output(qc_writer& out);
+  void output_header(qc_writer& out) const;   // .v, .i, .o and BEGIN
+  void output_gates(qc_writer& out, const gatelist& gates) const;
   void print() {output(cout);}
   void clear() {n = 0; m = 0; names.clear(); zero.clear(); circ.clear();}
-  void append(pair<string, list<string> > gate);
-  void remove_swaps();
-  int count_depth();
-  int count_t_depth();
+  void remove_swaps(vector<int>* outputs = NULL);
+  qc_stats stats() const;
   void print_stats();
   void remove_ids();
+  void fold_phases();
+};
+
+// Circuit as a directed acyclic graph of gates. Every node links to the
+//   gates before and after it on each of its qubits, so neighbouring gates
+//   are found in constant time. Nodes are only ever added at the end and
+//   removed nodes stay in the pool, so the pool order is a topological order
+struct gate_dag {
+  static const int none = -1;
+
+  int qubits;              // number of qubits
+  gatelist nodes;          // node pool, in the order the gates were added
+  vector<int> offset;      // where each node's links start in prev and next
+  vector<int> prev;        // gate before a node on each of its qubits
+  vector<int> next;        // gate after a node on each of its qubits
+  vector<int> first;       // first gate on each qubit
+  vector<int> last;        // last gate on each qubit
+  vector<bool> removed;
+  int live;                // number of nodes not removed
+
+  gate_dag(int qubits = 0);
+  gate_dag(const dotqc& qc);
+  void to_dotqc(dotqc& qc);         // moves the remaining gates into qc
+  int add(const gate& g);           // appends g to the circuit
+  void remove(int node);
+  int slot(int node, int q) const;  // which operand of node q is, -1 if none
+  int prev_on(int node, int q) const { return prev[offset[node] + slot(node, q)]; }
+  int next_on(int node, int q) const { return next[offset[node] + slot(node, q)]; }
+  int layers(vector<int>& layer) const;  // earliest layer of each node
+};
+
+// Writes a circuit to a qc_writer as it is synthesized
+class qc_stream : public gate_sink {
+  public:
+    qc_stream(qc_writer& out) : out(out), count(0) {}
+
+    void begin(const dotqc& header);
+    void emit(const gatelist& gates);
+    void end();
+    long gates() const { return count; }
+
+  private:
+    qc_writer& out;
+    dotqc header;
+    long count;
 };
 
 // ------------------------- Hadamard version
@@ -56,8 +164,50 @@ struct Hadamard {
   int qubit;        // Which qubit this hadamard is applied to
   int prep;         // Which "value" this hadamard prepares
 
-  set<int> in;      // exponent terms that must be prepared before the hadamard
-  vector<xor_func> wires; // state of the wires when this hadamard is applied
+  int snapshot;     // state of the wires when this hadamard is applied, in
+                    //   character::snapshots
+};
+
+// States of the wires at each Hadamard. A snapshot only stores the wires
+//   that changed since the one before it, with every interval-th snapshot
+//   stored in full so any of them can be rebuilt from a few records. Wires
+//   are stored by the bits they have set, all in one arena
+class wire_snapshots {
+  public:
+    wire_snapshots(int interval = 64) : interval(interval), start(1, 0) {}
+    void clear() { arena.clear(); start.assign(1, 0); last.clear(); }
+    int size() const { return start.size() - 1; }
+    int push(const vector<xor_func>& wires);
+    // Rebuild snapshot k into wires, padded with zero wires up to num. If
+    //   wires already holds snapshot k - 1 only the changes are applied
+    void get(int k, vector<xor_func>& wires, int num, bool from_prev = false) const;
+
+  private:
+    int interval;
+    vector<int> arena;       // per wire: its index, its number of set bits, the bits
+    vector<size_t> start;    // where each snapshot starts in the arena
+    vector<xor_func> last;   // wires of the last snapshot pushed
+
+    void apply(int k, vector<xor_func>& wires) const;
+};
+
+// Index of phase exponents by their parity: an open addressing hash table
+//   of positions in a vector<exponent>. Exponents are only ever appended and
+//   their parities never change (remove_x zeroes the phase of a negated term
+//   but leaves it in place), so the index stays valid as phases are merged
+class phase_table {
+  public:
+    phase_table() : count(0) {}
+    void clear() { slots.clear(); hashes.clear(); count = 0; }
+    // Position of f in phases, appending it with a zero phase if it is new
+    int find_or_add(const xor_func& f, vector<exponent>& phases);
+
+  private:
+    vector<int> slots;       // position in phases, -1 if empty
+    vector<size_t> hashes;   // hash of the parity in each slot
+    int count;
+
+    void grow();
 };
 
 // Characteristic of a circuit
@@ -69,16 +219,20 @@ struct character {
   vector<bool>       zero;      // Which qubits start as 0
   map<int, int>      val_map;   // which value corresponds to which qubit
   vector<exponent> phase_expts; // a list of exponents of \omega in the mapping
+  phase_table      phase_index; // positions in phase_expts by parity
+  vector<int>      phase_h;     // first hadamard each exponent must be applied
+                                //   before, -1 if none
   vector<xor_func> outputs;   // the xors computed into each qubit
   // TODO: make this a dependency graph instead
   list<Hadamard>   hadamards;   // a list of the hadamards in the order we saw them
+  wire_snapshots   snapshots;   // wires at each hadamard
 
   void output(ostream& out);
   void print() {output(cout);}
   void parse_circuit(dotqc & input);
   void add_ancillae(int num);
   void remove_x();
-  dotqc synthesize();
+  dotqc synthesize(gate_sink* sink = NULL);
   dotqc synthesize_unbounded();
 };
 
@@ -86,12 +240,19 @@ struct character {
 
 enum circuit_type { CNOTT, OTHER, UNKNOWN };
 
+// A subcircuit acting on some of the qubits of the whole circuit
+struct subcircuit {
+  circuit_type type;
+  dotqc circ;
+  vector<int> qubits;           // index of each of its qubits in the whole circuit
+};
+
 struct metacircuit {
   int n;                        // number of unknown inputs
   int m;                        // number of known inputs (initialized to |0>)
-  list<string> names;           // names of qubits
-  map<string, bool> zero;       // mapping from qubits to 0 (non-zero) or 1 (zero)
-  list<pair<circuit_type, dotqc> > circuit_list;     // A list of subcircuits
+  vector<string> names;         // names of qubits
+  vector<bool> zero;            // mapping from qubits to 0 (non-zero) or 1 (zero)
+  list<subcircuit> circuit_list;     // A list of subcircuits
 
   void partition_dotqc(dotqc & input);
   void output(ostream& out);
@@ -0,0 +1,125 @@
+/*--------------------------------------------------------------------
+  Tpar - T-gate optimization for quantum circuits
+  Copyright (C) 2013  Matthew Amy and The University of Waterloo,
+  Institute for Quantum Computing, Quantum Circuits Group
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Author: Matthew Amy
+---------------------------------------------------------------------*/
+
+#include "circuit.h"
+
+const int gate_dag::none;
+
+gate_dag::gate_dag(int qubits) : qubits(qubits), offset(1, 0), first(qubits, none),
+                                 last(qubits, none), live(0) {}
+
+gate_dag::gate_dag(const dotqc& qc) : qubits(qc.names.size()), offset(1, 0),
+                                      first(qubits, none), last(qubits, none), live(0) {
+  int num = qc.circ.size(), links = 0, i;
+
+  for (i = 0; i < num; i++) links += qc.circ[i].size();
+  nodes.reserve(num);
+  offset.reserve(num + 1);
+  prev.reserve(links);
+  next.reserve(links);
+  removed.reserve(num);
+  for (i = 0; i < num; i++) add(qc.circ[i]);
+}
+
+// Replace the gates of qc with the remaining nodes, in order. Leaves the
+//   DAG empty
+void gate_dag::to_dotqc(dotqc& qc) {
+  int num = nodes.size(), i, j;
+
+  for (i = 0, j = 0; j < num; j++) {
+    if (!removed[j]) {
+      if (i != j) nodes[i] = std::move(nodes[j]);
+      i++;
+    }
+  }
+  nodes.erase(nodes.begin() + i, nodes.end());
+  qc.circ = std::move(nodes);
+
+  *this = gate_dag(qubits);
+}
+
+int gate_dag::add(const gate& g) {
+  int node = nodes.size(), k, p;
+
+  nodes.push_back(g);
+  removed.push_back(false);
+  for (k = 0; k < g.size(); k++) {
+    p = last[g[k]];
+    prev.push_back(p);
+    next.push_back(none);
+    if (p == none) first[g[k]] = node;
+    else next[offset[p] + slot(p, g[k])] = node;
+    last[g[k]] = node;
+  }
+  offset.push_back(prev.size());
+  live++;
+
+  return node;
+}
+
+// Unlink a node, joining the gates before and after it on each qubit
+void gate_dag::remove(int node) {
+  const gate & g = nodes[node];
+  int k, p, n;
+
+  for (k = 0; k < g.size(); k++) {
+    p = prev[offset[node] + k];
+    n = next[offset[node] + k];
+    if (p == none) first[g[k]] = n;
+    else next[offset[p] + slot(p, g[k])] = n;
+    if (n == none) last[g[k]] = p;
+    else prev[offset[n] + slot(n, g[k])] = p;
+  }
+  removed[node] = true;
+  live--;
+}
+
+int gate_dag::slot(int node, int q) const {
+  const gate & g = nodes[node];
+
+  for (int k = 0; k < g.size(); k++) {
+    if (g[k] == q) return k;
+  }
+
+  return none;
+}
+
+// Layer each node as early as it can go: one more than the latest of the
+//   gates before it. Gates in the same layer act on disjoint qubits, so a
+//   layer can be processed in parallel. Removed nodes get layer -1
+int gate_dag::layers(vector<int>& layer) const {
+  int num = nodes.size(), ret = 0, i, k, p, l;
+
+  layer.assign(num, none);
+  // The pool is in topological order
+  for (i = 0; i < num; i++) {
+    if (removed[i]) continue;
+    l = 0;
+    for (k = offset[i]; k < offset[i + 1]; k++) {
+      p = prev[k];
+      if (p != none && layer[p] + 1 > l) l = layer[p] + 1;
+    }
+    layer[i] = l;
+    if (l + 1 > ret) ret = l + 1;
+  }
+
+  return ret;
+}
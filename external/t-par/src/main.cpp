@@ -22,6 +22,7 @@ Author: Matthew Amy
 #include <cstdio>
 #include <iomanip>
 #include <chrono>
+#include <fstream>
 
 using Clock = std::chrono::high_resolution_clock;
 
@@ -29,12 +30,69 @@ chrono::duration<double> elapsed(Clock::time_point start, Clock::time_point end)
   return chrono::duration_cast<chrono::duration<double> >(end - start);
 }
 
+// Quote a string for JSON
+string json_string(const string& s) {
+  string ret = "\"";
+  char buf[8];
+
+  for (size_t i = 0; i < s.size(); i++) {
+    if (s[i] == '"' || s[i] == '\\') {
+      ret += '\\';
+      ret += s[i];
+    } else if ((unsigned char)s[i] < 0x20) {
+      snprintf(buf, sizeof(buf), "\\u%04x", s[i]);
+      ret += buf;
+    } else ret += s[i];
+  }
+
+  return ret + "\"";
+}
+
+// Write the statistics of a run as one JSON object. A streamed circuit only
+//   has its gate count, and the output permutation is only there if the
+//   outputs were left permuted
+void write_json(const string& path, const qc_stats& original, const qc_stats* optimized,
+                long streamed, double time, const vector<string>& names, const vector<int>& outputs) {
+  ofstream out(path.c_str());
+  if (!out) {
+    cerr << "ERROR: cannot write " << path << "\n";
+    exit(1);
+  }
+
+  out << "{\"original\": ";
+  original.print_json(out);
+  out << ", \"optimized\": ";
+  if (optimized != NULL) optimized->print_json(out);
+  else out << "{\"gates\": " << streamed << "}";
+  out << ", \"time\": " << fixed << setprecision(6) << time;
+  if (!outputs.empty()) {
+    out << ", \"output_permutation\": {";
+    for (int i = 0, first = 1; i < (int)outputs.size(); i++) {
+      if (outputs[i] == i) continue;
+      out << (first ? "" : ", ") << json_string(names[i]) << ": " << json_string(names[outputs[i]]);
+      first = 0;
+    }
+    out << "}";
+  }
+  out << "}\n";
+  if (!out) {
+    cerr << "ERROR: cannot write " << path << "\n";
+    exit(1);
+  }
+}
+
 int main(int argc, char *argv[]) {
   Clock::time_point start, end;
   dotqc circuit, synth;
   bool full_character = true;
   bool post_process = true;
   bool remove_constants = true;
+  bool stream = false;
+  bool fold = false;
+  bool permute_outputs = false;
+  vector<int> outputs;
+  string json_path;
+  qc_stats original, optimized;
   int anc = 0;
   // Quick and dirty solution, don't judge me
   for (int i = 0; i < argc; i++)
@@ -57,15 +115,48 @@ int main(int argc, char *argv[]) {
   else if ((string)argv[i] == "-synth=PMH") synth_method = PMH;
   else if ((string)argv[i] == "-log") disp_log = true;
   else if ((string)argv[i] == "-no-remove-constants") remove_constants = false;
+  else if ((string)argv[i] == "-stream") stream = true;
+  else if ((string)argv[i] == "-mode=full") fold = false;
+  else if ((string)argv[i] == "-mode=fold") fold = true;
+  else if ((string)argv[i] == "-output-permutation") permute_outputs = true;
+  else if ((string)argv[i] == "-stats-json") {
+    i++;
+    if (i == argc) {
+      cerr << "ERROR: -stats-json needs a file name\n";
+      exit(1);
+    }
+    json_path = argv[i];
+  }
+
+  if (stream && (!full_character || anc == -2)) {
+    cerr << "ERROR: -stream does not work with -no-hadamard or unbounded ancillae\n";
+    exit(1);
+  }
+  if (stream && fold) {
+    cerr << "ERROR: -stream does not work with -mode=fold\n";
+    exit(1);
+  }
 
   if (disp_log) cerr << "Reading circuit...\n" << flush;
-  circuit.input(cin);
+  try {
+    circuit.input(0);
+  } catch (exception& e) {
+    cout << "ERROR: " << e.what() << "\n" << flush;
+    exit(1);
+  }
+  original = circuit.stats();
   cout << "# Original circuit\n" << flush;
-  circuit.print_stats();
+  original.print(cout);
   cout << flush;
 
   circuit.remove_ids();
-  if (full_character) {
+  if (fold) {
+    if (disp_log) cerr << "Folding phases...\n" << flush;
+    start = Clock::now();
+    synth = circuit;
+    synth.fold_phases();
+    end = Clock::now();
+  } else if (full_character) {
     character c;
     if (disp_log) cerr << "Parsing circuit...\n" << flush;
     start = Clock::now();
@@ -74,6 +165,22 @@ int main(int argc, char *argv[]) {
     if (anc == -1) c.add_ancillae(c.n + c.m);
     else if (anc > 0) c.add_ancillae(anc);
     if (disp_log) cerr << "Resynthesizing circuit...\n" << flush;
+    if (stream) {
+      // Write out each block as soon as it is synthesized. The circuit is
+      //   never held in full, so it is not post-processed
+      qc_writer out(cout);
+      qc_stream sink(out);
+      c.synthesize(&sink);
+      end = Clock::now();
+      out << "# Optimized circuit (streamed)\n";
+      out << "#   gates: " << sink.gates() << "\n";
+      out.flush();
+      cout << fixed << setprecision(3);
+      cout << "#   Time: " << elapsed(start, end).count() << " s\n";
+      if (!json_path.empty())
+        write_json(json_path, original, NULL, sink.gates(), elapsed(start, end).count(), c.names, outputs);
+      return 0;
+    }
     if (anc == -2) synth = c.synthesize_unbounded();
     else           synth = c.synthesize();
     end = Clock::now();
@@ -90,14 +197,24 @@ int main(int argc, char *argv[]) {
 
   if (post_process) {
     if (disp_log) cerr << "Applying post-processing...\n" << flush;
-    synth.remove_swaps();
+    synth.remove_swaps(permute_outputs ? &outputs : NULL);
     synth.remove_ids();
   }
+  optimized = synth.stats();
   cout << "# Optimized circuit\n";
-  synth.print_stats();
+  optimized.print(cout);
   cout << fixed << setprecision(3);
   cout << "#   Time: " << elapsed(start, end).count() << " s\n";
+  if (!outputs.empty()) {
+    // Each qubit's output is left on the qubit listed after it
+    cout << "#   Output permutation:";
+    for (int i = 0; i < (int)outputs.size(); i++)
+      if (outputs[i] != i) cout << " " << synth.names[i] << "->" << synth.names[outputs[i]];
+    cout << "\n";
+  }
   synth.print();
+  if (!json_path.empty())
+    write_json(json_path, original, &optimized, 0, elapsed(start, end).count(), synth.names, outputs);
 
   return 0;
 }
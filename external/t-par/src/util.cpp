@@ -22,6 +22,8 @@ Author: Matthew Amy
 #include "util.h"
 #include <map>
 #include <cmath>
+#include <algorithm>
+#include <cstring>
 
 bool disp_log = false;
 synth_type synth_method = PMH;
@@ -37,68 +39,78 @@ void print_wires(const vector<xor_func>& wires, int num, int dim) {
   }
 }
 
-// Commands for making certain circuits
-gatelist xor_com(int a, int b, const vector<string>& names) {
-  list<string> tmp_list;
-  gatelist ret;
+//---------------------------- Gates
 
-  tmp_list.push_back(names[a]);
-  tmp_list.push_back(names[b]);
-  ret.push_back(make_pair("tof", tmp_list));
+static const char* gate_names[] = { "T", "T*", "P", "P*", "Z", "Z*", "X", "Y", "H", "tof" };
 
-  return ret;
+const char* gate_name(gate_type type) {
+  return gate_names[type];
 }
 
-gatelist swap_com(int a, int b, const vector<string>& names) {
-  list<string> tmp_list1, tmp_list2;
-  gatelist ret;
-
-  tmp_list1.push_back(names[a]);
-  tmp_list1.push_back(names[b]);
-  tmp_list2.push_back(names[b]);
-  tmp_list2.push_back(names[a]);
-  ret.push_back(make_pair("tof", tmp_list1));
-  ret.push_back(make_pair("tof", tmp_list2));
-  ret.push_back(make_pair("tof", tmp_list1));
-
-  return ret;
+bool find_gate(const char* name, int len, gate_type& type) {
+  if (len == 3 && memcmp(name, "TOF", 3) == 0) {
+    type = GATE_TOF;
+    return true;
+  }
+  for (int i = 0; i <= GATE_TOF; i++) {
+    if (strncmp(name, gate_names[i], len) == 0 && gate_names[i][len] == 0) {
+      type = (gate_type)i;
+      return true;
+    }
+  }
+  return false;
 }
 
-gatelist x_com(int a, const vector<string>& names) {
-  gatelist ret;
-  list<string> tmp_list;
-
-  tmp_list.push_back(names[a]);
-  ret.push_back(make_pair("tof", tmp_list));
+gate::gate(gate_type t, const vector<int>& qubits) {
+  type = t;
+  num = qubits.size();
+  if (num > max_inline) q.spill = new int[num];
+  copy(qubits.begin(), qubits.end(), begin());
+}
 
-  return ret;
+gate::gate(const gate& g) {
+  type = g.type;
+  num = g.num;
+  if (num > max_inline) {
+    q.spill = new int[num];
+    copy(g.begin(), g.end(), q.spill);
+  } else {
+    q = g.q;
+  }
 }
 
-gatelist om_com(int a, const vector<string>& names) {
-  gatelist ret;
-  list<string> tmp_list;
+void append(gatelist& circ, const gatelist& gates) {
+  circ.insert(circ.end(), gates.begin(), gates.end());
+}
 
-  tmp_list.push_back(names[a]);
-  ret.push_back(make_pair("H", tmp_list));
-  ret.push_back(make_pair("P", tmp_list));
-  ret.push_back(make_pair("H", tmp_list));
-  ret.push_back(make_pair("P", tmp_list));
-  ret.push_back(make_pair("H", tmp_list));
-  ret.push_back(make_pair("P", tmp_list));
+// Commands for making certain circuits
+void xor_com(gatelist& acc, int a, int b) {
+  acc.push_back(gate(GATE_TOF, a, b));
+}
 
-  return ret;
+void swap_com(gatelist& acc, int a, int b) {
+  acc.push_back(gate(GATE_TOF, a, b));
+  acc.push_back(gate(GATE_TOF, b, a));
+  acc.push_back(gate(GATE_TOF, a, b));
 }
 
-gatelist i_com(int a, const vector<string>& names) {
-  gatelist ret;
-  list<string> tmp_list;
+void x_com(gatelist& acc, int a) {
+  acc.push_back(gate(GATE_TOF, a));
+}
 
-  tmp_list.push_back(names[a]);
-  ret.push_back(make_pair("tof", tmp_list));
-  ret.push_back(make_pair("Z", tmp_list));
-  ret.push_back(make_pair("Y", tmp_list));
+void om_com(gatelist& acc, int a) {
+  acc.push_back(gate(GATE_H, a));
+  acc.push_back(gate(GATE_P, a));
+  acc.push_back(gate(GATE_H, a));
+  acc.push_back(gate(GATE_P, a));
+  acc.push_back(gate(GATE_H, a));
+  acc.push_back(gate(GATE_P, a));
+}
 
-  return ret;
+void i_com(gatelist& acc, int a) {
+  acc.push_back(gate(GATE_TOF, a));
+  acc.push_back(gate(GATE_Z, a));
+  acc.push_back(gate(GATE_Y, a));
 }
 
 // Make triangular to determine the rank (destructive)
@@ -181,14 +193,14 @@ bool is_indep(int n, const vector<xor_func>& bits, const xor_func & a) {
 }
 
 // Make echelon form
-gatelist to_upper_echelon(int m, int n, vector<xor_func>& bits, vector<xor_func>* mat, const vector<string>& names) {
+gatelist to_upper_echelon(int m, int n, vector<xor_func>& bits, vector<xor_func>* mat) {
   gatelist acc;
   int i, j;
   int rank = 0;
   for (j = 0; j < m; j++) {
     if (bits[j].test(n)) {
       bits[j].reset(n);
-      if (mat == NULL) acc.splice(acc.end(), x_com(j, names));
+      if (mat == NULL) x_com(acc, j);
       else             (*mat)[j].set(m);
     }
   }
@@ -203,13 +215,13 @@ gatelist to_upper_echelon(int m, int n, vector<xor_func>& bits, vector<xor_func>
           // If it wasn't the first vector we tried, swap to the front
           if (j != rank) {
             swap(bits[rank], bits[j]);
-            if (mat == NULL) acc.splice(acc.end(), swap_com(rank, j, names));
+            if (mat == NULL) swap_com(acc, rank, j);
             else             swap((*mat)[rank], (*mat)[j]);
           }
           flg = true;
         } else {
           bits[j] ^= bits[rank];
-          if (mat == NULL) acc.splice(acc.end(), xor_com(rank, j, names));
+          if (mat == NULL) xor_com(acc, rank, j);
           else             (*mat)[j] ^= (*mat)[rank];
         }
       }
@@ -220,7 +232,7 @@ gatelist to_upper_echelon(int m, int n, vector<xor_func>& bits, vector<xor_func>
   return acc;
 }
 
-gatelist to_lower_echelon(int m, int n, vector<xor_func>& bits, vector<xor_func>* mat, const vector<string>& names) {
+gatelist to_lower_echelon(int m, int n, vector<xor_func>& bits, vector<xor_func>* mat) {
   gatelist acc;
   int i, j;
 
@@ -228,7 +240,7 @@ gatelist to_lower_echelon(int m, int n, vector<xor_func>& bits, vector<xor_func>
     for (j = i - 1; j >= 0; j--) {
       if (bits[j].test(i)) {
         bits[j] ^= bits[i];
-        if (mat == NULL) acc.splice(acc.end(), xor_com(i, j, names));
+        if (mat == NULL) xor_com(acc, i, j);
         else              (*mat)[j] ^= (*mat)[i];
       }
     }
@@ -244,8 +256,7 @@ gatelist fix_basis(
     int k,
     const vector<xor_func>& fst,
     vector<xor_func>& snd,
-    vector<xor_func>* mat,
-    const vector<string>& names )
+    vector<xor_func>* mat )
   {
   gatelist acc;
   int j = 0;
@@ -266,7 +277,7 @@ gatelist fix_basis(
           flg = true;
           if (h != i) {
             swap(snd[h], snd[i]);
-            if (mat == NULL) acc.splice(acc.end(), swap_com(h, i, names));
+            if (mat == NULL) swap_com(acc, h, i);
             else             swap((*mat)[h], (*mat)[i]);
           }
         }
@@ -281,7 +292,7 @@ gatelist fix_basis(
         if (k != i) {
           swap(snd[k], snd[i]);
           if (mat == NULL) {
-            acc.splice(acc.end(), swap_com(k, i, names));
+            swap_com(acc, k, i);
           } else {
             swap((*mat)[k], (*mat)[i]);
           }
@@ -300,7 +311,7 @@ gatelist fix_basis(
           exit(1);
         } else {
           snd[i] ^= snd[pivots[j]];
-          if (mat == NULL) acc.splice(acc.end(), xor_com(pivots[j], i, names));
+          if (mat == NULL) xor_com(acc, pivots[j], i);
           else             (*mat)[i] ^= (*mat)[pivots[j]];
         }
       }
@@ -320,20 +331,20 @@ void compose(int num, vector<xor_func>& A, const vector<xor_func>& B) {
   for (int i = 0; i < num; i++) {
     tmp[i] = B[i];
   }
-  to_upper_echelon(num, num, tmp, &A, vector<string>());
-  to_lower_echelon(num, num, tmp, &A, vector<string>());
+  to_upper_echelon(num, num, tmp, &A);
+  to_lower_echelon(num, num, tmp, &A);
 }
 
 //------------------------- CNOT synthesis methods
 
 // Gaussian elimination based CNOT synthesis
-gatelist gauss_CNOT_synth(int n, int m, vector<xor_func>& bits, const vector<string>& names) {
+gatelist gauss_CNOT_synth(int n, int m, vector<xor_func>& bits) {
   gatelist lst;
 
   for (int j = 0; j < n; j++) {
     if (bits[j].test(n)) {
       bits[j].reset(n);
-      lst.splice(lst.begin(), x_com(j, names));
+      x_com(lst, j);
     }
   }
 
@@ -347,12 +358,12 @@ gatelist gauss_CNOT_synth(int n, int m, vector<xor_func>& bits, const vector<str
           // If it wasn't the first vector we tried, swap to the front
           if (j != i) {
             swap(bits[i], bits[j]);
-            lst.splice(lst.begin(), swap_com(i, j, names));
+            swap_com(lst, i, j);
           }
           flg = true;
         } else {
           bits[j] ^= bits[i];
-          lst.splice(lst.begin(), xor_com(i, j, names));
+          xor_com(lst, i, j);
         }
       }
     }
@@ -367,16 +378,19 @@ gatelist gauss_CNOT_synth(int n, int m, vector<xor_func>& bits, const vector<str
     for (int j = i - 1; j >= 0; j--) {
       if (bits[j].test(i)) {
         bits[j] ^= bits[i];
-        lst.splice(lst.begin(), xor_com(i, j, names));
+        xor_com(lst, i, j);
       }
     }
   }
 
+  // Gates were found last to first
+  reverse(lst.begin(), lst.end());
+
   return lst;
 }
 
 // Patel/Markov/Hayes CNOT synthesis
-gatelist Lwr_CNOT_synth(int n, int m, vector<xor_func>& bits, const vector<string>& names, bool rev) {
+gatelist Lwr_CNOT_synth(int n, int m, vector<xor_func>& bits, bool rev) {
   gatelist acc;
   int sec, tmp, row, col, i;
   vector<int> patt(1<<m);
@@ -395,8 +409,8 @@ gatelist Lwr_CNOT_synth(int n, int m, vector<xor_func>& bits, const vector<strin
         patt[tmp] = row;
       } else if (tmp != 0) {
         bits[row] ^= bits[patt[tmp]];
-        if (rev) acc.splice(acc.begin(), xor_com(row, patt[tmp], names));
-        else acc.splice(acc.end(), xor_com(patt[tmp], row, names));
+        if (rev) xor_com(acc, row, patt[tmp]);
+        else xor_com(acc, patt[tmp], row);
       }
     }
 
@@ -408,63 +422,65 @@ gatelist Lwr_CNOT_synth(int n, int m, vector<xor_func>& bits, const vector<strin
             bits[row] ^= bits[col];
             bits[col] ^= bits[row];
             if (rev) {
-              acc.splice(acc.begin(), xor_com(col, row, names));
-              acc.splice(acc.begin(), xor_com(row, col, names));
-              acc.splice(acc.begin(), xor_com(col, row, names));
+              xor_com(acc, col, row);
+              xor_com(acc, row, col);
+              xor_com(acc, col, row);
             } else {
-              acc.splice(acc.end(), xor_com(row, col, names));
-              acc.splice(acc.end(), xor_com(col, row, names));
-              acc.splice(acc.end(), xor_com(row, col, names));
+              xor_com(acc, row, col);
+              xor_com(acc, col, row);
+              xor_com(acc, row, col);
             }
           } else {
             bits[row] ^= bits[col];
-            if (rev) acc.splice(acc.begin(), xor_com(row, col, names));
-            else acc.splice(acc.end(), xor_com(col, row, names));
+            if (rev) xor_com(acc, row, col);
+            else xor_com(acc, col, row);
           }
         }
       }
     }
   }
+  if (rev) reverse(acc.begin(), acc.end());
 
   return acc;
 }
 
-gatelist CNOT_synth(int n, vector<xor_func>& bits, const vector<string>& names) {
+gatelist CNOT_synth(int n, vector<xor_func>& bits) {
   gatelist acc;
   int i, j, m = (int)(log((double)n) / (log(2) * 2));
   // When m <= 1, PMH is just Gaussian elimination, so default to it
-  if (m <= 1) return gauss_CNOT_synth(n, 0, bits, names);
+  if (m <= 1) return gauss_CNOT_synth(n, 0, bits);
 
   for (j = 0; j < n; j++) {
     if (bits[j].test(n)) {
       bits[j].reset(n);
-      acc.splice(acc.begin(), x_com(j, names));
+      x_com(acc, j);
     }
   }
+  reverse(acc.begin(), acc.end());
 
-  acc.splice(acc.end(), Lwr_CNOT_synth(n, m, bits, names, false));
+  append(acc, Lwr_CNOT_synth(n, m, bits, false));
   for (i = 0; i < n; i++) {
     for (j = i + 1; j < n; j++) {
       bits[j][i] = bits[i][j];
       bits[i].reset(j);
     }
   }
-  acc.splice(acc.end(), Lwr_CNOT_synth(n, m, bits, names, true));
-  acc.reverse();
+  append(acc, Lwr_CNOT_synth(n, m, bits, true));
+  reverse(acc.begin(), acc.end());
 
   return acc;
 }
 
-gatelist global_phase_synth(int n, int phase, const vector<string>& names) {
+gatelist global_phase_synth(int n, int phase) {
   gatelist acc;
   int qubit = 0;
 
   if (phase % 2 == 1) {
-    acc.splice(acc.end(), om_com(qubit, names));
+    om_com(acc, qubit);
     qubit = (qubit + 1) % n;
   }
   for (int i = phase / 2; i > 0; i--) {
-    acc.splice(acc.end(), i_com(qubit, names));
+    i_com(acc, qubit);
     qubit = (qubit + 1) % n;
   }
 
@@ -478,8 +494,7 @@ gatelist construct_circuit(
     vector<xor_func>& in,
     const vector<xor_func>& out,
     int num,
-    int dim,
-    const vector<string>& names) {
+    int dim) {
   gatelist ret, tmp, rev;
   auto bits = vector<xor_func>(num);
   auto pre = vector<xor_func>(num);
@@ -504,9 +519,9 @@ gatelist construct_circuit(
 
   // Reduce in to echelon form to decide on a basis
   if (synth_method == AD_HOC) {
-    ret.splice(ret.end(), to_upper_echelon(num, dim, in, NULL, names));
+    append(ret, to_upper_echelon(num, dim, in, NULL));
   } else {
-    to_upper_echelon(num, dim, in, &pre, vector<string>());
+    to_upper_echelon(num, dim, in, &pre);
   }
 
   // For each partition... Compute *it, apply T gates, uncompute
@@ -522,36 +537,33 @@ gatelist construct_circuit(
 
     // prepare the bits
     if (synth_method == AD_HOC) {
-      tmp = to_upper_echelon(it->size(), dim, bits, NULL, names);
-      tmp.splice(tmp.end(), fix_basis(num, dim, it->size(), in, bits, NULL, names));
+      tmp = to_upper_echelon(it->size(), dim, bits, NULL);
+      append(tmp, fix_basis(num, dim, it->size(), in, bits, NULL));
       rev = tmp;
-      rev.reverse();
-      ret.splice(ret.end(), rev);
+      reverse(rev.begin(), rev.end());
+      append(ret, rev);
     } else {
-      to_upper_echelon(it->size(), dim, bits, &post, vector<string>());
-      fix_basis(num, dim, it->size(), in, bits, &post, vector<string>());
+      to_upper_echelon(it->size(), dim, bits, &post);
+      fix_basis(num, dim, it->size(), in, bits, &post);
       compose(num, pre, post);
-      if (synth_method == GAUSS) ret.splice(ret.end(), gauss_CNOT_synth(num, 0, pre, names));
-      else if (synth_method == PMH) ret.splice(ret.end(), CNOT_synth(num, pre, names));
+      if (synth_method == GAUSS) append(ret, gauss_CNOT_synth(num, 0, pre));
+      else if (synth_method == PMH) append(ret, CNOT_synth(num, pre));
     }
 
     // apply the T gates
-    list<string> tmp_lst;
     for (ti = it->begin(), i = 0; ti != it->end(); ti++, i++) {
-      tmp_lst.clear();
-      tmp_lst.push_back(names[i]);
       if (phase[*ti].first <= 4) {
-        if (phase[*ti].first / 4 == 1) ret.push_back(make_pair("Z", tmp_lst));
-        if (phase[*ti].first / 2 == 1) ret.push_back(make_pair("P", tmp_lst));
-        if (phase[*ti].first % 2 == 1) ret.push_back(make_pair("T", tmp_lst));
+        if (phase[*ti].first / 4 == 1) ret.push_back(gate(GATE_Z, i));
+        if (phase[*ti].first / 2 == 1) ret.push_back(gate(GATE_P, i));
+        if (phase[*ti].first % 2 == 1) ret.push_back(gate(GATE_T, i));
       } else {
-        if (phase[*ti].first == 5 || phase[*ti].first == 6) ret.push_back(make_pair("P*", tmp_lst));
-        if (phase[*ti].first % 2 == 1) ret.push_back(make_pair("T*", tmp_lst));
+        if (phase[*ti].first == 5 || phase[*ti].first == 6) ret.push_back(gate(GATE_PDAG, i));
+        if (phase[*ti].first % 2 == 1) ret.push_back(gate(GATE_TDAG, i));
       }
     }
 
     // unprepare the bits
-    if (synth_method == AD_HOC) ret.splice(ret.end(), tmp);
+    if (synth_method == AD_HOC) append(ret, tmp);
     else {
       pre = std::move(post);
       post = vector<xor_func>(num);
@@ -568,16 +580,16 @@ gatelist construct_circuit(
     bits[i] = out[i];
   }
   if (synth_method == AD_HOC) {
-    tmp = to_upper_echelon(num, dim, bits, NULL, names);
-    tmp.splice(tmp.end(), fix_basis(num, dim, num, in, bits, NULL, names));
-    tmp.reverse();
-    ret.splice(ret.end(), tmp);
+    tmp = to_upper_echelon(num, dim, bits, NULL);
+    append(tmp, fix_basis(num, dim, num, in, bits, NULL));
+    reverse(tmp.begin(), tmp.end());
+    append(ret, tmp);
   } else {
-    to_upper_echelon(num, dim, bits, &post, vector<string>());
-    fix_basis(num, dim, num, in, bits, &post, vector<string>());
+    to_upper_echelon(num, dim, bits, &post);
+    fix_basis(num, dim, num, in, bits, &post);
     compose(num, pre, post);
-    if (synth_method == GAUSS) ret.splice(ret.end(), gauss_CNOT_synth(num, 0, pre, names));
-    else if (synth_method == PMH) ret.splice(ret.end(), CNOT_synth(num, pre, names));
+    if (synth_method == GAUSS) append(ret, gauss_CNOT_synth(num, 0, pre));
+    else if (synth_method == PMH) append(ret, CNOT_synth(num, pre));
   }
   return ret;
 }
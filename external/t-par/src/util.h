@@ -20,12 +20,61 @@ Author: Matthew Amy
 ---------------------------------------------------------------------*/
 
 #include <vector>
+#include <string>
 #include <boost/dynamic_bitset.hpp>
 #include "partition.h"
 
 typedef boost::dynamic_bitset<>            xor_func;
 typedef pair<char, xor_func >              exponent;
-typedef list<pair<string, list<string> > > gatelist;
+
+// Gate opcodes. Gate names are only used when reading and writing .qc files
+enum gate_type { GATE_T, GATE_TDAG, GATE_P, GATE_PDAG, GATE_Z, GATE_ZDAG, GATE_X, GATE_Y, GATE_H, GATE_TOF };
+
+const char* gate_name(gate_type type);
+bool find_gate(const char* name, int len, gate_type& type);
+
+// A gate and the qubits it is applied to, as indices into the circuit's
+//   table of qubit names. Up to four qubits are stored inline, larger gates
+//   keep theirs on the heap
+class gate {
+  public:
+    gate_type type;
+
+    gate() { type = GATE_H; num = 0; }
+    gate(gate_type t, int a) { type = t; num = 1; q.local[0] = a; }
+    gate(gate_type t, int a, int b) { type = t; num = 2; q.local[0] = a; q.local[1] = b; }
+    gate(gate_type t, const vector<int>& qubits);
+    gate(const gate& g);
+    gate(gate&& g) noexcept { type = g.type; num = g.num; q = g.q; g.num = 0; }
+    ~gate() { if (num > max_inline) delete[] q.spill; }
+
+    gate& operator=(gate g) noexcept {
+      swap(type, g.type);
+      swap(num, g.num);
+      swap(q, g.q);
+      return *this;
+    }
+
+    int size() const { return num; }
+    int* begin() { return (num > max_inline) ? q.spill : q.local; }
+    int* end() { return begin() + num; }
+    const int* begin() const { return (num > max_inline) ? q.spill : q.local; }
+    const int* end() const { return begin() + num; }
+    int& operator[](int i) { return begin()[i]; }
+    int operator[](int i) const { return begin()[i]; }
+
+  private:
+    static const int max_inline = 4;
+    union storage {
+      int local[max_inline];
+      int* spill;
+    };
+
+    int num;
+    storage q;
+};
+
+typedef vector<gate> gatelist;
 
 enum synth_type { AD_HOC, GAUSS, PMH };
 
@@ -53,12 +102,13 @@ int compute_rank(int m, int n, const vector<xor_func>& bits);
 int compute_rank(int n, const vector<exponent> & expnts, const set<int> & lst);
 bool is_indep(int n, const vector<xor_func>& bits, const xor_func & a);
 
-gatelist global_phase_synth(int n, int phase, const vector<string>& names);
+void append(gatelist& circ, const gatelist& gates);
+
+gatelist global_phase_synth(int n, int phase);
 
 gatelist construct_circuit(const vector<exponent> & phase, 
     const partitioning & part, 
     vector<xor_func>& in,
     const vector<xor_func>& out,
     int num,
-    int dim,
-    const vector<string>& names);
+    int dim);
@@ -0,0 +1,149 @@
+#include <benchmark/benchmark.h>
+#include "generators.h"
+#include "sat_solver.h"
+#include <cstdint>
+#include <vector>
+#include <sys/resource.h>
+
+namespace {
+
+using sat_solver::SATSolver;
+
+// Grid shared by the solver benchmarks: variables, clause/variable ratio in
+// hundredths (4.26 is the random 3-SAT threshold), seed
+const std::vector<std::int64_t> kVars = {50, 100, 150};
+const std::vector<std::int64_t> kRatios = {300, 426, 500};
+const std::vector<std::int64_t> kSeeds = {1, 2, 3};
+
+/**
+ * Uniform random 3-SAT instance for the grid point of a benchmark.
+ */
+SATSolver::Formula make_formula(int num_vars, std::int64_t ratio, std::uint64_t seed) {
+    sat_solver::utils::InstanceSpec spec;
+    spec.num_vars = num_vars;
+    spec.num_clauses = static_cast<int>(num_vars * ratio / 100);
+    std::vector<int> literals(static_cast<std::size_t>(spec.num_clauses) * spec.k);
+    sat_solver::utils::generate_instance(spec, seed, 0, literals.data());
+
+    SATSolver::Formula formula;
+    for (std::size_t i = 0; i < literals.size(); i += spec.k) {
+        formula.emplace_back(literals.begin() + i, literals.begin() + i + spec.k);
+    }
+    return formula;
+}
+
+SATSolver make_solver(const SATSolver::Formula& formula) {
+    SATSolver solver;
+    for (const auto& clause : formula) {
+        solver.add_clause(clause);
+    }
+    return solver;
+}
+
+/**
+ * Report the memory one case holds under `name`. The peak resident set size
+ * is kept alongside as process_peak_rss_bytes: it covers every case run so
+ * far in the process, so it only grows and cannot be compared across cases.
+ */
+void report_memory(benchmark::State& state, const char* name, double bytes) {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    state.counters[name] = benchmark::Counter(bytes, benchmark::Counter::kDefaults, benchmark::Counter::kIs1024);
+    state.counters["process_peak_rss_bytes"] = benchmark::Counter(static_cast<double>(usage.ru_maxrss) * 1024.0,
+                                                                  benchmark::Counter::kDefaults,
+                                                                  benchmark::Counter::kIs1024);
+}
+
+/**
+ * Bytes held by the clause arena of a solver (literals and offsets).
+ */
+double formula_bytes(const SATSolver& solver) {
+    return static_cast<double>(solver.get_literals().capacity() * sizeof(int) +
+                               solver.get_clause_offsets().capacity() * sizeof(std::size_t));
+}
+
+void report_stats(benchmark::State& state, const sat_solver::SolverStats& total) {
+    state.counters["decisions_per_second"] =
+        benchmark::Counter(static_cast<double>(total.decisions), benchmark::Counter::kIsRate);
+    state.counters["conflicts_per_second"] =
+        benchmark::Counter(static_cast<double>(total.conflicts), benchmark::Counter::kIsRate);
+    report_memory(state, "arena_bytes", static_cast<double>(total.arena_bytes));
+}
+
+void BM_AddClause(benchmark::State& state) {
+    SATSolver::Formula formula = make_formula(static_cast<int>(state.range(0)), state.range(1), state.range(2));
+    double bytes = 0;
+    for (auto _ : state) {
+        SATSolver solver;
+        for (const auto& clause : formula) {
+            solver.add_clause(clause);
+        }
+        benchmark::DoNotOptimize(solver.get_num_clauses());
+        bytes = formula_bytes(solver);
+    }
+    state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations() * formula.size()));
+    report_memory(state, "arena_bytes", bytes);
+}
+BENCHMARK(BM_AddClause)->ArgNames({"n", "ratio", "seed"})->ArgsProduct({kVars, kRatios, kSeeds});
+
+void BM_IsSatisfiable(benchmark::State& state) {
+    SATSolver solver = make_solver(make_formula(static_cast<int>(state.range(0)), state.range(1), state.range(2)));
+    sat_solver::SolverStats total;
+    bool satisfiable = false;
+    for (auto _ : state) {
+        satisfiable = solver.is_satisfiable();
+        total += solver.get_stats();
+    }
+    report_stats(state, total);
+    state.counters["satisfiable"] = satisfiable;
+}
+BENCHMARK(BM_IsSatisfiable)
+    ->ArgNames({"n", "ratio", "seed"})
+    ->ArgsProduct({kVars, kRatios, kSeeds})
+    ->Unit(benchmark::kMicrosecond);
+
+void BM_CountModels(benchmark::State& state) {
+    // Enumeration with blocking clauses is only meant for small formulas
+    SATSolver solver = make_solver(make_formula(static_cast<int>(state.range(0)), state.range(1), state.range(2)));
+    std::uint64_t models = 0;
+    for (auto _ : state) {
+        models = solver.count_models();
+        benchmark::DoNotOptimize(models);
+    }
+    state.counters["models"] = static_cast<double>(models);
+    state.counters["models_per_second"] =
+        benchmark::Counter(static_cast<double>(models * state.iterations()), benchmark::Counter::kIsRate);
+    // The counting engine is internal: report the clause arena plus the one
+    // blocking clause over every variable that each model adds to it
+    report_memory(state, "arena_bytes",
+                  formula_bytes(solver) + static_cast<double>(models * solver.get_num_variables() * sizeof(int)));
+}
+BENCHMARK(BM_CountModels)
+    ->ArgNames({"n", "ratio", "seed"})
+    ->ArgsProduct({{10, 14, 18}, {200, 300, 426}, kSeeds})
+    ->Unit(benchmark::kMicrosecond);
+
+void BM_GenerateInstances(benchmark::State& state) {
+    sat_solver::utils::InstanceSpec spec;
+    spec.num_vars = static_cast<int>(state.range(0));
+    spec.num_clauses = static_cast<int>(spec.num_vars * state.range(1) / 100);
+    const std::size_t count = 1000;
+    std::vector<int> literals(count * spec.num_clauses * spec.k);
+    std::uint64_t seed = static_cast<std::uint64_t>(state.range(2));
+    for (auto _ : state) {
+        sat_solver::utils::generate_instances(spec, seed, count, literals.data(), nullptr, 1);
+        benchmark::DoNotOptimize(literals.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations() * count * spec.num_clauses));
+    state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations() * literals.size() * sizeof(int)));
+    report_memory(state, "buffer_bytes", static_cast<double>(literals.size() * sizeof(int)));
+}
+BENCHMARK(BM_GenerateInstances)
+    ->ArgNames({"n", "ratio", "seed"})
+    ->ArgsProduct({kVars, kRatios, {1}})
+    ->Unit(benchmark::kMicrosecond);
+
+} // namespace
+
+BENCHMARK_MAIN();
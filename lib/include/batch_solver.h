@@ -0,0 +1,59 @@
+#ifndef SAT_BATCH_SOLVER_H
+#define SAT_BATCH_SOLVER_H
+
+#include "sat_solver.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace sat_solver {
+
+/**
+ * Results of a batch solve, stored as flat arrays (one entry per formula).
+ */
+struct BatchResult {
+    std::vector<std::int8_t> status;          // SolveStatus of formula i: 1 SAT, 0 UNSAT, -1 UNKNOWN
+    std::vector<std::uint8_t> models;         // models of all formulas, one byte per variable
+    std::vector<std::int64_t> model_offsets;  // model i is models[offsets[i], offsets[i + 1])
+    std::vector<SolverStats> stats;           // solver counters of each formula
+
+    /**
+     * Get the number of formulas in the batch.
+     * @return Number of formulas
+     */
+    std::size_t size() const { return status.size(); }
+};
+
+/**
+ * Solve many independent formulas in parallel.
+ * @param formulas Formulas to solve
+ * @param num_threads Number of worker threads; 0 uses the hardware concurrency
+ * @param limits Budget applied to each formula separately; a cancel token stops the whole batch
+ * @return Per-formula status and models
+ */
+BatchResult solve_batch(const std::vector<SATSolver::Formula>& formulas, unsigned num_threads = 0,
+                        const SolveLimits& limits = SolveLimits());
+
+/**
+ * Solve a CSR batch of formulas in parallel.
+ * Clause c is literals[clause_offsets[c], clause_offsets[c + 1]) and formula f
+ * consists of clauses [formula_offsets[f], formula_offsets[f + 1]).
+ * @param literals Literals of all clauses of all formulas
+ * @param clause_offsets Clause boundaries into literals (one more than the number of clauses)
+ * @param formula_offsets Formula boundaries into the clause list (num_formulas + 1 entries)
+ * @param num_formulas Number of formulas in the batch
+ * @param num_threads Number of worker threads; 0 uses the hardware concurrency
+ * @param limits Budget applied to each formula separately; a cancel token stops the whole batch
+ * @return Per-formula status and models
+ * @throws std::invalid_argument if the offsets are not non-decreasing
+ */
+BatchResult solve_batch(const int* literals,
+                        const std::int64_t* clause_offsets,
+                        const std::int64_t* formula_offsets,
+                        std::size_t num_formulas,
+                        unsigned num_threads = 0,
+                        const SolveLimits& limits = SolveLimits());
+
+} // namespace sat_solver
+
+#endif // SAT_BATCH_SOLVER_H
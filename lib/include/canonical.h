@@ -0,0 +1,94 @@
+#ifndef SAT_CANONICAL_H
+#define SAT_CANONICAL_H
+
+#include "sat_solver.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace sat_solver {
+namespace utils {
+
+/**
+ * 128-bit content hash.
+ */
+struct Hash128 {
+    std::uint64_t low = 0;
+    std::uint64_t high = 0;
+
+    bool operator==(const Hash128& other) const { return low == other.low && high == other.high; }
+    bool operator!=(const Hash128& other) const { return !(*this == other); }
+
+    /**
+     * Format as 32 lowercase hex digits, high word first.
+     * @return Hex string
+     */
+    std::string hex() const;
+};
+
+/**
+ * Hash a byte buffer (MurmurHash3 x64 128).
+ * @param data Bytes to hash
+ * @param size Number of bytes
+ * @param seed Hash seed
+ * @return 128-bit hash
+ */
+Hash128 hash128(const void* data, std::size_t size, std::uint64_t seed = 0);
+
+/**
+ * Formula relabelled into a canonical form.
+ *
+ * Isomorphic inputs (same formula up to renaming variables, reordering
+ * clauses and reordering or repeating literals and clauses) produce the same
+ * literals, offsets and hash. Variable polarity is kept.
+ */
+struct CanonicalForm {
+    int num_vars = 0;                          // distinct variables, labelled 1..num_vars
+    std::vector<int> literals;                 // clauses sorted, literals sorted within clauses
+    std::vector<std::int64_t> clause_offsets;  // num_clauses + 1 entries, starting at 0
+    std::vector<int> var_map;                  // var_map[v] = canonical label of input variable v (0 if unused)
+    bool complete = true;   // false if the search budget ran out; the form is then a valid
+                            // relabelling but isomorphic inputs may map to different forms
+    Hash128 hash;           // hash of the canonical literals and offsets
+};
+
+/**
+ * Canonicalisation budget for result cache keys and SATSolver.canonical_hash()
+ * in Python. Every cached solve and count pays for the key, so a symmetric
+ * formula gives up early: an incomplete form is still an exact relabelling and
+ * only costs cache hits between isomorphic copies.
+ */
+constexpr std::uint64_t kCacheKeyWork = 1u << 20;
+
+/**
+ * Compute the canonical form of a CSR formula.
+ *
+ * Variables are coloured by refinement over the clause-variable graph
+ * (colour refinement / 1-WL). If that leaves cells with several variables,
+ * an individualisation-refinement search tries every variable of the first
+ * such cell and keeps the lexicographically smallest relabelled formula.
+ * Leaves with equal relabelled formulas yield automorphisms, which prune
+ * branches in the same orbit as explored ones.
+ * @param literals Literals of all clauses
+ * @param offsets Clause boundaries into literals (num_clauses + 1 entries, starting at 0)
+ * @param num_clauses Number of clauses
+ * @param max_work Literal visits refinement may spend before the search settles; the
+ *                 initial refinement always completes, so only symmetric formulas are affected
+ * @return Canonical form and hash
+ */
+CanonicalForm canonicalize(const int* literals, const std::int64_t* offsets, std::size_t num_clauses,
+                           std::uint64_t max_work = 1u << 26);
+
+/**
+ * Compute the canonical form of a formula.
+ * @param formula Clauses
+ * @param max_work Literal visits refinement may spend before the search settles
+ * @return Canonical form and hash
+ */
+CanonicalForm canonicalize(const SATSolver::Formula& formula, std::uint64_t max_work = 1u << 26);
+
+} // namespace utils
+} // namespace sat_solver
+
+#endif // SAT_CANONICAL_H
@@ -0,0 +1,240 @@
+#ifndef SAT_CDCL_SOLVER_H
+#define SAT_CDCL_SOLVER_H
+
+#include "solve_limits.h"
+#include "solver_stats.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace sat_solver {
+
+/**
+ * Conflict-driven clause learning engine behind SATSolver.
+ *
+ * Clauses live in a single flat arena of 32-bit words, propagation uses two
+ * watched literals with blocking literals, branching uses VSIDS with phase
+ * saving, restarts follow the Luby sequence and learned clauses are reduced
+ * by LBD and activity. Literals use the DIMACS convention at the interface
+ * (non-zero ints, negative for negation).
+ */
+class CDCLSolver {
+public:
+    CDCLSolver();
+
+    /**
+     * Make sure variables 1..num_vars exist.
+     * @param num_vars Highest variable index
+     */
+    void reserve_vars(int num_vars);
+
+    /**
+     * Add an original clause. Must be called between solves.
+     * @param literals Pointer to the clause literals
+     * @param size Number of literals
+     * @return false if the formula is now known to be unsatisfiable
+     */
+    bool add_clause(const int* literals, std::size_t size);
+
+    /**
+     * Search for a model consistent with the given assumptions.
+     * @param assumptions Literals forced true for this call only
+     * @param limits Conflict, propagation and time budget plus optional cancel token
+     * @return SAT or UNSAT under the assumptions, UNKNOWN if the budget ran out
+     */
+    SolveStatus solve(const std::vector<int>& assumptions = std::vector<int>(),
+                      const SolveLimits& limits = SolveLimits());
+
+    /**
+     * Get the model found by the last successful solve.
+     * @return Value of variables 1..n at index 0..n-1
+     */
+    const std::vector<bool>& get_model() const { return model_; }
+
+    /**
+     * Get the number of variables known to the engine.
+     * @return Number of variables
+     */
+    int get_num_variables() const { return static_cast<int>(level_.size()); }
+
+    /**
+     * Get the number of add_clause() calls the engine was built from.
+     * @return Number of input clauses
+     */
+    std::uint64_t get_input_clauses() const { return input_clauses_; }
+
+    /**
+     * Get the running hash of all input clauses, see hash_clause().
+     * @return Hash of the input clauses in order
+     */
+    std::uint64_t get_input_hash() const { return input_hash_; }
+
+    /**
+     * Extend an input hash by one clause. Starting from kInputHashSeed and
+     * hashing the clauses in order reproduces get_input_hash().
+     * @param hash Hash of the preceding clauses
+     * @param literals Pointer to the clause literals
+     * @param size Number of literals
+     * @return Hash including the clause
+     */
+    static std::uint64_t hash_clause(std::uint64_t hash, const int* literals, std::size_t size);
+
+    static constexpr std::uint64_t kInputHashSeed = 14695981039346656037ull;
+
+    /**
+     * Get the statistics accumulated over all solves.
+     * @return Statistics
+     */
+    const SolverStats& get_stats() const { return stats_; }
+
+    /**
+     * Serialise the complete search state between solves: the clause arena
+     * with learned clauses, top-level facts, activities, saved phases and
+     * statistics.
+     * @param out Receives the encoded state (native byte order)
+     */
+    void save_state(std::vector<std::uint8_t>& out) const;
+
+    /**
+     * Replace the state of the engine with one produced by save_state().
+     * Watch lists and the variable heap are rebuilt.
+     * @param data Encoded state
+     * @param size Number of bytes
+     * @throws std::runtime_error if the data is truncated or inconsistent
+     */
+    void load_state(const std::uint8_t* data, std::size_t size);
+
+private:
+    using Lit = std::uint32_t;   // 2 * var + sign, var 0-based, sign 1 = negated
+    using CRef = std::uint32_t;  // offset of a clause header in arena_
+
+    static constexpr Lit kNoLit = UINT32_MAX;
+    static constexpr CRef kNoReason = UINT32_MAX;
+    static constexpr std::uint32_t kHeaderWords = 3;   // size, flags/LBD, activity
+
+    struct Watcher {
+        CRef cref;
+        Lit blocker;  // some other literal of the clause; if true the clause is skipped
+    };
+
+    // Clause arena
+    std::vector<std::uint32_t> arena_;
+    std::vector<CRef> clauses_;
+    std::vector<CRef> learnts_;
+    std::size_t wasted_words_;
+
+    // Assignment
+    std::vector<std::vector<Watcher>> watches_;   // indexed by literal that became true
+    std::vector<std::int8_t> lit_value_;          // 1 true, -1 false, 0 unassigned
+    std::vector<int> level_;
+    std::vector<CRef> reason_;
+    std::vector<Lit> trail_;
+    std::vector<std::size_t> trail_lim_;
+    std::size_t qhead_;
+    bool ok_;
+
+    // Clauses the engine was built from, checked when a saved state is restored
+    std::uint64_t input_clauses_;
+    std::uint64_t input_hash_;
+
+    // Budget of the running solve, polled by propagate()
+    const CancelToken* cancel_;
+    std::uint64_t propagations_;
+    std::uint64_t propagation_limit_;
+    bool interrupted_;
+
+    // Heuristics
+    std::vector<double> activity_;
+    std::vector<int> heap_;          // binary max-heap of variables by activity
+    std::vector<int> heap_index_;    // position of each variable in heap_, -1 if absent
+    std::vector<bool> phase_;        // saved polarity: true means last assigned false
+    double var_inc_;
+    double clause_inc_;
+    std::uint64_t max_learnts_;
+
+    // Analysis scratch space
+    std::vector<std::uint8_t> seen_;
+    std::vector<Lit> analyze_stack_;
+    std::vector<Lit> analyze_toclear_;
+    std::vector<std::uint64_t> level_stamp_;
+    std::uint64_t stamp_;
+
+    std::vector<bool> model_;
+    SolverStats stats_;
+
+    static Lit to_lit(int dimacs) { return dimacs > 0 ? 2u * (dimacs - 1) : 2u * (-dimacs - 1) + 1; }
+    static Lit neg(Lit lit) { return lit ^ 1u; }
+    static int var(Lit lit) { return static_cast<int>(lit >> 1); }
+
+    std::int8_t value(Lit lit) const { return lit_value_[lit]; }
+    int decision_level() const { return static_cast<int>(trail_lim_.size()); }
+
+    std::uint32_t clause_size(CRef cr) const { return arena_[cr]; }
+    bool is_learnt(CRef cr) const { return arena_[cr + 1] & 1u; }
+    bool is_deleted(CRef cr) const { return arena_[cr + 1] & 2u; }
+    std::uint32_t clause_lbd(CRef cr) const { return arena_[cr + 1] >> 2; }
+    Lit* clause_lits(CRef cr) { return &arena_[cr + kHeaderWords]; }
+    float clause_activity(CRef cr) const;
+    void set_clause_activity(CRef cr, float activity);
+
+    /**
+     * Copy a clause into the arena and return its reference.
+     */
+    CRef alloc_clause(const std::vector<Lit>& lits, bool learnt, std::uint32_t lbd);
+
+    /**
+     * Watch the first two literals of a clause.
+     */
+    void attach_clause(CRef cr);
+
+    void enqueue(Lit lit, CRef reason);
+    void new_decision_level() { trail_lim_.push_back(trail_.size()); }
+    void cancel_until(int level);
+
+    /**
+     * Propagate all pending trail literals. Stops early and sets interrupted_
+     * when the cancel token fires or the propagation budget is used up.
+     * @return Conflicting clause, or kNoReason if none
+     */
+    CRef propagate();
+
+    /**
+     * First-UIP conflict analysis with recursive clause minimisation.
+     */
+    void analyze(CRef confl, std::vector<Lit>& learnt, int& backtrack_level, std::uint32_t& lbd);
+    bool lit_redundant(Lit lit, std::uint32_t abstract_levels);
+    std::uint32_t abstract_level(int v) const { return 1u << (level_[v] & 31); }
+
+    /**
+     * Pick the unassigned variable with the highest activity and its saved phase.
+     */
+    Lit pick_branch_literal();
+
+    void bump_var(int v);
+    void bump_clause(CRef cr);
+    void decay_activities();
+
+    // Variable order heap
+    bool heap_less(int a, int b) const { return activity_[a] > activity_[b]; }
+    void heap_insert(int v);
+    void heap_sift_up(std::size_t pos);
+    void heap_sift_down(std::size_t pos);
+    int heap_pop();
+
+    /**
+     * Delete about half of the learned clauses, keeping low-LBD and active ones.
+     * Only called at decision level 0.
+     */
+    void reduce_db();
+
+    /**
+     * Compact the arena after deletions and rebuild the watch lists.
+     */
+    void collect_garbage();
+
+    static double luby(double y, int x);
+};
+
+} // namespace sat_solver
+
+#endif // SAT_CDCL_SOLVER_H
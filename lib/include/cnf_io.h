@@ -0,0 +1,61 @@
+#ifndef SAT_CNF_IO_H
+#define SAT_CNF_IO_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace sat_solver {
+namespace utils {
+
+/**
+ * Formula in CSR form as stored in a binary CNF file.
+ */
+struct BinaryCNF {
+    int num_vars = 0;
+    std::vector<int> literals;
+    std::vector<std::int64_t> clause_offsets;   // num_clauses + 1 entries, starting at 0
+};
+
+/**
+ * Write a formula in the binary CNF format.
+ *
+ * Layout (native byte order): the magic "BCNF", a uint32 version (1), a
+ * uint32 variable count, a uint64 clause count, a uint64 literal count,
+ * the int64 clause offsets (clause count + 1) and finally the int32 literals.
+ * @param path Output file
+ * @param num_vars Number of variables
+ * @param literals Literals of all clauses
+ * @param offsets Clause boundaries into literals (num_clauses + 1 entries, starting at 0)
+ * @param num_clauses Number of clauses
+ * @throws std::runtime_error if the file cannot be written
+ */
+void write_binary_cnf(const std::string& path, int num_vars, const int* literals,
+                      const std::int64_t* offsets, std::size_t num_clauses);
+
+/**
+ * Write a fixed-width formula (clause i at [width*i, width*i + width)) in the binary CNF format.
+ * @param path Output file
+ * @param num_vars Number of variables
+ * @param literals num_clauses * width literals
+ * @param num_clauses Number of clauses
+ * @param width Literals per clause
+ * @throws std::runtime_error if the file cannot be written
+ */
+void write_binary_cnf(const std::string& path, int num_vars, const int* literals,
+                      std::size_t num_clauses, std::size_t width);
+
+/**
+ * Read a formula written by write_binary_cnf().
+ * @param path Input file
+ * @return Variable count, literals and clause offsets
+ * @throws std::runtime_error if the file is missing, truncated, not a binary CNF file or
+ *         larger or smaller than its header says
+ */
+BinaryCNF read_binary_cnf(const std::string& path);
+
+} // namespace utils
+} // namespace sat_solver
+
+#endif // SAT_CNF_IO_H
@@ -0,0 +1,187 @@
+#ifndef SAT_GENERATORS_H
+#define SAT_GENERATORS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace sat_solver {
+namespace utils {
+
+/**
+ * Counter-based random stream built on Philox4x32-10.
+ *
+ * The output depends only on (seed, stream, position), so instance i of a
+ * batch can be generated from stream i on any thread and the result is the
+ * same however the batch is split.
+ */
+class PhiloxStream {
+public:
+    /**
+     * @param seed 64-bit key shared by all streams of a run
+     * @param stream Index of the independent stream (e.g. the instance number)
+     */
+    PhiloxStream(std::uint64_t seed, std::uint64_t stream);
+
+    /**
+     * Get the next 32 random bits.
+     * @return Uniform 32-bit value
+     */
+    std::uint32_t next() {
+        if (index_ == 4) {
+            refill();
+        }
+        return buffer_[index_++];
+    }
+
+    /**
+     * Draw a uniform integer in [0, bound) without modulo bias (Lemire's method).
+     * @param bound Exclusive upper bound, must be positive
+     * @return Uniform value below bound
+     */
+    std::uint32_t uniform(std::uint32_t bound) {
+        std::uint64_t product = static_cast<std::uint64_t>(next()) * bound;
+        std::uint32_t low = static_cast<std::uint32_t>(product);
+        if (low < bound) {
+            std::uint32_t threshold = -bound % bound;
+            while (low < threshold) {
+                product = static_cast<std::uint64_t>(next()) * bound;
+                low = static_cast<std::uint32_t>(product);
+            }
+        }
+        return static_cast<std::uint32_t>(product >> 32);
+    }
+
+    /**
+     * Compute one Philox4x32-10 block.
+     * @param counter 128-bit counter as four words
+     * @param key 64-bit key as two words
+     * @param out Four output words
+     */
+    static void block(const std::uint32_t counter[4], const std::uint32_t key[2], std::uint32_t out[4]);
+
+private:
+    std::uint32_t key_[2];
+    std::uint32_t counter_[4];   // block index in words 0-1, stream in words 2-3
+    std::uint32_t buffer_[4];
+    unsigned index_;
+
+    void refill();
+};
+
+/**
+ * Families of random k-SAT instances.
+ */
+enum class InstanceKind {
+    UNIFORM,   // k distinct variables per clause, uniform signs
+    PLANTED,   // uniform clauses rejected if falsified by a hidden random assignment
+    REGULAR    // every variable occurs equally often (±1), half the time negated
+};
+
+/**
+ * Shape of the instances to generate.
+ */
+struct InstanceSpec {
+    InstanceKind kind = InstanceKind::UNIFORM;
+    int num_vars = 0;
+    int num_clauses = 0;
+    int k = 3;
+};
+
+/**
+ * Generate one instance into a flat row-major buffer (clause i at [k*i, k*i + k)).
+ * @param spec Instance family and shape
+ * @param seed Run seed
+ * @param stream Stream index of this instance
+ * @param literals Output buffer of spec.num_clauses * spec.k literals
+ * @param solution Output buffer of spec.num_vars planted values (0/1) for PLANTED; may be null
+ * @throws std::invalid_argument if k < 1, num_vars < k or num_clauses < 0
+ */
+void generate_instance(const InstanceSpec& spec, std::uint64_t seed, std::uint64_t stream,
+                       int* literals, std::uint8_t* solution = nullptr);
+
+/**
+ * Generate a batch of instances in parallel. Instance i uses stream i, so the
+ * output does not depend on num_threads.
+ * @param spec Instance family and shape
+ * @param seed Run seed
+ * @param count Number of instances
+ * @param literals Output buffer of count * num_clauses * k literals
+ * @param solutions Output buffer of count * num_vars planted values for PLANTED; may be null
+ * @param num_threads Number of worker threads; 0 uses the hardware concurrency
+ * @throws std::invalid_argument if the spec is invalid
+ */
+void generate_instances(const InstanceSpec& spec, std::uint64_t seed, std::size_t count,
+                        int* literals, std::uint8_t* solutions = nullptr, unsigned num_threads = 0);
+
+/**
+ * How clauses are accepted around the planted models.
+ */
+enum class PlantingMode {
+    FILTER,   // any clause satisfied by every planted model
+    QUIET     // additionally weight clauses by q^t (t = true literals under the first model) so
+              // literal polarities carry no hint of it; needs k >= 3
+};
+
+/**
+ * Shape of a planted-solution instance.
+ */
+struct PlantedSpec {
+    int num_vars = 0;
+    int num_clauses = 0;
+    int k = 3;
+    int num_solutions = 1;                       // models to draw for generate_planted_formula()
+    PlantingMode mode = PlantingMode::FILTER;
+    bool exact = false;   // add clauses until the planted models are the only models
+};
+
+/**
+ * Planted instance in CSR form together with its planted models.
+ */
+struct PlantedFormula {
+    int num_vars = 0;
+    std::vector<int> literals;
+    std::vector<std::int64_t> clause_offsets;   // num_clauses + 1 entries, starting at 0
+    std::vector<std::uint8_t> models;           // num_models rows of num_vars values (0/1)
+    std::size_t num_models = 0;
+    bool exact = false;   // true if the models are exactly the satisfying assignments
+};
+
+/**
+ * Generate clauses satisfied by every one of the given models.
+ *
+ * The first spec.num_clauses clauses have width k, unless the models are so
+ * dense that random width-k clauses keep missing one of them; such a clause
+ * cuts off an unplanted assignment instead and is widened as needed. With
+ * spec.exact set, the generator then keeps adding clauses that cut off any
+ * other model until the planted ones are the only models left, so the
+ * marked-state count of the result is known. Such cutting clauses have width
+ * k when a random one works and grow just enough to keep all planted models
+ * otherwise.
+ * @param spec Instance shape (num_solutions is ignored)
+ * @param models num_models rows of spec.num_vars values (0/1), all distinct
+ * @param num_models Number of models to plant
+ * @param seed Run seed
+ * @param stream Stream index of this instance
+ * @return Formula and planted models
+ * @throws std::invalid_argument if the spec is invalid, the models are not distinct, or
+ *         clauses are requested while every assignment is a model
+ */
+PlantedFormula plant_solutions(const PlantedSpec& spec, const std::uint8_t* models, std::size_t num_models,
+                               std::uint64_t seed, std::uint64_t stream = 0);
+
+/**
+ * Draw spec.num_solutions distinct random models and plant them (see plant_solutions()).
+ * @param spec Instance shape
+ * @param seed Run seed
+ * @param stream Stream index of this instance
+ * @return Formula and planted models
+ * @throws std::invalid_argument if the spec is invalid, asks for more than 2^num_vars models,
+ *         or asks for clauses with all 2^num_vars models
+ */
+PlantedFormula generate_planted_formula(const PlantedSpec& spec, std::uint64_t seed, std::uint64_t stream = 0);
+
+} // namespace utils
+} // namespace sat_solver
+
+#endif // SAT_GENERATORS_H
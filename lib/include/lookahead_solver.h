@@ -0,0 +1,213 @@
+#ifndef SAT_LOOKAHEAD_SOLVER_H
+#define SAT_LOOKAHEAD_SOLVER_H
+
+#include "solve_limits.h"
+#include "solver_stats.h"
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace sat_solver {
+
+/**
+ * Split of a formula into cubes by lookahead branching.
+ */
+struct CubeSplit {
+    SolveStatus status = SolveStatus::UNKNOWN;   // SAT if a model turned up while splitting,
+                                                 // UNSAT if every branch was refuted
+    std::vector<std::vector<int>> cubes;         // decision literals of each open leaf; empty
+                                                 // if UNKNOWN because the budget ran out
+    std::vector<bool> model;                     // model if status is SAT
+};
+
+/**
+ * March-style lookahead DPLL engine for small, dense random k-SAT.
+ *
+ * Binary clauses are kept as implication lists and ternary clauses as
+ * per-literal occurrence lists of the two other literals; longer clauses use
+ * two watched literals. At every node each preselected variable is looked
+ * ahead on in both polarities: failed literals are forced the other way,
+ * literals implied by both polarities are fixed, and the difference
+ * heuristic (number of ternary clauses reduced to binary) picks the branch
+ * variable. Literals whose lookahead reduces the formula by more than an
+ * adaptive trigger get a double lookahead that detects failures two levels
+ * deep. Search is chronological; there is no clause learning. Literals use
+ * the DIMACS convention at the interface.
+ */
+class LookaheadSolver {
+public:
+    LookaheadSolver();
+
+    /**
+     * Make sure variables 1..num_vars exist.
+     * @param num_vars Highest variable index
+     */
+    void reserve_vars(int num_vars);
+
+    /**
+     * Add an original clause. Must be called between solves.
+     * @param literals Pointer to the clause literals
+     * @param size Number of literals
+     * @return false if the formula is now known to be unsatisfiable
+     */
+    bool add_clause(const int* literals, std::size_t size);
+
+    /**
+     * Search for a model.
+     * @param limits Conflict (refuted node), propagation and time budget plus optional cancel token
+     * @return SAT or UNSAT, UNKNOWN if the budget ran out
+     */
+    SolveStatus solve(const SolveLimits& limits = SolveLimits());
+
+    /**
+     * Split the formula into cubes for parallel solving: branch with the
+     * lookahead heuristic down to the given depth and return the decision
+     * literals of every branch that was not refuted on the way.
+     * @param depth Number of branching levels
+     * @param limits Budget for the splitting itself
+     * @return Cubes, or a SAT/UNSAT verdict if splitting already decided the formula
+     */
+    CubeSplit split(int depth, const SolveLimits& limits = SolveLimits());
+
+    /**
+     * Get the model found by the last successful solve.
+     * @return Value of variables 1..n at index 0..n-1
+     */
+    const std::vector<bool>& get_model() const { return model_; }
+
+    /**
+     * Get the number of variables known to the engine.
+     * @return Number of variables
+     */
+    int get_num_variables() const { return num_vars_; }
+
+    /**
+     * Get the statistics accumulated over all solves.
+     * @return Statistics
+     */
+    const SolverStats& get_stats() const { return stats_; }
+
+private:
+    using Lit = std::uint32_t;   // 2 * var + sign, var 0-based, sign 1 = negated
+
+    static constexpr Lit kNoLit = UINT32_MAX;
+
+    struct Pair {
+        Lit first;
+        Lit second;
+    };
+
+    /**
+     * Open branch of the search: the trail length before the decision, the
+     * decision literal and whether its negation has been tried yet.
+     */
+    struct Branch {
+        std::size_t trail_size;
+        Lit lit;
+        bool flipped;
+    };
+
+    int num_vars_;
+    bool ok_;
+
+    // Clauses, indexed by the literal that has to become false to trigger them
+    std::vector<std::vector<Lit>> binaries_;           // clause (l, x): x for each binary clause containing l
+    std::vector<std::vector<Pair>> ternaries_;         // clause (l, x, y): (x, y)
+    std::vector<Lit> long_lits_;                       // clauses of four or more literals, back to back
+    std::vector<std::size_t> long_offsets_;
+    std::vector<std::vector<std::uint32_t>> watches_;  // long clauses watching each literal
+
+    // Assignment
+    std::vector<std::int8_t> value_;   // per literal: 1 true, -1 false, 0 unassigned
+    std::vector<Lit> trail_;
+    std::size_t qhead_;
+    std::size_t root_size_;            // trail length of the top-level facts
+
+    // Lookahead state
+    std::vector<double> diff_;         // reduction measured for each literal in the last lookahead
+    std::vector<std::uint32_t> occurrences_;   // clause occurrences per literal
+    std::vector<std::uint64_t> stamp_;
+    std::uint64_t stamp_counter_;
+    double double_trigger_;
+    std::vector<Lit> forced_;
+
+    // Budget of the running search, polled by propagate()
+    const CancelToken* cancel_;
+    std::uint64_t propagations_;
+    std::uint64_t propagation_limit_;
+    std::uint64_t conflicts_;
+    bool timed_;
+    std::chrono::steady_clock::time_point deadline_;
+    bool interrupted_;
+
+    std::vector<bool> model_;
+    SolverStats stats_;
+
+    static Lit to_lit(int dimacs) { return dimacs > 0 ? 2u * (dimacs - 1) : 2u * (-dimacs - 1) + 1; }
+    static int to_dimacs(Lit lit) { return lit & 1u ? -static_cast<int>(lit >> 1) - 1 : static_cast<int>(lit >> 1) + 1; }
+    static Lit neg(Lit lit) { return lit ^ 1u; }
+
+    std::int8_t value(Lit lit) const { return value_[lit]; }
+
+    void assign(Lit lit);
+    void undo_until(std::size_t trail_size);
+
+    /**
+     * Unit propagation over binary, ternary and long clauses.
+     * @param new_binaries If not null, receives the number of ternary clauses reduced to binary
+     * @return false on conflict
+     */
+    bool propagate(double* new_binaries = nullptr);
+
+    /**
+     * Assign a literal and propagate.
+     * @return false on conflict
+     */
+    bool assume(Lit lit, double* new_binaries = nullptr);
+
+    /**
+     * Pick the free variables worth looking ahead on.
+     */
+    void preselect(std::vector<int>& candidates) const;
+
+    /**
+     * Look ahead on every candidate, fixing failed and necessary literals
+     * until a fixpoint, and choose the branch literal.
+     * @param branch Receives the branch literal, or kNoLit if every variable is assigned
+     * @return false if the node is refuted
+     */
+    bool lookahead(Lit& branch);
+
+    /**
+     * Look ahead on every candidate below the literal currently assumed.
+     * @return true if the assumed literal fails
+     */
+    bool double_lookahead(const std::vector<int>& candidates);
+
+    /**
+     * Backtrack to the deepest branch whose second polarity is untried and
+     * take it.
+     * @return false if no such branch is left
+     */
+    bool backtrack(std::vector<Branch>& branches);
+
+    /**
+     * Count a refuted node.
+     */
+    void on_conflict();
+
+    void begin_search(const SolveLimits& limits);
+
+    /**
+     * Drop the limits of the search that is returning so later root
+     * propagation from add_clause() runs unbounded.
+     */
+    void end_search();
+
+    void record_model();
+};
+
+} // namespace sat_solver
+
+#endif // SAT_LOOKAHEAD_SOLVER_H
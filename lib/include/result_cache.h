@@ -0,0 +1,108 @@
+#ifndef SAT_RESULT_CACHE_H
+#define SAT_RESULT_CACHE_H
+
+#include "canonical.h"
+#include "solve_limits.h"
+#include "solver_stats.h"
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace sat_solver {
+
+/**
+ * Cached outcome for one formula, expressed over its canonical variables.
+ */
+struct CachedResult {
+    SolveStatus status = SolveStatus::UNKNOWN;   // UNKNOWN if only the model count is known
+    std::vector<bool> model;                     // model over canonical variables 1..n (SAT only)
+    std::int64_t model_count = -1;               // models over canonical variables, -1 if not counted
+    SolverStats stats;                           // counters of the run that produced the status
+};
+
+/**
+ * Persistent cache of solver results keyed by canonical formula hash.
+ *
+ * Entries are appended to a single file and never rewritten; a later entry
+ * for the same key supersedes the earlier one. The file is memory-mapped for
+ * reading and indexed in memory (key -> record offset), and the index is
+ * extended incrementally when other processes append. Readers hold a shared
+ * flock() and writers an exclusive one, so any number of processes may use
+ * the same file concurrently; within a process the cache is thread-safe.
+ * Records carry a checksum, and a torn record left by a crashed writer is
+ * truncated away by the next writer.
+ */
+class ResultCache {
+public:
+    /**
+     * Open or create a cache file.
+     * @param path Cache file
+     * @throws std::runtime_error if the file cannot be opened or is not a result cache
+     */
+    explicit ResultCache(const std::string& path);
+    ~ResultCache();
+
+    ResultCache(const ResultCache&) = delete;
+    ResultCache& operator=(const ResultCache&) = delete;
+
+    /**
+     * Look up the latest entry for a formula.
+     * @param key Canonical hash of the formula
+     * @param result Receives the entry if one exists
+     * @return true if the key was found
+     */
+    bool lookup(const utils::Hash128& key, CachedResult& result);
+
+    /**
+     * Record what is known about a formula. Fields left unknown (UNKNOWN
+     * status, negative model count) are filled from an existing entry; nothing
+     * is appended if the entry would not change.
+     * @param key Canonical hash of the formula
+     * @param result Status, model, model count and stats to record
+     * @throws std::runtime_error if the file cannot be written
+     */
+    void store(const utils::Hash128& key, const CachedResult& result);
+
+    /**
+     * Get the number of distinct formulas in the cache.
+     * @return Number of keys
+     */
+    std::size_t size();
+
+    /**
+     * Get the path of the cache file.
+     * @return Path given to the constructor
+     */
+    const std::string& path() const { return path_; }
+
+private:
+    struct KeyHash {
+        std::size_t operator()(const utils::Hash128& key) const { return static_cast<std::size_t>(key.low); }
+    };
+
+    std::string path_;
+    int fd_;
+    const std::uint8_t* map_;   // read-only mapping of the file, map_size_ bytes
+    std::size_t map_size_;
+    std::size_t scanned_;       // end of the last complete record indexed
+    std::unordered_map<utils::Hash128, std::size_t, KeyHash> index_;
+    std::mutex mutex_;
+
+    /**
+     * Map the file at its current size and index records appended since the
+     * last call. Requires the file lock.
+     */
+    void refresh();
+
+    /**
+     * Decode the record at a mapped offset.
+     */
+    CachedResult read_record(std::size_t offset) const;
+};
+
+} // namespace sat_solver
+
+#endif // SAT_RESULT_CACHE_H
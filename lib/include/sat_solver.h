@@ -1,11 +1,41 @@
 #ifndef SAT_SOLVER_H
 #define SAT_SOLVER_H
 
+#include "lookahead_solver.h"
+#include "solve_limits.h"
+#include "solver_stats.h"
+#include <csignal>
+#include <memory>
 #include <vector>
 #include <string>
+#include <cstddef>
+#include <cstdint>
 
 namespace sat_solver {
 
+class CDCLSolver;
+class ResultCache;
+
+/**
+ * Search engine used by SATSolver.
+ */
+enum class SolverMode {
+    CDCL,               // conflict-driven clause learning (default)
+    LOOKAHEAD,          // lookahead DPLL; strongest on small, dense random k-SAT
+    CUBE_AND_CONQUER    // lookahead splits into cubes, CDCL solves them in parallel
+};
+
+/**
+ * Outcome of a single solver run.
+ */
+struct SolveResult {
+    SolveStatus status = SolveStatus::UNKNOWN;
+    bool satisfiable = false;       // status == SolveStatus::SAT
+    std::vector<bool> assignment;   // model for variables 1..n, empty if unsatisfiable
+    SolverStats stats;              // counters of this run
+    bool cached = false;            // answered from the result cache without solving
+};
+
 /**
  * A simple SAT solver library for demonstration purposes.
  * This provides classical SAT solving utilities that can complement
@@ -22,9 +52,30 @@ public:
     /**
      * Add a clause to the SAT formula.
      * @param clause Vector of literals (positive for variable, negative for negation)
+     * @throws std::invalid_argument if a literal is 0 or INT_MIN
      */
     void add_clause(const Clause& clause);
     
+    /**
+     * Add a batch of clauses stored in CSR form.
+     * Clause i consists of literals[offsets[i]] .. literals[offsets[i + 1] - 1].
+     * @param literals Flat array of literals for all clauses
+     * @param offsets Clause boundaries into literals (num_clauses + 1 entries, starting at 0)
+     * @param num_clauses Number of clauses in the batch
+     * @throws std::invalid_argument if the offsets are not monotonically increasing from 0,
+     *         or a literal is 0 or INT_MIN
+     */
+    void add_clauses(const int* literals, const std::int64_t* offsets, std::size_t num_clauses);
+    
+    /**
+     * Add a batch of fixed-width clauses stored row by row.
+     * @param literals Flat array of num_clauses * width literals
+     * @param num_clauses Number of clauses in the batch
+     * @param width Number of literals per clause
+     * @throws std::invalid_argument if a literal is 0 or INT_MIN
+     */
+    void add_clauses(const int* literals, std::size_t num_clauses, std::size_t width);
+    
     /**
      * Clear all clauses from the formula.
      */
@@ -43,17 +94,154 @@ public:
     int get_num_clauses() const;
     
     /**
-     * Check if the current formula is satisfiable using a simple DPLL algorithm.
+     * Get the flat literal storage of all clauses (CSR values).
+     * @return Literals of every clause, back to back
+     */
+    const std::vector<int>& get_literals() const;
+    
+    /**
+     * Get the clause boundaries into get_literals() (CSR offsets).
+     * @return num_clauses + 1 offsets, the first being 0
+     */
+    const std::vector<std::size_t>& get_clause_offsets() const;
+    
+    /**
+     * Materialise the formula as a list of clauses.
+     * @return Copy of all clauses
+     */
+    Formula get_formula() const;
+    
+    /**
+     * Check if the current formula is satisfiable using the CDCL engine.
      * @return true if satisfiable, false otherwise
      */
     bool is_satisfiable();
     
+    /**
+     * Solve the current formula and return the verdict together with a model.
+     * @param limits Conflict, propagation and time budget plus optional cancel token
+     * @return Result holding the status and, if satisfiable, the assignment;
+     *         the status is UNKNOWN if the budget ran out first. A CDCL run
+     *         that ran out of budget is resumed by the next solve, whose stats
+     *         then include the earlier run.
+     */
+    SolveResult solve(const SolveLimits& limits = SolveLimits());
+    
+    /**
+     * Select the search engine.
+     * @param mode Engine to use for later solves
+     * @param num_threads Workers for CUBE_AND_CONQUER; 0 uses std::thread::hardware_concurrency()
+     */
+    void set_mode(SolverMode mode, unsigned num_threads = 0);
+    
+    /**
+     * Get the selected search engine.
+     * @return Engine used by solves
+     */
+    SolverMode get_mode() const;
+    
+    /**
+     * Split the formula into cubes with the lookahead heuristic.
+     * @param depth Number of branching levels
+     * @param limits Budget for the splitting
+     * @return Cubes (assumption literals) of the open branches, or a verdict if splitting decided the formula
+     */
+    CubeSplit generate_cubes(int depth, const SolveLimits& limits = SolveLimits()) const;
+    
     /**
      * Get a satisfying assignment if one exists.
      * @return Vector of boolean values for each variable (1-indexed)
      */
     std::vector<bool> get_satisfying_assignment();
     
+    /**
+     * Count the models of the formula over variables 1..get_num_variables()
+     * by enumeration with blocking clauses. Intended for small formulas.
+     * Complete counts are looked up in and added to the attached result cache.
+     * @param limit Stop once this many models were found; 0 counts all
+     * @return Number of models found (at most limit if limit > 0)
+     */
+    std::uint64_t count_models(std::uint64_t limit = 0) const;
+    
+    /**
+     * Attach a persistent result cache. While attached, solves and full model
+     * counts of a formula isomorphic to one already in the cache are answered
+     * from it without running the engine, and new results are added to it.
+     * @param cache Cache to use, or nullptr to detach
+     */
+    void set_cache(std::shared_ptr<ResultCache> cache);
+    
+    /**
+     * Get the attached result cache.
+     * @return Cache, or nullptr if none is attached
+     */
+    const std::shared_ptr<ResultCache>& get_cache() const;
+    
+    /**
+     * Encode the formula and any interrupted CDCL engine into a compact
+     * binary buffer (the checkpoint format), e.g. for pickling.
+     * @param out Receives the encoded solver
+     */
+    void serialize(std::vector<std::uint8_t>& out) const;
+    
+    /**
+     * Replace the formula and engine state with ones encoded by serialize().
+     * The mode, cache and signal settings are left alone.
+     * @param data Encoded solver
+     * @param size Number of bytes
+     * @throws std::runtime_error if the data is truncated or corrupt
+     */
+    void deserialize(const std::uint8_t* data, std::size_t size);
+    
+    /**
+     * Write a checkpoint: the formula and, if the last CDCL run stopped on its
+     * budget, the state of its engine (clause arena with learned clauses,
+     * activities, saved phases and top-level facts). The file is written
+     * under a temporary name and renamed into place, so an existing
+     * checkpoint is never left half-written.
+     * @param path Checkpoint file
+     * @throws std::runtime_error if the file cannot be written
+     */
+    void checkpoint(const std::string& path) const;
+    
+    /**
+     * Replace the formula with the one in a checkpoint. If the checkpoint
+     * holds an interrupted engine, the next CDCL solve resumes its search
+     * instead of starting over; its stats then cover the whole search.
+     * @param path Checkpoint file written by checkpoint()
+     * @throws std::runtime_error if the file cannot be read or is corrupt
+     */
+    void restore(const std::string& path);
+    
+    /**
+     * Checkpoint on a signal: installs a process-wide handler for the signal
+     * that stops every running solve of a solver armed this way. Such a solve
+     * returns UNKNOWN after writing a checkpoint to the given path. The
+     * request stays pending, so later armed solves stop immediately too,
+     * until reset_checkpoint_signal() is called.
+     * @param path Checkpoint file, or empty to disarm this solver
+     * @param signum Signal to handle (the handler stays installed)
+     * @throws std::runtime_error if the handler cannot be installed
+     */
+    void checkpoint_on_signal(const std::string& path, int signum = SIGTERM);
+    
+    /**
+     * Check whether a checkpoint signal arrived since the last reset.
+     * @return true if a handled signal is pending
+     */
+    static bool checkpoint_signal_pending();
+    
+    /**
+     * Forget a pending checkpoint signal so armed solves can run again.
+     */
+    static void reset_checkpoint_signal();
+    
+    /**
+     * Get the statistics of the last solver run.
+     * @return Counters and phase timings; all zero if stats are compiled out
+     */
+    const SolverStats& get_stats() const;
+    
     /**
      * Convert the formula to a string representation.
      * @return String representation of the formula
@@ -67,35 +255,49 @@ public:
     bool is_3sat() const;
 
 private:
-    Formula formula_;
+    std::vector<int> literals_;               // clause arena: all literals, back to back
+    std::vector<std::size_t> clause_offsets_; // clause i is literals_[offsets[i], offsets[i + 1])
     int num_variables_;
     std::vector<bool> assignment_;
     bool has_satisfying_assignment_;
+    SolverStats stats_;
+    std::shared_ptr<ResultCache> cache_;
+    bool from_cache_;                         // last run() was answered by cache_
+    SolverMode mode_;
+    unsigned num_threads_;
+    std::shared_ptr<CDCLSolver> engine_;      // CDCL engine stopped by its budget, resumed by the next run;
+                                              // shared copy-on-write between copies of the solver
+    std::size_t engine_clauses_;              // clauses already loaded into engine_
+    std::string checkpoint_path_;             // written when a checkpoint signal stops a run
     
     /**
-     * Simple DPLL solver implementation.
+     * Run the selected engine on the formula (or consult the cache) and record the model and stats.
      */
-    bool dpll(Formula& formula, std::vector<bool>& assignment, int var);
+    SolveStatus run(const SolveLimits& limits);
     
     /**
-     * Unit propagation step.
+     * Process-wide token cancelled by the checkpoint signal handler.
      */
-    bool unit_propagate(Formula& formula, std::vector<bool>& assignment);
+    static const std::shared_ptr<CancelToken>& checkpoint_signal();
     
     /**
-     * Pure literal elimination.
+     * Load the clause arena into an engine.
+     * @param first_clause Index of the first clause to load
+     * @return false if the engine found the formula unsatisfiable while loading
      */
-    bool pure_literal_eliminate(Formula& formula, std::vector<bool>& assignment);
+    template <typename Engine>
+    bool load(Engine& engine, std::size_t first_clause = 0) const;
     
     /**
-     * Choose next variable for branching.
+     * Split with lookahead and solve the cubes on parallel CDCL engines; the
+     * first satisfiable cube cancels the others.
      */
-    int choose_variable(const Formula& formula);
+    SolveStatus run_cube_and_conquer(const SolveLimits& limits, std::vector<bool>& model);
     
     /**
-     * Simplify formula given an assignment.
+     * Update bookkeeping after literals_[first, end) were appended.
      */
-    void simplify(Formula& formula, const std::vector<bool>& assignment);
+    void on_literals_added(std::size_t first);
 };
 
 /**
@@ -103,20 +305,51 @@ private:
  */
 namespace utils {
     /**
-     * Generate a random 3-SAT formula.
-     * @param num_vars Number of variables
+     * Generate a random 3-SAT formula with three distinct variables per clause.
+     * Seeded from std::random_device; use the seeded overload for reproducible runs.
+     * @param num_vars Number of variables (at least 3)
      * @param num_clauses Number of clauses
      * @return Random 3-SAT formula
      */
     SATSolver::Formula generate_random_3sat(int num_vars, int num_clauses);
     
     /**
-     * Check if two formulas are equivalent.
+     * Generate a reproducible random 3-SAT formula (see generators.h for other families).
+     * @param num_vars Number of variables (at least 3)
+     * @param num_clauses Number of clauses
+     * @param seed Seed of the Philox stream
+     * @return Random 3-SAT formula
+     */
+    SATSolver::Formula generate_random_3sat(int num_vars, int num_clauses, std::uint64_t seed);
+    
+    /**
+     * Generate a random 3-SAT formula as a flat row-major array.
+     * @param num_vars Number of variables (at least 3)
+     * @param num_clauses Number of clauses
+     * @param seed Seed of the Philox stream
+     * @return num_clauses * 3 literals, clause i at [3i, 3i + 3)
+     */
+    std::vector<int> generate_random_3sat_flat(int num_vars, int num_clauses, std::uint64_t seed);
+    
+    /**
+     * Draw a fresh seed from std::random_device.
+     * @return 64-bit seed
+     */
+    std::uint64_t random_seed();
+    
+    /**
+     * Check if two formulas have exactly the same models over the union of their variables.
+     * Up to 20 variables both formulas are evaluated on every assignment, 64 at a
+     * time with bit-sliced clause evaluation. Beyond that a miter is used: every
+     * clause of one formula must be implied by the other, checked by solving the
+     * other formula under the negated clause as assumptions. Both run in parallel.
      * @param f1 First formula
      * @param f2 Second formula
+     * @param num_threads Number of worker threads; 0 uses the hardware concurrency
      * @return true if equivalent
+     * @throws std::invalid_argument if either formula has a 0 or INT_MIN literal
      */
-    bool are_equivalent(const SATSolver::Formula& f1, const SATSolver::Formula& f2);
+    bool are_equivalent(const SATSolver::Formula& f1, const SATSolver::Formula& f2, unsigned num_threads = 0);
 }
 
 } // namespace sat_solver
@@ -0,0 +1,105 @@
+#ifndef SAT_SHARED_FORMULA_H
+#define SAT_SHARED_FORMULA_H
+
+#include "sat_solver.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace sat_solver {
+
+/**
+ * Formula published in a POSIX shared-memory segment so that other
+ * processes can map it read-only instead of receiving a copy.
+ *
+ * The segment holds a small header followed by the clause arena in CSR form
+ * (int64 clause offsets, int32 literals). The creating process owns the name
+ * and removes it when its object is destroyed; processes that attached keep
+ * their mapping until they release it.
+ */
+class SharedFormula {
+public:
+    /**
+     * Copy the formula of a solver into a new shared-memory segment.
+     * @param solver Solver whose clauses are published
+     * @param name Segment name ("/name"); empty picks a unique one
+     * @return Owning handle
+     * @throws std::runtime_error if the segment cannot be created
+     */
+    static std::shared_ptr<SharedFormula> create(const SATSolver& solver, const std::string& name = "");
+
+    /**
+     * Map an existing segment read-only.
+     * @param name Segment name given by name() of the owner
+     * @return Non-owning handle
+     * @throws std::runtime_error if the segment does not exist or is not a shared formula
+     */
+    static std::shared_ptr<SharedFormula> attach(const std::string& name);
+
+    ~SharedFormula();
+
+    SharedFormula(const SharedFormula&) = delete;
+    SharedFormula& operator=(const SharedFormula&) = delete;
+
+    /**
+     * Get the segment name to pass to attach().
+     * @return Name starting with '/'
+     */
+    const std::string& name() const { return name_; }
+
+    /**
+     * Check whether this handle created the segment and will remove its name.
+     * @return true for handles returned by create()
+     */
+    bool owner() const { return owner_; }
+
+    /**
+     * Get the number of variables of the formula.
+     * @return Highest variable index
+     */
+    int get_num_variables() const;
+
+    /**
+     * Get the number of clauses of the formula.
+     * @return Number of clauses
+     */
+    std::size_t get_num_clauses() const;
+
+    /**
+     * Get the total number of literals of the formula.
+     * @return Number of literals
+     */
+    std::size_t get_num_literals() const;
+
+    /**
+     * Get the clause boundaries (num_clauses + 1 entries) in the mapping.
+     * @return Pointer into shared memory
+     */
+    const std::int64_t* offsets() const;
+
+    /**
+     * Get the literals of all clauses, back to back, in the mapping.
+     * @return Pointer into shared memory
+     */
+    const int* literals() const;
+
+    /**
+     * Build a solver holding the formula.
+     * @return Solver with a private copy of the clauses
+     */
+    SATSolver to_solver() const;
+
+private:
+    SharedFormula(const std::string& name, bool owner, void* map, std::size_t size);
+
+    std::string name_;
+    bool owner_;
+    int owner_pid_;               // process that may remove the name
+    const std::uint8_t* map_;
+    std::size_t map_size_;
+};
+
+} // namespace sat_solver
+
+#endif // SAT_SHARED_FORMULA_H
@@ -0,0 +1,94 @@
+#ifndef SAT_SOLVE_LIMITS_H
+#define SAT_SOLVE_LIMITS_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+namespace sat_solver {
+
+/**
+ * Verdict of a bounded solver run.
+ */
+enum class SolveStatus : std::int8_t {
+    UNSAT = 0,
+    SAT = 1,
+    UNKNOWN = -1   // a budget ran out or the run was cancelled
+};
+
+/**
+ * Flag that asks running solves to stop. Safe to set from any thread; the
+ * solver polls it in the propagation loop and returns UNKNOWN. A token may
+ * have up to two parents, in which case it also reports their cancellation.
+ */
+class CancelToken {
+public:
+    CancelToken() : cancelled_(false) {}
+
+    /**
+     * Create a child token, e.g. to stop the losers of a parallel search
+     * without touching the caller's token.
+     * @param parent Token whose cancellation is inherited (may be null)
+     */
+    explicit CancelToken(std::shared_ptr<const CancelToken> parent)
+        : cancelled_(false), parent_(std::move(parent)) {}
+
+    /**
+     * Create a token that fires when either parent does, e.g. to combine the
+     * caller's token with a process-wide one.
+     * @param parent First token whose cancellation is inherited (may be null)
+     * @param other_parent Second token whose cancellation is inherited (may be null)
+     */
+    CancelToken(std::shared_ptr<const CancelToken> parent, std::shared_ptr<const CancelToken> other_parent)
+        : cancelled_(false), parent_(std::move(parent)), other_parent_(std::move(other_parent)) {}
+
+    CancelToken(const CancelToken&) = delete;
+    CancelToken& operator=(const CancelToken&) = delete;
+
+    /**
+     * Request cancellation of every solve watching this token.
+     */
+    void cancel() { cancelled_.store(true, std::memory_order_relaxed); }
+
+    /**
+     * Clear the flag so the token can be reused. Parents' flags are left alone.
+     */
+    void reset() { cancelled_.store(false, std::memory_order_relaxed); }
+
+    /**
+     * Check whether cancellation was requested.
+     * @return true once cancel() has been called on this token or a parent
+     */
+    bool cancelled() const {
+        return cancelled_.load(std::memory_order_relaxed) || (parent_ && parent_->cancelled()) ||
+               (other_parent_ && other_parent_->cancelled());
+    }
+
+private:
+    std::atomic<bool> cancelled_;
+    std::shared_ptr<const CancelToken> parent_;
+    std::shared_ptr<const CancelToken> other_parent_;
+};
+
+/**
+ * Resource budget for one solve. Zero means unlimited.
+ */
+struct SolveLimits {
+    std::uint64_t max_conflicts = 0;
+    std::uint64_t max_propagations = 0;
+    double max_seconds = 0.0;
+    std::shared_ptr<const CancelToken> cancel;   // optional
+
+    /**
+     * Check whether no limit is set.
+     * @return true if the run is unbounded and cannot be cancelled
+     */
+    bool unlimited() const {
+        return max_conflicts == 0 && max_propagations == 0 && max_seconds <= 0.0 && !cancel;
+    }
+};
+
+} // namespace sat_solver
+
+#endif // SAT_SOLVE_LIMITS_H
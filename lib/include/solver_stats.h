@@ -0,0 +1,85 @@
+#ifndef SAT_SOLVER_STATS_H
+#define SAT_SOLVER_STATS_H
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+/**
+ * Statistics collection is compiled in unless SAT_SOLVER_STATS is defined to 0
+ * (CMake option SAT_SOLVER_ENABLE_STATS). When disabled the counters stay at
+ * zero and the instrumentation in the solver compiles to nothing.
+ */
+#ifndef SAT_SOLVER_STATS
+#define SAT_SOLVER_STATS 1
+#endif
+
+#if SAT_SOLVER_STATS
+#define SAT_STAT_ADD(stats, field, amount) ((stats).field += (amount))
+#else
+#define SAT_STAT_ADD(stats, field, amount) ((void)0)
+#endif
+
+namespace sat_solver {
+
+/**
+ * Counters describing what a solver run did.
+ */
+struct SolverStats {
+    std::uint64_t decisions = 0;
+    std::uint64_t propagations = 0;       // literals propagated from the trail
+    std::uint64_t conflicts = 0;
+    std::uint64_t restarts = 0;
+    std::uint64_t learned_clauses = 0;
+    std::uint64_t deleted_clauses = 0;
+    std::uint64_t arena_bytes = 0;        // bytes held by the clause arena at the end of the run
+    double propagate_seconds = 0.0;
+    double analyze_seconds = 0.0;
+    double reduce_seconds = 0.0;
+    double total_seconds = 0.0;
+
+    /**
+     * Reset all counters to zero.
+     */
+    void reset() { *this = SolverStats(); }
+
+    /**
+     * Accumulate the counters of another run; arena_bytes keeps the maximum.
+     */
+    SolverStats& operator+=(const SolverStats& other);
+
+    /**
+     * Format the counters as DIMACS comment lines ("c stats <name>: <value>").
+     * @return One comment line per counter, each terminated by a newline
+     */
+    std::string to_dimacs_comments() const;
+};
+
+/**
+ * Adds the wall time of its scope to a SolverStats field.
+ */
+class PhaseTimer {
+public:
+#if SAT_SOLVER_STATS
+    explicit PhaseTimer(double& target)
+        : target_(target), start_(std::chrono::steady_clock::now()) {}
+    ~PhaseTimer() {
+        target_ += std::chrono::duration<double>(std::chrono::steady_clock::now() - start_).count();
+    }
+#else
+    explicit PhaseTimer(double&) {}
+#endif
+
+    PhaseTimer(const PhaseTimer&) = delete;
+    PhaseTimer& operator=(const PhaseTimer&) = delete;
+
+#if SAT_SOLVER_STATS
+private:
+    double& target_;
+    std::chrono::steady_clock::time_point start_;
+#endif
+};
+
+} // namespace sat_solver
+
+#endif // SAT_SOLVER_STATS_H
@@ -0,0 +1,113 @@
+#ifndef SAT_THREAD_POOL_H
+#define SAT_THREAD_POOL_H
+
+#include "solve_limits.h"
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace sat_solver {
+
+/**
+ * Fixed-size pool of worker threads executing queued tasks in FIFO order.
+ * Used to run solver calls in the background without blocking the caller.
+ */
+class ThreadPool {
+public:
+    using Task = std::function<void()>;
+
+    /**
+     * Start the worker threads.
+     * @param num_threads Number of workers; 0 uses std::thread::hardware_concurrency()
+     */
+    explicit ThreadPool(unsigned num_threads = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    /**
+     * Queue a task for execution. Exceptions escaping the task are swallowed.
+     * Exactly one of task and on_drop runs: on_drop instead of task if the pool
+     * is already shut down or shuts down before the task starts, e.g. to
+     * cancel a future the task would have resolved.
+     * @param task Callable to run on a worker thread
+     * @param on_drop Optional callable run on the submitting or shutting-down thread
+     */
+    void submit(Task task, Task on_drop = Task());
+
+    /**
+     * Get the number of worker threads.
+     * @return Number of workers
+     */
+    unsigned size() const;
+
+    /**
+     * Drop all tasks that have not started yet, running their on_drop
+     * callbacks, and join the workers. Running tasks are allowed to finish.
+     * Later submissions are dropped.
+     * @param cancel_running Also fire cancel_token() so running solves stop early
+     */
+    void shutdown(bool cancel_running = false);
+
+    /**
+     * Get the token fired by shutdown(true). Tasks that solve should watch it
+     * next to their own token.
+     * @return Pool-wide cancel token
+     */
+    const std::shared_ptr<CancelToken>& cancel_token() const { return cancel_; }
+
+    /**
+     * Get the process-wide pool, creating it on first use. A forked child
+     * starts with a fresh pool; the parent's, whose workers do not exist in
+     * the child, is abandoned.
+     * @return Shared pool sized to the hardware concurrency
+     */
+    static ThreadPool& shared();
+
+    /**
+     * Cancel the running tasks of the process-wide pool and shut it down, if
+     * it was ever created.
+     */
+    static void shutdown_shared();
+
+private:
+    struct Job {
+        Task task;
+        Task on_drop;
+    };
+
+    std::vector<std::thread> workers_;
+    std::deque<Job> jobs_;
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    bool stopping_;
+    std::shared_ptr<CancelToken> cancel_;
+
+    /**
+     * Worker loop: pop and run tasks until shutdown.
+     */
+    void run();
+};
+
+/**
+ * Run body(i) for every i in [0, count) on a set of dedicated worker threads.
+ * Each worker starts with an equal slice of the index range and, once it runs
+ * dry, steals the upper half of the largest remaining slice, so uneven task
+ * costs are balanced without a shared queue. The calling thread takes part as
+ * worker 0. The first exception thrown by body is rethrown after all workers
+ * have stopped.
+ * @param count Number of indices to process
+ * @param num_threads Number of workers; 0 uses std::thread::hardware_concurrency()
+ * @param body Callable invoked once per index
+ */
+void parallel_for(std::size_t count, unsigned num_threads, const std::function<void(std::size_t)>& body);
+
+} // namespace sat_solver
+
+#endif // SAT_THREAD_POOL_H
@@ -0,0 +1,92 @@
+#include "batch_solver.h"
+#include "thread_pool.h"
+#include <stdexcept>
+
+namespace sat_solver {
+
+namespace {
+
+/**
+ * Pack per-formula results into the flat batch layout.
+ */
+BatchResult collect(std::vector<SolveResult>& results) {
+    BatchResult batch;
+    batch.status.resize(results.size());
+    batch.stats.resize(results.size());
+    batch.model_offsets.resize(results.size() + 1, 0);
+
+    for (std::size_t i = 0; i < results.size(); ++i) {
+        batch.status[i] = static_cast<std::int8_t>(results[i].status);
+        batch.stats[i] = results[i].stats;
+        batch.model_offsets[i + 1] = batch.model_offsets[i] + results[i].assignment.size();
+    }
+
+    batch.models.resize(batch.model_offsets.back());
+    for (std::size_t i = 0; i < results.size(); ++i) {
+        std::uint8_t* out = batch.models.data() + batch.model_offsets[i];
+        for (bool value : results[i].assignment) {
+            *out++ = value;
+        }
+        results[i].assignment = std::vector<bool>();
+    }
+
+    return batch;
+}
+
+} // namespace
+
+BatchResult solve_batch(const std::vector<SATSolver::Formula>& formulas, unsigned num_threads,
+                        const SolveLimits& limits) {
+    std::vector<SolveResult> results(formulas.size());
+
+    parallel_for(formulas.size(), num_threads, [&](std::size_t i) {
+        SATSolver solver;
+        for (const auto& clause : formulas[i]) {
+            solver.add_clause(clause);
+        }
+        results[i] = solver.solve(limits);
+    });
+
+    return collect(results);
+}
+
+BatchResult solve_batch(const int* literals,
+                        const std::int64_t* clause_offsets,
+                        const std::int64_t* formula_offsets,
+                        std::size_t num_formulas,
+                        unsigned num_threads,
+                        const SolveLimits& limits) {
+    for (std::size_t f = 0; f < num_formulas; ++f) {
+        if (formula_offsets[f + 1] < formula_offsets[f] || formula_offsets[f] < 0) {
+            throw std::invalid_argument("Formula offsets must be non-decreasing");
+        }
+    }
+    std::int64_t num_clauses = num_formulas > 0 ? formula_offsets[num_formulas] : 0;
+    for (std::int64_t c = 0; c < num_clauses; ++c) {
+        if (clause_offsets[c + 1] < clause_offsets[c] || clause_offsets[c] < 0) {
+            throw std::invalid_argument("Clause offsets must be non-decreasing");
+        }
+    }
+
+    std::vector<SolveResult> results(num_formulas);
+
+    parallel_for(num_formulas, num_threads, [&](std::size_t f) {
+        std::int64_t first = formula_offsets[f];
+        std::int64_t count = formula_offsets[f + 1] - first;
+        std::int64_t base = clause_offsets[first];
+
+        // Rebase this formula's clause offsets so they start at 0
+        std::vector<std::int64_t> offsets(count + 1);
+        for (std::int64_t c = 0; c <= count; ++c) {
+            offsets[c] = clause_offsets[first + c] - base;
+        }
+
+        SATSolver solver;
+        solver.add_clauses(literals + base, offsets.data(), count);
+        results[f] = solver.solve(limits);
+    });
+
+    return collect(results);
+}
+
+} // namespace sat_solver
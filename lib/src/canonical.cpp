@@ -0,0 +1,447 @@
+#include "canonical.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <numeric>
+#include <utility>
+
+namespace sat_solver {
+namespace utils {
+
+namespace {
+
+/**
+ * Clause-variable incidence graph over the variables that occur, indexed 0..n-1.
+ */
+struct ClauseGraph {
+    int num_vars = 0;
+    std::vector<std::vector<std::pair<int, int>>> clauses;       // (variable, negated) per clause
+    std::vector<std::vector<std::pair<int, int>>> occurrences;   // (clause, negated) per variable
+};
+
+using Codes = std::vector<std::vector<int>>;   // clauses of literal codes 2 * label + negated
+
+/**
+ * Replace each signature by its dense rank in sorted order.
+ * @return Number of distinct signatures
+ */
+int dense_rank(const std::vector<std::vector<long long>>& signatures, std::vector<int>& ranks) {
+    std::vector<int> order(signatures.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&](int a, int b) { return signatures[a] < signatures[b]; });
+
+    ranks.resize(signatures.size());
+    int rank = -1;
+    for (std::size_t i = 0; i < order.size(); ++i) {
+        if (i == 0 || signatures[order[i]] != signatures[order[i - 1]]) {
+            ++rank;
+        }
+        ranks[order[i]] = rank;
+    }
+    return rank + 1;
+}
+
+class Canonizer {
+public:
+    Canonizer(const ClauseGraph& graph, std::uint64_t max_work)
+        : graph_(graph), max_work_(max_work), work_(0), complete_(true) {}
+
+    /**
+     * Run the search from the uniform colouring.
+     * @return Variable labels of the best leaf
+     */
+    std::vector<int> run() {
+        search(std::vector<int>(graph_.num_vars, 0));
+        return best_labels_;
+    }
+
+    const Codes& best_codes() const { return best_codes_; }
+    bool complete() const { return complete_; }
+
+private:
+    const ClauseGraph& graph_;
+    std::uint64_t max_work_;
+    std::uint64_t work_;   // literal visits spent in refinement so far
+    bool complete_;
+    Codes best_codes_;
+    std::vector<int> best_labels_;
+    Codes first_codes_;
+    std::vector<int> first_labels_;
+    std::vector<int> first_path_;
+    std::vector<int> best_path_;
+    std::vector<std::vector<int>> automorphisms_;   // found by comparing equal leaves
+    std::vector<int> path_;                         // variables individualised above the current node
+    std::size_t jump_ = kNoJump;                    // depth to return to after finding an automorphism
+
+    static constexpr std::size_t kNoJump = static_cast<std::size_t>(-1);
+    std::vector<std::vector<long long>> clause_signatures_;
+    std::vector<std::vector<long long>> var_signatures_;
+    std::vector<int> clause_colours_;
+
+    /**
+     * Colour refinement: recolour clauses by the colours and signs of their
+     * variables, then variables by their own colour and the colours and signs
+     * of their clauses, until the number of variable cells stops growing.
+     * @return Number of variable cells
+     */
+    int refine(std::vector<int>& colours) {
+        std::uint64_t round_work = graph_.num_vars;
+        for (const auto& clause : graph_.clauses) {
+            round_work += 2 * clause.size();
+        }
+        clause_signatures_.resize(graph_.clauses.size());
+        var_signatures_.resize(graph_.num_vars);
+
+        for (int v = 0; v < graph_.num_vars; ++v) {
+            var_signatures_[v].assign(1, colours[v]);
+        }
+        int cells = dense_rank(var_signatures_, colours);
+
+        std::vector<int> next;
+        for (;;) {
+            work_ += round_work;
+            for (std::size_t c = 0; c < graph_.clauses.size(); ++c) {
+                auto& signature = clause_signatures_[c];
+                signature.clear();
+                for (const auto& lit : graph_.clauses[c]) {
+                    signature.push_back(2LL * colours[lit.first] + lit.second);
+                }
+                std::sort(signature.begin(), signature.end());
+            }
+            dense_rank(clause_signatures_, clause_colours_);
+
+            for (int v = 0; v < graph_.num_vars; ++v) {
+                auto& signature = var_signatures_[v];
+                signature.clear();
+                for (const auto& occ : graph_.occurrences[v]) {
+                    signature.push_back(2LL * clause_colours_[occ.first] + occ.second);
+                }
+                std::sort(signature.begin(), signature.end());
+                signature.insert(signature.begin(), colours[v]);
+            }
+            int refined = dense_rank(var_signatures_, next);
+            colours.swap(next);
+            if (refined == cells) {
+                return cells;
+            }
+            cells = refined;
+        }
+    }
+
+    void leaf(const std::vector<int>& labels) {
+        Codes codes;
+        codes.reserve(graph_.clauses.size());
+        for (const auto& clause : graph_.clauses) {
+            std::vector<int> lits;
+            lits.reserve(clause.size());
+            for (const auto& lit : clause) {
+                lits.push_back(2 * labels[lit.first] + lit.second);
+            }
+            std::sort(lits.begin(), lits.end());
+            codes.push_back(std::move(lits));
+        }
+        std::sort(codes.begin(), codes.end());
+
+        if (best_labels_.empty()) {
+            first_codes_ = codes;
+            first_labels_ = labels;
+            first_path_ = path_;
+            best_codes_.swap(codes);
+            best_labels_ = labels;
+            best_path_ = path_;
+        } else if (codes == best_codes_) {
+            add_automorphism(best_labels_, best_path_, labels);
+        } else if (codes == first_codes_) {
+            add_automorphism(first_labels_, first_path_, labels);
+        } else if (codes < best_codes_) {
+            best_codes_.swap(codes);
+            best_labels_ = labels;
+            best_path_ = path_;
+        }
+    }
+
+    /**
+     * Record the automorphism mapping each variable to the one with the same
+     * label in an earlier leaf with identical codes. It fixes the path both
+     * leaves share and maps the earlier leaf's branch below it onto the
+     * current one, so the rest of the current branch repeats explored leaves
+     * and the search jumps back to their common ancestor.
+     */
+    void add_automorphism(const std::vector<int>& earlier, const std::vector<int>& earlier_path,
+                          const std::vector<int>& labels) {
+        std::size_t common = 0;
+        while (common < path_.size() && common < earlier_path.size() && path_[common] == earlier_path[common]) {
+            ++common;
+        }
+        jump_ = common;
+
+        std::vector<int> variable(graph_.num_vars);
+        for (int v = 0; v < graph_.num_vars; ++v) {
+            variable[earlier[v]] = v;
+        }
+        std::vector<int> gamma(graph_.num_vars);
+        for (int v = 0; v < graph_.num_vars; ++v) {
+            gamma[v] = variable[labels[v]];
+        }
+        automorphisms_.push_back(std::move(gamma));
+    }
+
+    static int find(std::vector<int>& parent, int v) {
+        while (parent[v] != v) {
+            parent[v] = parent[parent[v]];
+            v = parent[v];
+        }
+        return v;
+    }
+
+    /**
+     * Merge the orbits of the automorphisms found since `first` that fix
+     * every variable on the current path, and so stabilise this node.
+     * An orbit is explored when any of its variables is.
+     */
+    void merge_orbits(std::size_t first, std::vector<int>& orbits, std::vector<char>& explored) {
+        for (std::size_t i = first; i < automorphisms_.size(); ++i) {
+            const auto& gamma = automorphisms_[i];
+            bool fixes_path = std::all_of(path_.begin(), path_.end(), [&](int u) { return gamma[u] == u; });
+            if (!fixes_path) {
+                continue;
+            }
+            work_ += graph_.num_vars;
+            for (int v = 0; v < graph_.num_vars; ++v) {
+                int a = find(orbits, v);
+                int b = find(orbits, gamma[v]);
+                if (a != b) {
+                    orbits[std::max(a, b)] = std::min(a, b);
+                    explored[std::min(a, b)] |= explored[std::max(a, b)];
+                }
+            }
+        }
+    }
+
+    void search(std::vector<int> colours) {
+        int cells = refine(colours);
+        if (cells == graph_.num_vars) {
+            leaf(colours);
+            return;
+        }
+
+        if (work_ >= max_work_) {
+            // Out of budget: break the remaining ties by input order
+            complete_ = false;
+            std::vector<std::vector<long long>> signatures(graph_.num_vars);
+            for (int v = 0; v < graph_.num_vars; ++v) {
+                signatures[v] = {colours[v], v};
+            }
+            dense_rank(signatures, colours);
+            leaf(colours);
+            return;
+        }
+
+        // Target cell: the lowest colour shared by several variables
+        std::vector<int> size(cells, 0);
+        for (int colour : colours) {
+            ++size[colour];
+        }
+        int target = 0;
+        while (size[target] < 2) {
+            ++target;
+        }
+
+        // Orbit pruning: an automorphism fixing the path maps this node's
+        // colouring to itself, so children in one orbit give the same leaves
+        std::vector<int> orbits(graph_.num_vars);
+        std::iota(orbits.begin(), orbits.end(), 0);
+        std::vector<char> explored(graph_.num_vars, 0);
+        std::size_t seen = automorphisms_.size();
+
+        for (int v = 0; v < graph_.num_vars; ++v) {
+            if (colours[v] != target) {
+                continue;
+            }
+            merge_orbits(seen, orbits, explored);
+            seen = automorphisms_.size();
+            if (explored[find(orbits, v)]) {
+                continue;
+            }
+            if (work_ >= max_work_ && !best_labels_.empty()) {
+                complete_ = false;
+                return;
+            }
+            std::vector<int> individualised(graph_.num_vars);
+            for (int u = 0; u < graph_.num_vars; ++u) {
+                individualised[u] = 2 * colours[u] + (colours[u] == target && u != v ? 1 : 0);
+            }
+            path_.push_back(v);
+            search(std::move(individualised));
+            path_.pop_back();
+            explored[find(orbits, v)] = 1;
+            if (jump_ != kNoJump) {
+                if (path_.size() > jump_) {
+                    return;
+                }
+                jump_ = kNoJump;
+            }
+        }
+    }
+};
+
+inline std::uint64_t rotl64(std::uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+inline std::uint64_t fmix64(std::uint64_t k) {
+    k ^= k >> 33;
+    k *= 0xff51afd7ed558ccdull;
+    k ^= k >> 33;
+    k *= 0xc4ceb9fe1a85ec53ull;
+    k ^= k >> 33;
+    return k;
+}
+
+} // namespace
+
+std::string Hash128::hex() const {
+    static const char digits[] = "0123456789abcdef";
+    std::string out(32, '0');
+    for (int i = 0; i < 16; ++i) {
+        out[15 - i] = digits[(high >> (4 * i)) & 0xf];
+        out[31 - i] = digits[(low >> (4 * i)) & 0xf];
+    }
+    return out;
+}
+
+Hash128 hash128(const void* data, std::size_t size, std::uint64_t seed) {
+    const std::uint8_t* bytes = static_cast<const std::uint8_t*>(data);
+    const std::uint64_t c1 = 0x87c37b91114253d5ull;
+    const std::uint64_t c2 = 0x4cf5ad432745937full;
+    std::uint64_t h1 = seed;
+    std::uint64_t h2 = seed;
+
+    std::size_t num_blocks = size / 16;
+    for (std::size_t i = 0; i < num_blocks; ++i) {
+        std::uint64_t k1, k2;
+        std::memcpy(&k1, bytes + 16 * i, 8);
+        std::memcpy(&k2, bytes + 16 * i + 8, 8);
+
+        k1 *= c1; k1 = rotl64(k1, 31); k1 *= c2; h1 ^= k1;
+        h1 = rotl64(h1, 27); h1 += h2; h1 = h1 * 5 + 0x52dce729;
+        k2 *= c2; k2 = rotl64(k2, 33); k2 *= c1; h2 ^= k2;
+        h2 = rotl64(h2, 31); h2 += h1; h2 = h2 * 5 + 0x38495ab5;
+    }
+
+    const std::uint8_t* tail = bytes + 16 * num_blocks;
+    std::uint64_t k1 = 0, k2 = 0;
+    std::size_t rest = size & 15;
+    for (std::size_t i = rest; i > 8; --i) {
+        k2 ^= static_cast<std::uint64_t>(tail[i - 1]) << (8 * (i - 9));
+    }
+    if (rest > 8) {
+        k2 *= c2; k2 = rotl64(k2, 33); k2 *= c1; h2 ^= k2;
+    }
+    for (std::size_t i = std::min<std::size_t>(rest, 8); i > 0; --i) {
+        k1 ^= static_cast<std::uint64_t>(tail[i - 1]) << (8 * (i - 1));
+    }
+    if (rest > 0) {
+        k1 *= c1; k1 = rotl64(k1, 31); k1 *= c2; h1 ^= k1;
+    }
+
+    h1 ^= size;
+    h2 ^= size;
+    h1 += h2;
+    h2 += h1;
+    h1 = fmix64(h1);
+    h2 = fmix64(h2);
+    h1 += h2;
+    h2 += h1;
+
+    Hash128 hash;
+    hash.low = h1;
+    hash.high = h2;
+    return hash;
+}
+
+CanonicalForm canonicalize(const int* literals, const std::int64_t* offsets, std::size_t num_clauses,
+                           std::uint64_t max_work) {
+    CanonicalForm form;
+
+    // Compress the occurring variables to 0..n-1
+    int max_var = 0;
+    std::int64_t num_literals = num_clauses > 0 ? offsets[num_clauses] : 0;
+    for (std::int64_t i = 0; i < num_literals; ++i) {
+        max_var = std::max(max_var, std::abs(literals[i]));
+    }
+    std::vector<int> index(max_var + 1, -1);
+    std::vector<int> original;
+    for (std::int64_t i = 0; i < num_literals; ++i) {
+        int var = std::abs(literals[i]);
+        if (index[var] < 0) {
+            index[var] = static_cast<int>(original.size());
+            original.push_back(var);
+        }
+    }
+
+    // Clauses as sets of (variable, negated), repeated literals and clauses dropped
+    ClauseGraph graph;
+    graph.num_vars = static_cast<int>(original.size());
+    graph.clauses.resize(num_clauses);
+    for (std::size_t c = 0; c < num_clauses; ++c) {
+        auto& clause = graph.clauses[c];
+        for (std::int64_t i = offsets[c]; i < offsets[c + 1]; ++i) {
+            clause.emplace_back(index[std::abs(literals[i])], literals[i] < 0 ? 1 : 0);
+        }
+        std::sort(clause.begin(), clause.end());
+        clause.erase(std::unique(clause.begin(), clause.end()), clause.end());
+    }
+    std::sort(graph.clauses.begin(), graph.clauses.end());
+    graph.clauses.erase(std::unique(graph.clauses.begin(), graph.clauses.end()), graph.clauses.end());
+
+    graph.occurrences.resize(graph.num_vars);
+    for (std::size_t c = 0; c < graph.clauses.size(); ++c) {
+        for (const auto& lit : graph.clauses[c]) {
+            graph.occurrences[lit.first].emplace_back(static_cast<int>(c), lit.second);
+        }
+    }
+
+    Canonizer canonizer(graph, max_work);
+    std::vector<int> labels = canonizer.run();
+    form.complete = canonizer.complete();
+    form.num_vars = graph.num_vars;
+
+    form.var_map.assign(max_var + 1, 0);
+    for (int v = 0; v < graph.num_vars; ++v) {
+        form.var_map[original[v]] = labels[v] + 1;
+    }
+
+    form.clause_offsets.push_back(0);
+    for (const auto& clause : canonizer.best_codes()) {
+        for (int code : clause) {
+            int var = code / 2 + 1;
+            form.literals.push_back(code & 1 ? -var : var);
+        }
+        form.clause_offsets.push_back(form.literals.size());
+    }
+
+    // Hash the variable count, clause boundaries and literals as fixed-width integers
+    std::vector<std::int64_t> words;
+    words.reserve(2 + form.clause_offsets.size() + form.literals.size());
+    words.push_back(form.num_vars);
+    words.push_back(static_cast<std::int64_t>(form.clause_offsets.size()) - 1);
+    words.insert(words.end(), form.clause_offsets.begin(), form.clause_offsets.end());
+    words.insert(words.end(), form.literals.begin(), form.literals.end());
+    form.hash = hash128(words.data(), words.size() * sizeof(std::int64_t));
+
+    return form;
+}
+
+CanonicalForm canonicalize(const SATSolver::Formula& formula, std::uint64_t max_work) {
+    std::vector<int> literals;
+    std::vector<std::int64_t> offsets(1, 0);
+    for (const auto& clause : formula) {
+        literals.insert(literals.end(), clause.begin(), clause.end());
+        offsets.push_back(literals.size());
+    }
+    return canonicalize(literals.data(), offsets.data(), formula.size(), max_work);
+}
+
+} // namespace utils
+} // namespace sat_solver
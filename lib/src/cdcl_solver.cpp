@@ -0,0 +1,874 @@
+#include "cdcl_solver.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+
+namespace sat_solver {
+
+namespace {
+
+const double kVarDecay = 0.95;
+const double kClauseDecay = 0.999;
+const int kRestartBase = 100;
+
+const std::uint32_t kStateMagic = 0x4C434443;   // "CDCL"
+const std::uint32_t kStateVersion = 1;
+
+/**
+ * Appends plain values and length-prefixed arrays to a byte buffer.
+ */
+class StateWriter {
+public:
+    explicit StateWriter(std::vector<std::uint8_t>& out) : out_(out) {}
+
+    template <typename T>
+    void value(const T& value) {
+        const std::uint8_t* bytes = reinterpret_cast<const std::uint8_t*>(&value);
+        out_.insert(out_.end(), bytes, bytes + sizeof(T));
+    }
+
+    template <typename T>
+    void array(const std::vector<T>& values) {
+        value<std::uint64_t>(values.size());
+        const std::uint8_t* bytes = reinterpret_cast<const std::uint8_t*>(values.data());
+        out_.insert(out_.end(), bytes, bytes + values.size() * sizeof(T));
+    }
+
+private:
+    std::vector<std::uint8_t>& out_;
+};
+
+/**
+ * Reads back what StateWriter wrote, throwing on truncated input.
+ */
+class StateReader {
+public:
+    StateReader(const std::uint8_t* data, std::size_t size) : data_(data), size_(size), pos_(0) {}
+
+    template <typename T>
+    T value() {
+        T value;
+        take(&value, sizeof(T));
+        return value;
+    }
+
+    template <typename T>
+    std::vector<T> array() {
+        std::uint64_t count = value<std::uint64_t>();
+        if (count > (size_ - pos_) / sizeof(T)) {
+            throw std::runtime_error("Corrupt solver state: truncated array");
+        }
+        std::vector<T> values(static_cast<std::size_t>(count));
+        take(values.data(), values.size() * sizeof(T));
+        return values;
+    }
+
+    bool at_end() const { return pos_ == size_; }
+
+private:
+    const std::uint8_t* data_;
+    std::size_t size_;
+    std::size_t pos_;
+
+    void take(void* dest, std::size_t bytes) {
+        if (bytes > size_ - pos_) {
+            throw std::runtime_error("Corrupt solver state: truncated data");
+        }
+        if (bytes > 0) {
+            std::memcpy(dest, data_ + pos_, bytes);
+        }
+        pos_ += bytes;
+    }
+};
+
+} // namespace
+
+CDCLSolver::CDCLSolver()
+    : wasted_words_(0), qhead_(0), ok_(true), input_clauses_(0), input_hash_(kInputHashSeed), cancel_(nullptr), propagations_(0),
+      propagation_limit_(UINT64_MAX), interrupted_(false), var_inc_(1.0), clause_inc_(1.0),
+      max_learnts_(0), stamp_(0) {}
+
+void CDCLSolver::reserve_vars(int num_vars) {
+    int old_vars = get_num_variables();
+    if (num_vars <= old_vars) {
+        return;
+    }
+
+    watches_.resize(2 * num_vars);
+    lit_value_.resize(2 * num_vars, 0);
+    level_.resize(num_vars, 0);
+    reason_.resize(num_vars, kNoReason);
+    activity_.resize(num_vars, 0.0);
+    heap_index_.resize(num_vars, -1);
+    phase_.resize(num_vars, true);
+    seen_.resize(num_vars, 0);
+    level_stamp_.resize(num_vars + 1, 0);
+
+    for (int v = old_vars; v < num_vars; ++v) {
+        heap_insert(v);
+    }
+}
+
+float CDCLSolver::clause_activity(CRef cr) const {
+    float activity;
+    std::memcpy(&activity, &arena_[cr + 2], sizeof(activity));
+    return activity;
+}
+
+void CDCLSolver::set_clause_activity(CRef cr, float activity) {
+    std::memcpy(&arena_[cr + 2], &activity, sizeof(activity));
+}
+
+CDCLSolver::CRef CDCLSolver::alloc_clause(const std::vector<Lit>& lits, bool learnt, std::uint32_t lbd) {
+    CRef cr = static_cast<CRef>(arena_.size());
+    arena_.push_back(static_cast<std::uint32_t>(lits.size()));
+    arena_.push_back((lbd << 2) | (learnt ? 1u : 0u));
+    arena_.push_back(0);
+    arena_.insert(arena_.end(), lits.begin(), lits.end());
+    return cr;
+}
+
+void CDCLSolver::attach_clause(CRef cr) {
+    Lit* lits = clause_lits(cr);
+    watches_[neg(lits[0])].push_back({cr, lits[1]});
+    watches_[neg(lits[1])].push_back({cr, lits[0]});
+}
+
+std::uint64_t CDCLSolver::hash_clause(std::uint64_t hash, const int* literals, std::size_t size) {
+    // FNV-1a over the literals and a terminating zero, as in DIMACS
+    const std::uint64_t prime = 1099511628211ull;
+    for (std::size_t i = 0; i < size; ++i) {
+        hash = (hash ^ static_cast<std::uint32_t>(literals[i])) * prime;
+    }
+    return hash * prime;
+}
+
+bool CDCLSolver::add_clause(const int* literals, std::size_t size) {
+    ++input_clauses_;
+    input_hash_ = hash_clause(input_hash_, literals, size);
+    if (!ok_) {
+        return false;
+    }
+
+    int max_var = 0;
+    for (std::size_t i = 0; i < size; ++i) {
+        max_var = std::max(max_var, std::abs(literals[i]));
+    }
+    reserve_vars(max_var);
+
+    std::vector<Lit> lits;
+    lits.reserve(size);
+    for (std::size_t i = 0; i < size; ++i) {
+        lits.push_back(to_lit(literals[i]));
+    }
+    std::sort(lits.begin(), lits.end());
+
+    // Drop duplicates and level-0 false literals; skip tautologies and satisfied clauses
+    std::size_t j = 0;
+    for (std::size_t i = 0; i < lits.size(); ++i) {
+        Lit lit = lits[i];
+        if (value(lit) > 0 || (j > 0 && lits[j - 1] == neg(lit))) {
+            return true;
+        }
+        if (value(lit) < 0 || (j > 0 && lits[j - 1] == lit)) {
+            continue;
+        }
+        lits[j++] = lit;
+    }
+    lits.resize(j);
+
+    if (lits.empty()) {
+        ok_ = false;
+        return false;
+    }
+    if (lits.size() == 1) {
+        enqueue(lits[0], kNoReason);
+        ok_ = propagate() == kNoReason;
+        return ok_;
+    }
+
+    CRef cr = alloc_clause(lits, false, 0);
+    clauses_.push_back(cr);
+    attach_clause(cr);
+    return true;
+}
+
+void CDCLSolver::enqueue(Lit lit, CRef reason) {
+    int v = var(lit);
+    lit_value_[lit] = 1;
+    lit_value_[neg(lit)] = -1;
+    level_[v] = decision_level();
+    reason_[v] = reason;
+    trail_.push_back(lit);
+}
+
+void CDCLSolver::cancel_until(int level) {
+    if (decision_level() <= level) {
+        return;
+    }
+    for (std::size_t i = trail_.size(); i-- > trail_lim_[level];) {
+        Lit lit = trail_[i];
+        int v = var(lit);
+        lit_value_[lit] = 0;
+        lit_value_[neg(lit)] = 0;
+        reason_[v] = kNoReason;
+        phase_[v] = lit & 1u;
+        if (heap_index_[v] < 0) {
+            heap_insert(v);
+        }
+    }
+    qhead_ = trail_lim_[level];
+    trail_.resize(trail_lim_[level]);
+    trail_lim_.resize(level);
+}
+
+CDCLSolver::CRef CDCLSolver::propagate() {
+    PhaseTimer timer(stats_.propagate_seconds);
+    CRef confl = kNoReason;
+
+    while (qhead_ < trail_.size()) {
+        if (propagations_ >= propagation_limit_ || (cancel_ && cancel_->cancelled())) {
+            interrupted_ = true;
+            break;
+        }
+        ++propagations_;
+        Lit p = trail_[qhead_++];
+        Lit false_lit = neg(p);
+        std::vector<Watcher>& ws = watches_[p];
+        SAT_STAT_ADD(stats_, propagations, 1);
+
+        std::size_t i = 0, j = 0, n = ws.size();
+        while (i < n) {
+            Watcher w = ws[i];
+            if (value(w.blocker) > 0) {
+                ws[j++] = ws[i++];
+                continue;
+            }
+
+            CRef cr = w.cref;
+            Lit* lits = clause_lits(cr);
+            if (lits[0] == false_lit) {
+                lits[0] = lits[1];
+                lits[1] = false_lit;
+            }
+            ++i;
+
+            Lit first = lits[0];
+            Watcher kept = {cr, first};
+            if (first != w.blocker && value(first) > 0) {
+                ws[j++] = kept;
+                continue;
+            }
+
+            // Look for a new literal to watch
+            std::uint32_t size = clause_size(cr);
+            bool moved = false;
+            for (std::uint32_t k = 2; k < size; ++k) {
+                if (value(lits[k]) >= 0) {
+                    lits[1] = lits[k];
+                    lits[k] = false_lit;
+                    watches_[neg(lits[1])].push_back(kept);
+                    moved = true;
+                    break;
+                }
+            }
+            if (moved) {
+                continue;
+            }
+
+            // Clause is unit or conflicting
+            ws[j++] = kept;
+            if (value(first) < 0) {
+                confl = cr;
+                qhead_ = trail_.size();
+                while (i < n) {
+                    ws[j++] = ws[i++];
+                }
+            } else {
+                enqueue(first, cr);
+            }
+        }
+        ws.resize(j);
+    }
+
+    return confl;
+}
+
+void CDCLSolver::analyze(CRef confl, std::vector<Lit>& learnt, int& backtrack_level, std::uint32_t& lbd) {
+    PhaseTimer timer(stats_.analyze_seconds);
+    int path = 0;
+    Lit p = kNoLit;
+    std::size_t index = trail_.size();
+
+    learnt.clear();
+    learnt.push_back(kNoLit);  // room for the asserting literal
+
+    do {
+        if (is_learnt(confl)) {
+            bump_clause(confl);
+        }
+        Lit* lits = clause_lits(confl);
+        std::uint32_t size = clause_size(confl);
+        for (std::uint32_t k = (p == kNoLit) ? 0 : 1; k < size; ++k) {
+            Lit q = lits[k];
+            int v = var(q);
+            if (!seen_[v] && level_[v] > 0) {
+                bump_var(v);
+                seen_[v] = 1;
+                if (level_[v] >= decision_level()) {
+                    ++path;
+                } else {
+                    learnt.push_back(q);
+                }
+            }
+        }
+
+        // Walk back to the next literal of the current level involved in the conflict
+        while (!seen_[var(trail_[--index])]) {}
+        p = trail_[index];
+        confl = reason_[var(p)];
+        seen_[var(p)] = 0;
+        --path;
+    } while (path > 0);
+    learnt[0] = neg(p);
+
+    // Recursive minimisation: drop literals implied by the rest of the clause
+    analyze_toclear_.assign(learnt.begin(), learnt.end());
+    std::uint32_t levels = 0;
+    for (std::size_t i = 1; i < learnt.size(); ++i) {
+        levels |= abstract_level(var(learnt[i]));
+    }
+    std::size_t j = 1;
+    for (std::size_t i = 1; i < learnt.size(); ++i) {
+        if (reason_[var(learnt[i])] == kNoReason || !lit_redundant(learnt[i], levels)) {
+            learnt[j++] = learnt[i];
+        }
+    }
+    learnt.resize(j);
+    for (Lit lit : analyze_toclear_) {
+        seen_[var(lit)] = 0;
+    }
+
+    // Put the literal with the highest level second so it gets watched
+    backtrack_level = 0;
+    if (learnt.size() > 1) {
+        std::size_t max_i = 1;
+        for (std::size_t i = 2; i < learnt.size(); ++i) {
+            if (level_[var(learnt[i])] > level_[var(learnt[max_i])]) {
+                max_i = i;
+            }
+        }
+        std::swap(learnt[1], learnt[max_i]);
+        backtrack_level = level_[var(learnt[1])];
+    }
+
+    // Literal block distance: number of distinct decision levels
+    ++stamp_;
+    lbd = 0;
+    for (Lit lit : learnt) {
+        int level = level_[var(lit)];
+        if (level_stamp_[level] != stamp_) {
+            level_stamp_[level] = stamp_;
+            ++lbd;
+        }
+    }
+}
+
+bool CDCLSolver::lit_redundant(Lit lit, std::uint32_t abstract_levels) {
+    analyze_stack_.clear();
+    analyze_stack_.push_back(lit);
+    std::size_t top = analyze_toclear_.size();
+
+    while (!analyze_stack_.empty()) {
+        CRef cr = reason_[var(analyze_stack_.back())];
+        analyze_stack_.pop_back();
+        Lit* lits = clause_lits(cr);
+        std::uint32_t size = clause_size(cr);
+
+        for (std::uint32_t k = 1; k < size; ++k) {
+            Lit q = lits[k];
+            int v = var(q);
+            if (seen_[v] || level_[v] == 0) {
+                continue;
+            }
+            if (reason_[v] != kNoReason && (abstract_level(v) & abstract_levels) != 0) {
+                seen_[v] = 1;
+                analyze_stack_.push_back(q);
+                analyze_toclear_.push_back(q);
+            } else {
+                for (std::size_t i = top; i < analyze_toclear_.size(); ++i) {
+                    seen_[var(analyze_toclear_[i])] = 0;
+                }
+                analyze_toclear_.resize(top);
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+CDCLSolver::Lit CDCLSolver::pick_branch_literal() {
+    while (!heap_.empty()) {
+        int v = heap_pop();
+        if (lit_value_[2 * v] == 0) {
+            return 2u * v + (phase_[v] ? 1u : 0u);
+        }
+    }
+    return kNoLit;
+}
+
+void CDCLSolver::bump_var(int v) {
+    if ((activity_[v] += var_inc_) > 1e100) {
+        for (double& a : activity_) {
+            a *= 1e-100;
+        }
+        var_inc_ *= 1e-100;
+    }
+    if (heap_index_[v] >= 0) {
+        heap_sift_up(heap_index_[v]);
+    }
+}
+
+void CDCLSolver::bump_clause(CRef cr) {
+    float activity = clause_activity(cr) + static_cast<float>(clause_inc_);
+    set_clause_activity(cr, activity);
+    if (activity > 1e20f) {
+        for (CRef learnt : learnts_) {
+            set_clause_activity(learnt, clause_activity(learnt) * 1e-20f);
+        }
+        clause_inc_ *= 1e-20;
+    }
+}
+
+void CDCLSolver::decay_activities() {
+    var_inc_ /= kVarDecay;
+    clause_inc_ /= kClauseDecay;
+}
+
+void CDCLSolver::heap_insert(int v) {
+    heap_index_[v] = static_cast<int>(heap_.size());
+    heap_.push_back(v);
+    heap_sift_up(heap_.size() - 1);
+}
+
+void CDCLSolver::heap_sift_up(std::size_t pos) {
+    int v = heap_[pos];
+    while (pos > 0) {
+        std::size_t parent = (pos - 1) / 2;
+        if (!heap_less(v, heap_[parent])) {
+            break;
+        }
+        heap_[pos] = heap_[parent];
+        heap_index_[heap_[pos]] = static_cast<int>(pos);
+        pos = parent;
+    }
+    heap_[pos] = v;
+    heap_index_[v] = static_cast<int>(pos);
+}
+
+void CDCLSolver::heap_sift_down(std::size_t pos) {
+    int v = heap_[pos];
+    for (;;) {
+        std::size_t child = 2 * pos + 1;
+        if (child >= heap_.size()) {
+            break;
+        }
+        if (child + 1 < heap_.size() && heap_less(heap_[child + 1], heap_[child])) {
+            ++child;
+        }
+        if (!heap_less(heap_[child], v)) {
+            break;
+        }
+        heap_[pos] = heap_[child];
+        heap_index_[heap_[pos]] = static_cast<int>(pos);
+        pos = child;
+    }
+    heap_[pos] = v;
+    heap_index_[v] = static_cast<int>(pos);
+}
+
+int CDCLSolver::heap_pop() {
+    int top = heap_[0];
+    heap_index_[top] = -1;
+    int last = heap_.back();
+    heap_.pop_back();
+    if (!heap_.empty()) {
+        heap_[0] = last;
+        heap_index_[last] = 0;
+        heap_sift_down(0);
+    }
+    return top;
+}
+
+void CDCLSolver::reduce_db() {
+    PhaseTimer timer(stats_.reduce_seconds);
+
+    // Worst clauses first: high LBD, then low activity
+    std::sort(learnts_.begin(), learnts_.end(), [this](CRef a, CRef b) {
+        if (clause_lbd(a) != clause_lbd(b)) {
+            return clause_lbd(a) > clause_lbd(b);
+        }
+        return clause_activity(a) < clause_activity(b);
+    });
+
+    // Reasons of level-0 literals are never needed again
+    for (Lit lit : trail_) {
+        reason_[var(lit)] = kNoReason;
+    }
+
+    std::size_t target = learnts_.size() / 2;
+    std::size_t removed = 0;
+    std::size_t j = 0;
+    for (std::size_t i = 0; i < learnts_.size(); ++i) {
+        CRef cr = learnts_[i];
+        if (removed < target && clause_lbd(cr) > 2) {
+            arena_[cr + 1] |= 2u;
+            wasted_words_ += kHeaderWords + clause_size(cr);
+            ++removed;
+        } else {
+            learnts_[j++] = cr;
+        }
+    }
+    learnts_.resize(j);
+    SAT_STAT_ADD(stats_, deleted_clauses, removed);
+
+    collect_garbage();
+}
+
+void CDCLSolver::collect_garbage() {
+    std::vector<std::uint32_t> arena;
+    arena.reserve(arena_.size() - wasted_words_);
+
+    auto move_clause = [&](CRef& cr) {
+        CRef moved = static_cast<CRef>(arena.size());
+        arena.insert(arena.end(), arena_.begin() + cr, arena_.begin() + cr + kHeaderWords + clause_size(cr));
+        cr = moved;
+    };
+    for (CRef& cr : clauses_) {
+        move_clause(cr);
+    }
+    for (CRef& cr : learnts_) {
+        move_clause(cr);
+    }
+    arena_.swap(arena);
+    wasted_words_ = 0;
+
+    for (auto& ws : watches_) {
+        ws.clear();
+    }
+    for (CRef cr : clauses_) {
+        attach_clause(cr);
+    }
+    for (CRef cr : learnts_) {
+        attach_clause(cr);
+    }
+}
+
+double CDCLSolver::luby(double y, int x) {
+    // Find the finite subsequence that contains index x and its size
+    int size = 1, seq = 0;
+    while (size < x + 1) {
+        ++seq;
+        size = 2 * size + 1;
+    }
+    while (size - 1 != x) {
+        size = (size - 1) >> 1;
+        --seq;
+        x = x % size;
+    }
+    return std::pow(y, seq);
+}
+
+SolveStatus CDCLSolver::solve(const std::vector<int>& assumptions, const SolveLimits& limits) {
+    PhaseTimer timer(stats_.total_seconds);
+    model_.clear();
+    if (!ok_) {
+        return SolveStatus::UNSAT;
+    }
+
+    using Clock = std::chrono::steady_clock;
+    bool timed = limits.max_seconds > 0.0;
+    Clock::time_point deadline = Clock::now();
+    if (timed) {
+        deadline += std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(limits.max_seconds));
+    }
+    std::uint64_t conflicts = 0;
+    unsigned poll = 0;
+    cancel_ = limits.cancel.get();
+    propagation_limit_ = limits.max_propagations > 0 ? propagations_ + limits.max_propagations : UINT64_MAX;
+    interrupted_ = false;
+
+    std::vector<Lit> assumed;
+    assumed.reserve(assumptions.size());
+    for (int a : assumptions) {
+        reserve_vars(std::abs(a));
+        assumed.push_back(to_lit(a));
+    }
+
+    if (max_learnts_ == 0) {
+        max_learnts_ = std::max<std::uint64_t>(clauses_.size() / 3, 2000);
+    }
+
+    std::vector<Lit> learnt;
+    int restarts = 0;
+    std::uint64_t conflicts_left = static_cast<std::uint64_t>(luby(2, restarts) * kRestartBase);
+    SolveStatus result = SolveStatus::UNKNOWN;
+
+    for (;;) {
+        CRef confl = propagate();
+        if (interrupted_) {
+            break;
+        }
+        if (confl != kNoReason) {
+            ++conflicts;
+            SAT_STAT_ADD(stats_, conflicts, 1);
+            if (conflicts_left > 0) {
+                --conflicts_left;
+            }
+            if (decision_level() == 0) {
+                ok_ = false;
+                result = SolveStatus::UNSAT;
+                break;
+            }
+
+            int backtrack_level;
+            std::uint32_t lbd;
+            analyze(confl, learnt, backtrack_level, lbd);
+            cancel_until(backtrack_level);
+
+            if (learnt.size() == 1) {
+                enqueue(learnt[0], kNoReason);
+            } else {
+                CRef cr = alloc_clause(learnt, true, lbd);
+                learnts_.push_back(cr);
+                attach_clause(cr);
+                bump_clause(cr);
+                enqueue(learnt[0], cr);
+            }
+            SAT_STAT_ADD(stats_, learned_clauses, 1);
+            decay_activities();
+            if (limits.max_conflicts > 0 && conflicts >= limits.max_conflicts) {
+                break;
+            }
+            continue;
+        }
+
+        // Reading the clock is comparatively expensive, so only do it now and then
+        if (timed && (++poll & 255) == 0 && Clock::now() >= deadline) {
+            break;
+        }
+
+        if (conflicts_left == 0) {
+            cancel_until(0);
+            SAT_STAT_ADD(stats_, restarts, 1);
+            conflicts_left = static_cast<std::uint64_t>(luby(2, ++restarts) * kRestartBase);
+            if (learnts_.size() >= max_learnts_) {
+                reduce_db();
+                max_learnts_ += max_learnts_ / 10;
+            }
+            continue;
+        }
+
+        // Assumptions occupy the first decision levels
+        Lit next = kNoLit;
+        bool failed = false;
+        while (decision_level() < static_cast<int>(assumed.size())) {
+            Lit a = assumed[decision_level()];
+            if (value(a) > 0) {
+                new_decision_level();
+            } else if (value(a) < 0) {
+                failed = true;
+                break;
+            } else {
+                next = a;
+                break;
+            }
+        }
+        if (failed) {
+            result = SolveStatus::UNSAT;
+            break;
+        }
+
+        if (next == kNoLit) {
+            SAT_STAT_ADD(stats_, decisions, 1);
+            next = pick_branch_literal();
+            if (next == kNoLit) {
+                model_.resize(get_num_variables());
+                for (int v = 0; v < get_num_variables(); ++v) {
+                    model_[v] = lit_value_[2 * v] > 0;
+                }
+                result = SolveStatus::SAT;
+                break;
+            }
+        }
+        new_decision_level();
+        enqueue(next, kNoReason);
+    }
+
+    cancel_until(0);
+    cancel_ = nullptr;
+    propagation_limit_ = UINT64_MAX;
+    interrupted_ = false;
+#if SAT_SOLVER_STATS
+    stats_.arena_bytes = arena_.size() * sizeof(std::uint32_t);
+#endif
+    return result;
+}
+
+void CDCLSolver::save_state(std::vector<std::uint8_t>& out) const {
+    StateWriter writer(out);
+    writer.value(kStateMagic);
+    writer.value(kStateVersion);
+    writer.value<std::uint32_t>(get_num_variables());
+    writer.value<std::uint8_t>(ok_);
+    writer.value(input_clauses_);
+    writer.value(input_hash_);
+
+    // Between solves the trail holds only top-level facts
+    writer.array(arena_);
+    writer.array(clauses_);
+    writer.array(learnts_);
+    writer.value<std::uint64_t>(wasted_words_);
+    writer.array(trail_);
+    writer.value<std::uint64_t>(qhead_);
+
+    writer.array(activity_);
+    std::vector<std::uint8_t> phase(phase_.begin(), phase_.end());
+    writer.array(phase);
+    writer.value(var_inc_);
+    writer.value(clause_inc_);
+    writer.value(max_learnts_);
+    writer.value(propagations_);
+
+    const std::uint64_t counters[7] = {stats_.decisions, stats_.propagations, stats_.conflicts, stats_.restarts,
+                                       stats_.learned_clauses, stats_.deleted_clauses, stats_.arena_bytes};
+    const double timings[4] = {stats_.propagate_seconds, stats_.analyze_seconds, stats_.reduce_seconds,
+                               stats_.total_seconds};
+    for (std::uint64_t counter : counters) {
+        writer.value(counter);
+    }
+    for (double timing : timings) {
+        writer.value(timing);
+    }
+}
+
+void CDCLSolver::load_state(const std::uint8_t* data, std::size_t size) {
+    StateReader reader(data, size);
+    if (reader.value<std::uint32_t>() != kStateMagic || reader.value<std::uint32_t>() != kStateVersion) {
+        throw std::runtime_error("Corrupt solver state: bad header");
+    }
+    std::uint32_t num_vars = reader.value<std::uint32_t>();
+    if (num_vars > static_cast<std::uint32_t>(INT32_MAX / 2)) {
+        throw std::runtime_error("Corrupt solver state: too many variables");
+    }
+    bool ok = reader.value<std::uint8_t>() != 0;
+    std::uint64_t input_clauses = reader.value<std::uint64_t>();
+    std::uint64_t input_hash = reader.value<std::uint64_t>();
+
+    std::vector<std::uint32_t> arena = reader.array<std::uint32_t>();
+    std::vector<CRef> clauses = reader.array<CRef>();
+    std::vector<CRef> learnts = reader.array<CRef>();
+    std::uint64_t wasted_words = reader.value<std::uint64_t>();
+    std::vector<Lit> trail = reader.array<Lit>();
+    std::uint64_t qhead = reader.value<std::uint64_t>();
+
+    std::vector<double> activity = reader.array<double>();
+    std::vector<std::uint8_t> phase = reader.array<std::uint8_t>();
+    double var_inc = reader.value<double>();
+    double clause_inc = reader.value<double>();
+    std::uint64_t max_learnts = reader.value<std::uint64_t>();
+    std::uint64_t propagations = reader.value<std::uint64_t>();
+
+    std::uint64_t counters[7];
+    double timings[4];
+    for (std::uint64_t& counter : counters) {
+        counter = reader.value<std::uint64_t>();
+    }
+    for (double& timing : timings) {
+        timing = reader.value<double>();
+    }
+    if (!reader.at_end() || activity.size() != num_vars || phase.size() != num_vars || qhead > trail.size() ||
+        trail.size() > num_vars) {
+        throw std::runtime_error("Corrupt solver state: inconsistent sizes");
+    }
+
+    // Every clause must lie inside the arena and mention known literals only
+    auto check_clause = [&](CRef cr, bool learnt) {
+        if (arena.size() < kHeaderWords || cr > arena.size() - kHeaderWords) {
+            throw std::runtime_error("Corrupt solver state: clause outside arena");
+        }
+        std::uint32_t clause_size = arena[cr];
+        if (clause_size < 2 || clause_size > arena.size() - kHeaderWords - cr ||
+            ((arena[cr + 1] & 1u) != 0) != learnt || (arena[cr + 1] & 2u)) {
+            throw std::runtime_error("Corrupt solver state: bad clause header");
+        }
+        for (std::uint32_t i = 0; i < clause_size; ++i) {
+            if (arena[cr + kHeaderWords + i] >= 2 * num_vars) {
+                throw std::runtime_error("Corrupt solver state: literal out of range");
+            }
+        }
+    };
+    for (CRef cr : clauses) {
+        check_clause(cr, false);
+    }
+    for (CRef cr : learnts) {
+        check_clause(cr, true);
+    }
+
+    *this = CDCLSolver();
+    reserve_vars(static_cast<int>(num_vars));
+    for (Lit lit : trail) {
+        if (lit >= 2 * num_vars || value(lit) != 0) {
+            throw std::runtime_error("Corrupt solver state: bad trail");
+        }
+        enqueue(lit, kNoReason);
+    }
+    qhead_ = static_cast<std::size_t>(qhead);
+    ok_ = ok;
+    input_clauses_ = input_clauses;
+    input_hash_ = input_hash;
+
+    arena_ = std::move(arena);
+    clauses_ = std::move(clauses);
+    learnts_ = std::move(learnts);
+    wasted_words_ = static_cast<std::size_t>(wasted_words);
+    for (CRef cr : clauses_) {
+        attach_clause(cr);
+    }
+    for (CRef cr : learnts_) {
+        attach_clause(cr);
+    }
+
+    activity_ = std::move(activity);
+    phase_.assign(phase.begin(), phase.end());
+    var_inc_ = var_inc;
+    clause_inc_ = clause_inc;
+    max_learnts_ = max_learnts;
+    propagations_ = propagations;
+
+    heap_.clear();
+    std::fill(heap_index_.begin(), heap_index_.end(), -1);
+    for (int v = 0; v < get_num_variables(); ++v) {
+        if (lit_value_[2 * v] == 0) {
+            heap_insert(v);
+        }
+    }
+
+    stats_.decisions = counters[0];
+    stats_.propagations = counters[1];
+    stats_.conflicts = counters[2];
+    stats_.restarts = counters[3];
+    stats_.learned_clauses = counters[4];
+    stats_.deleted_clauses = counters[5];
+    stats_.arena_bytes = counters[6];
+    stats_.propagate_seconds = timings[0];
+    stats_.analyze_seconds = timings[1];
+    stats_.reduce_seconds = timings[2];
+    stats_.total_seconds = timings[3];
+}
+
+} // namespace sat_solver
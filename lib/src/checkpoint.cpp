@@ -0,0 +1,248 @@
+#include "sat_solver.h"
+#include "cdcl_solver.h"
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <signal.h>
+
+namespace sat_solver {
+
+namespace {
+
+const char kMagic[4] = {'S', 'C', 'K', 'P'};
+const std::uint32_t kVersion = 1;
+const std::size_t kHeaderBytes = 28;
+
+// Layout of serialized solvers and checkpoint files (native byte order):
+//   magic, u32 version, u32 variables, u64 clauses, u64 literals,
+//   u64 offsets[clauses + 1], i32 literals[], u64 clauses loaded into the
+//   engine, u64 engine state bytes, engine state (CDCLSolver::save_state)
+
+struct FileCloser {
+    void operator()(std::FILE* file) const { std::fclose(file); }
+};
+using File = std::unique_ptr<std::FILE, FileCloser>;
+
+File open_file(const std::string& path, const char* mode) {
+    File file(std::fopen(path.c_str(), mode));
+    if (!file) {
+        throw std::runtime_error("Cannot open " + path);
+    }
+    return file;
+}
+
+void append(std::vector<std::uint8_t>& out, const void* data, std::size_t size) {
+    const std::uint8_t* bytes = static_cast<const std::uint8_t*>(data);
+    out.insert(out.end(), bytes, bytes + size);
+}
+
+/**
+ * Bounds-checked reads from a serialized solver.
+ */
+class Reader {
+public:
+    Reader(const std::uint8_t* data, std::size_t size) : data_(data), size_(size), pos_(0) {}
+
+    void read(void* dest, std::size_t bytes) {
+        if (bytes > size_ - pos_) {
+            throw std::runtime_error("Truncated solver data");
+        }
+        if (bytes > 0) {
+            std::memcpy(dest, data_ + pos_, bytes);
+        }
+        pos_ += bytes;
+    }
+
+    template <typename T>
+    T value() {
+        T value;
+        read(&value, sizeof(T));
+        return value;
+    }
+
+    std::size_t remaining() const { return size_ - pos_; }
+
+private:
+    const std::uint8_t* data_;
+    std::size_t size_;
+    std::size_t pos_;
+};
+
+// Token of SATSolver::checkpoint_signal(), published for the handler
+std::atomic<CancelToken*> signal_token(nullptr);
+
+void on_checkpoint_signal(int) {
+    // Only atomic loads and stores: safe in a signal handler
+    if (CancelToken* token = signal_token.load()) {
+        token->cancel();
+    }
+}
+
+} // namespace
+
+const std::shared_ptr<CancelToken>& SATSolver::checkpoint_signal() {
+    // Never destroyed, so the handler cannot race with static destruction
+    static const std::shared_ptr<CancelToken>* token =
+        new std::shared_ptr<CancelToken>(std::make_shared<CancelToken>());
+    return *token;
+}
+
+bool SATSolver::checkpoint_signal_pending() {
+    return checkpoint_signal()->cancelled();
+}
+
+void SATSolver::reset_checkpoint_signal() {
+    checkpoint_signal()->reset();
+}
+
+void SATSolver::checkpoint_on_signal(const std::string& path, int signum) {
+    if (!path.empty()) {
+        signal_token.store(checkpoint_signal().get());   // before the handler can run
+
+        struct sigaction action;
+        std::memset(&action, 0, sizeof(action));
+        action.sa_handler = on_checkpoint_signal;
+        sigemptyset(&action.sa_mask);
+        action.sa_flags = SA_RESTART;
+        if (sigaction(signum, &action, nullptr) != 0) {
+            throw std::runtime_error("Cannot install a handler for signal " + std::to_string(signum));
+        }
+    }
+    checkpoint_path_ = path;
+}
+
+void SATSolver::serialize(std::vector<std::uint8_t>& out) const {
+    std::vector<std::uint8_t> state;
+    std::uint64_t engine_clauses = 0;
+    if (engine_) {
+        engine_->save_state(state);
+        engine_clauses = engine_clauses_;
+    }
+
+    std::uint32_t num_vars = static_cast<std::uint32_t>(num_variables_);
+    std::uint64_t num_clauses = clause_offsets_.size() - 1;
+    std::uint64_t num_literals = literals_.size();
+    std::uint64_t state_bytes = state.size();
+
+    out.clear();
+    out.reserve(kHeaderBytes + clause_offsets_.size() * sizeof(std::uint64_t) + literals_.size() * sizeof(int) +
+                2 * sizeof(std::uint64_t) + state.size());
+    append(out, kMagic, sizeof(kMagic));
+    append(out, &kVersion, sizeof(kVersion));
+    append(out, &num_vars, sizeof(num_vars));
+    append(out, &num_clauses, sizeof(num_clauses));
+    append(out, &num_literals, sizeof(num_literals));
+    for (std::size_t offset : clause_offsets_) {
+        std::uint64_t value = offset;
+        append(out, &value, sizeof(value));
+    }
+    append(out, literals_.data(), literals_.size() * sizeof(int));
+    append(out, &engine_clauses, sizeof(engine_clauses));
+    append(out, &state_bytes, sizeof(state_bytes));
+    append(out, state.data(), state.size());
+}
+
+void SATSolver::deserialize(const std::uint8_t* data, std::size_t size) {
+    Reader reader(data, size);
+    char magic[sizeof(kMagic)];
+    reader.read(magic, sizeof(magic));
+    if (std::memcmp(magic, kMagic, sizeof(kMagic)) != 0 || reader.value<std::uint32_t>() != kVersion) {
+        throw std::runtime_error("Not a serialized solver");
+    }
+    std::uint32_t num_vars = reader.value<std::uint32_t>();
+    std::uint64_t num_clauses = reader.value<std::uint64_t>();
+    std::uint64_t num_literals = reader.value<std::uint64_t>();
+    if (num_clauses >= reader.remaining() / sizeof(std::uint64_t) || num_literals > reader.remaining() / sizeof(int)) {
+        throw std::runtime_error("Truncated solver data");
+    }
+
+    std::vector<std::uint64_t> offsets(static_cast<std::size_t>(num_clauses + 1));
+    reader.read(offsets.data(), offsets.size() * sizeof(std::uint64_t));
+    if (offsets.front() != 0 || offsets.back() != num_literals ||
+        !std::is_sorted(offsets.begin(), offsets.end())) {
+        throw std::runtime_error("Corrupt clause offsets in solver data");
+    }
+    std::vector<int> literals(static_cast<std::size_t>(num_literals));
+    reader.read(literals.data(), literals.size() * sizeof(int));
+    for (int literal : literals) {
+        if (literal == 0 || literal == INT_MIN) {
+            throw std::runtime_error("Corrupt literals in solver data");
+        }
+    }
+
+    std::uint64_t engine_clauses = reader.value<std::uint64_t>();
+    std::uint64_t state_bytes = reader.value<std::uint64_t>();
+    if (engine_clauses > num_clauses || state_bytes != reader.remaining()) {
+        throw std::runtime_error("Corrupt engine state in solver data");
+    }
+    std::shared_ptr<CDCLSolver> engine;
+    if (state_bytes > 0) {
+        engine = std::make_shared<CDCLSolver>();
+        engine->load_state(data + (size - state_bytes), static_cast<std::size_t>(state_bytes));
+
+        // The engine must have been built from exactly the first engine_clauses clauses
+        std::uint64_t hash = CDCLSolver::kInputHashSeed;
+        for (std::size_t i = 0; i < engine_clauses; ++i) {
+            hash = CDCLSolver::hash_clause(hash, literals.data() + offsets[i], offsets[i + 1] - offsets[i]);
+        }
+        if (engine->get_num_variables() > static_cast<std::int64_t>(num_vars) ||
+            engine->get_input_clauses() != engine_clauses || engine->get_input_hash() != hash) {
+            throw std::runtime_error("Corrupt engine state in solver data");
+        }
+    } else if (engine_clauses != 0) {
+        throw std::runtime_error("Corrupt engine state in solver data");
+    }
+
+    clear();
+    literals_ = std::move(literals);
+    clause_offsets_.assign(offsets.begin(), offsets.end());
+    num_variables_ = static_cast<int>(num_vars);
+    on_literals_added(0);
+    engine_ = std::move(engine);
+    engine_clauses_ = static_cast<std::size_t>(engine_clauses);
+}
+
+void SATSolver::checkpoint(const std::string& path) const {
+    std::vector<std::uint8_t> data;
+    serialize(data);
+
+    // Write next to the target and rename, so a crash leaves the old checkpoint intact
+    std::string temp_path = path + ".tmp";
+    {
+        File file = open_file(temp_path, "wb");
+        if (!data.empty() && std::fwrite(data.data(), 1, data.size(), file.get()) != data.size()) {
+            throw std::runtime_error("Failed to write " + temp_path);
+        }
+        if (std::fflush(file.get()) != 0) {
+            throw std::runtime_error("Failed to write " + temp_path);
+        }
+    }
+    if (std::rename(temp_path.c_str(), path.c_str()) != 0) {
+        std::remove(temp_path.c_str());
+        throw std::runtime_error("Cannot replace " + path);
+    }
+}
+
+void SATSolver::restore(const std::string& path) {
+    File file = open_file(path, "rb");
+    std::vector<std::uint8_t> data;
+    std::uint8_t chunk[1 << 16];
+    std::size_t read;
+    while ((read = std::fread(chunk, 1, sizeof(chunk), file.get())) > 0) {
+        data.insert(data.end(), chunk, chunk + read);
+    }
+    if (std::ferror(file.get())) {
+        throw std::runtime_error("Failed to read " + path);
+    }
+
+    try {
+        deserialize(data.data(), data.size());
+    } catch (const std::runtime_error& e) {
+        throw std::runtime_error(path + ": " + e.what());
+    }
+}
+
+} // namespace sat_solver
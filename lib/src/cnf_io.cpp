@@ -0,0 +1,144 @@
+#include "cnf_io.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <sys/stat.h>
+
+namespace sat_solver {
+namespace utils {
+
+namespace {
+
+const char kMagic[4] = {'B', 'C', 'N', 'F'};
+const std::uint32_t kVersion = 1;
+const std::uint64_t kHeaderBytes = 4 + 4 + 4 + 8 + 8;   // magic, version, num_vars, num_clauses, num_literals
+
+struct FileCloser {
+    void operator()(std::FILE* file) const { std::fclose(file); }
+};
+using File = std::unique_ptr<std::FILE, FileCloser>;
+
+File open_file(const std::string& path, const char* mode) {
+    File file(std::fopen(path.c_str(), mode));
+    if (!file) {
+        throw std::runtime_error("Cannot open " + path);
+    }
+    return file;
+}
+
+void write_bytes(std::FILE* file, const void* data, std::size_t size, const std::string& path) {
+    if (size > 0 && std::fwrite(data, 1, size, file) != size) {
+        throw std::runtime_error("Failed to write " + path);
+    }
+}
+
+void read_bytes(std::FILE* file, void* data, std::size_t size, const std::string& path) {
+    if (size > 0 && std::fread(data, 1, size, file) != size) {
+        throw std::runtime_error("Truncated binary CNF file " + path);
+    }
+}
+
+void write_header(std::FILE* file, int num_vars, std::uint64_t num_clauses, std::uint64_t num_literals,
+                  const std::string& path) {
+    std::uint32_t vars = static_cast<std::uint32_t>(num_vars);
+    write_bytes(file, kMagic, sizeof(kMagic), path);
+    write_bytes(file, &kVersion, sizeof(kVersion), path);
+    write_bytes(file, &vars, sizeof(vars), path);
+    write_bytes(file, &num_clauses, sizeof(num_clauses), path);
+    write_bytes(file, &num_literals, sizeof(num_literals), path);
+}
+
+} // namespace
+
+void write_binary_cnf(const std::string& path, int num_vars, const int* literals,
+                      const std::int64_t* offsets, std::size_t num_clauses) {
+    std::int64_t zero = 0;
+    if (num_clauses == 0) {
+        offsets = &zero;
+    }
+    std::uint64_t num_literals = static_cast<std::uint64_t>(offsets[num_clauses]);
+
+    File file = open_file(path, "wb");
+    write_header(file.get(), num_vars, num_clauses, num_literals, path);
+    write_bytes(file.get(), offsets, (num_clauses + 1) * sizeof(std::int64_t), path);
+    write_bytes(file.get(), literals, num_literals * sizeof(int), path);
+    if (std::fflush(file.get()) != 0) {
+        throw std::runtime_error("Failed to write " + path);
+    }
+}
+
+void write_binary_cnf(const std::string& path, int num_vars, const int* literals,
+                      std::size_t num_clauses, std::size_t width) {
+    std::uint64_t num_literals = static_cast<std::uint64_t>(num_clauses) * width;
+
+    File file = open_file(path, "wb");
+    write_header(file.get(), num_vars, num_clauses, num_literals, path);
+
+    // Stream the implicit offsets in chunks instead of materialising them
+    std::int64_t chunk[1024];
+    for (std::size_t first = 0; first <= num_clauses; first += 1024) {
+        std::size_t count = std::min<std::size_t>(1024, num_clauses + 1 - first);
+        for (std::size_t i = 0; i < count; ++i) {
+            chunk[i] = static_cast<std::int64_t>((first + i) * width);
+        }
+        write_bytes(file.get(), chunk, count * sizeof(std::int64_t), path);
+    }
+    write_bytes(file.get(), literals, num_literals * sizeof(int), path);
+    if (std::fflush(file.get()) != 0) {
+        throw std::runtime_error("Failed to write " + path);
+    }
+}
+
+BinaryCNF read_binary_cnf(const std::string& path) {
+    File file = open_file(path, "rb");
+
+    char magic[4];
+    std::uint32_t version, num_vars;
+    std::uint64_t num_clauses, num_literals;
+    read_bytes(file.get(), magic, sizeof(magic), path);
+    if (std::memcmp(magic, kMagic, sizeof(kMagic)) != 0) {
+        throw std::runtime_error(path + " is not a binary CNF file");
+    }
+    read_bytes(file.get(), &version, sizeof(version), path);
+    if (version != kVersion) {
+        throw std::runtime_error("Unsupported binary CNF version in " + path);
+    }
+    read_bytes(file.get(), &num_vars, sizeof(num_vars), path);
+    read_bytes(file.get(), &num_clauses, sizeof(num_clauses), path);
+    read_bytes(file.get(), &num_literals, sizeof(num_literals), path);
+
+    // The counts size the buffers below; make sure the file can hold them before allocating
+    struct stat st;
+    if (fstat(fileno(file.get()), &st) == 0 && S_ISREG(st.st_mode)) {
+        std::uint64_t body = static_cast<std::uint64_t>(st.st_size) - kHeaderBytes;
+        if (num_clauses >= body / sizeof(std::int64_t) ||
+            num_literals > (body - (num_clauses + 1) * sizeof(std::int64_t)) / sizeof(int) ||
+            (num_clauses + 1) * sizeof(std::int64_t) + num_literals * sizeof(int) != body) {
+            throw std::runtime_error("Binary CNF header of " + path + " does not match the file size");
+        }
+    }
+
+    BinaryCNF cnf;
+    cnf.num_vars = static_cast<int>(num_vars);
+    cnf.clause_offsets.resize(num_clauses + 1);
+    cnf.literals.resize(num_literals);
+    read_bytes(file.get(), cnf.clause_offsets.data(), cnf.clause_offsets.size() * sizeof(std::int64_t), path);
+    read_bytes(file.get(), cnf.literals.data(), cnf.literals.size() * sizeof(int), path);
+
+    if (cnf.clause_offsets.front() != 0 ||
+        cnf.clause_offsets.back() != static_cast<std::int64_t>(num_literals)) {
+        throw std::runtime_error("Corrupt clause offsets in " + path);
+    }
+    for (std::size_t i = 0; i < num_clauses; ++i) {
+        if (cnf.clause_offsets[i + 1] < cnf.clause_offsets[i]) {
+            throw std::runtime_error("Corrupt clause offsets in " + path);
+        }
+    }
+
+    return cnf;
+}
+
+} // namespace utils
+} // namespace sat_solver
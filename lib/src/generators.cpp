@@ -0,0 +1,524 @@
+#include "generators.h"
+#include "cdcl_solver.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <set>
+#include <stdexcept>
+#include <vector>
+
+namespace sat_solver {
+namespace utils {
+
+namespace {
+
+const std::uint32_t kPhiloxM0 = 0xD2511F53u;
+const std::uint32_t kPhiloxM1 = 0xCD9E8D57u;
+const std::uint32_t kPhiloxW0 = 0x9E3779B9u;
+const std::uint32_t kPhiloxW1 = 0xBB67AE85u;
+const int kRegularRepairAttempts = 64;
+const int kRegularMixingRounds = 8;
+const int kCutAttempts = 64;
+const int kPlantAttempts = 4096;
+
+void validate(const InstanceSpec& spec) {
+    if (spec.k < 1) {
+        throw std::invalid_argument("Clause width k must be at least 1");
+    }
+    if (spec.num_vars < spec.k) {
+        throw std::invalid_argument("Need at least k variables for clauses with distinct variables");
+    }
+    if (spec.num_clauses < 0) {
+        throw std::invalid_argument("Number of clauses must be non-negative");
+    }
+}
+
+/**
+ * Fill one clause with k distinct variables (rejection sampling, k << n in practice).
+ */
+void draw_variables(PhiloxStream& rng, int num_vars, int k, int* clause) {
+    for (int j = 0; j < k; ++j) {
+        int var;
+        bool fresh;
+        do {
+            var = static_cast<int>(rng.uniform(num_vars)) + 1;
+            fresh = std::find(clause, clause + j, var) == clause + j;
+        } while (!fresh);
+        clause[j] = var;
+    }
+}
+
+void generate_uniform(const InstanceSpec& spec, PhiloxStream& rng, int* literals) {
+    for (int i = 0; i < spec.num_clauses; ++i) {
+        int* clause = literals + static_cast<std::size_t>(i) * spec.k;
+        draw_variables(rng, spec.num_vars, spec.k, clause);
+        for (int j = 0; j < spec.k; ++j) {
+            if (rng.next() & 1u) {
+                clause[j] = -clause[j];
+            }
+        }
+    }
+}
+
+void generate_planted(const InstanceSpec& spec, PhiloxStream& rng, int* literals, std::uint8_t* solution) {
+    std::vector<std::uint8_t> hidden(spec.num_vars);
+    for (auto& value : hidden) {
+        value = rng.next() & 1u;
+    }
+
+    for (int i = 0; i < spec.num_clauses; ++i) {
+        int* clause = literals + static_cast<std::size_t>(i) * spec.k;
+        draw_variables(rng, spec.num_vars, spec.k, clause);
+
+        // Redraw the signs until some literal agrees with the hidden assignment
+        bool satisfied;
+        do {
+            satisfied = false;
+            for (int j = 0; j < spec.k; ++j) {
+                int var = std::abs(clause[j]);
+                bool positive = rng.next() & 1u;
+                clause[j] = positive ? var : -var;
+                satisfied |= positive == (hidden[var - 1] != 0);
+            }
+        } while (!satisfied);
+    }
+
+    if (solution) {
+        std::copy(hidden.begin(), hidden.end(), solution);
+    }
+}
+
+bool clause_has_var(const int* clause, int k, int var, int skip) {
+    for (int j = 0; j < k; ++j) {
+        if (j != skip && std::abs(clause[j]) == var) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool has_repeated_var(const InstanceSpec& spec, const int* literals) {
+    for (int i = 0; i < spec.num_clauses; ++i) {
+        const int* clause = literals + static_cast<std::size_t>(i) * spec.k;
+        for (int j = 1; j < spec.k; ++j) {
+            if (clause_has_var(clause, j, std::abs(clause[j]), -1)) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+/**
+ * Deal the occurrences so that no clause can repeat a variable: grouped by
+ * variable in a random order and written column by column, a variable's
+ * occurrences land in distinct clauses because there are at most
+ * num_clauses of them. Swaps that keep both clauses valid then mix the layout.
+ */
+void deal_by_columns(const InstanceSpec& spec, PhiloxStream& rng, int* literals) {
+    std::size_t total = static_cast<std::size_t>(spec.num_clauses) * spec.k;
+    std::uint32_t slots = static_cast<std::uint32_t>(std::min<std::size_t>(total, UINT32_MAX));
+    int k = spec.k;
+
+    std::vector<std::uint32_t> rank(spec.num_vars);
+    for (int v = 0; v < spec.num_vars; ++v) {
+        rank[v] = v;
+    }
+    for (int v = spec.num_vars - 1; v > 0; --v) {
+        std::swap(rank[v], rank[rng.uniform(v + 1)]);
+    }
+    std::vector<int> grouped(literals, literals + total);
+    std::stable_sort(grouped.begin(), grouped.end(), [&rank](int a, int b) {
+        return rank[std::abs(a) - 1] < rank[std::abs(b) - 1];
+    });
+    for (std::size_t t = 0; t < total; ++t) {
+        literals[t % spec.num_clauses * k + t / spec.num_clauses] = grouped[t];
+    }
+
+    for (std::size_t step = 0; step < kRegularMixingRounds * total; ++step) {
+        std::size_t a = rng.uniform(slots), b = rng.uniform(slots);
+        int* clause_a = literals + a / k * k;
+        int* clause_b = literals + b / k * k;
+        int j_a = static_cast<int>(a % k), j_b = static_cast<int>(b % k);
+        if (clause_a == clause_b ||
+            clause_has_var(clause_a, k, std::abs(clause_b[j_b]), j_a) ||
+            clause_has_var(clause_b, k, std::abs(clause_a[j_a]), j_b)) {
+            continue;
+        }
+        std::swap(clause_a[j_a], clause_b[j_b]);
+    }
+}
+
+void generate_regular(const InstanceSpec& spec, PhiloxStream& rng, int* literals) {
+    std::size_t total = static_cast<std::size_t>(spec.num_clauses) * spec.k;
+    if (total == 0) {
+        return;
+    }
+
+    // Deal occurrences round-robin from a random starting variable, alternating signs
+    std::uint32_t start = rng.uniform(spec.num_vars);
+    for (std::size_t s = 0; s < total; ++s) {
+        std::size_t round = s / spec.num_vars;
+        int var = static_cast<int>((start + s) % spec.num_vars) + 1;
+        literals[s] = (round & 1u) ? -var : var;
+    }
+
+    // Fisher-Yates shuffle of all occurrence slots
+    for (std::size_t s = total - 1; s > 0; --s) {
+        std::size_t other = rng.uniform(static_cast<std::uint32_t>(std::min<std::size_t>(s + 1, UINT32_MAX)));
+        std::swap(literals[s], literals[other]);
+    }
+
+    // Repair clauses that received the same variable twice by swapping with a random slot
+    int k = spec.k;
+    for (int i = 0; i < spec.num_clauses; ++i) {
+        int* clause = literals + static_cast<std::size_t>(i) * k;
+        for (int j = 0; j < k; ++j) {
+            for (int attempt = 0; attempt < kRegularRepairAttempts; ++attempt) {
+                if (!clause_has_var(clause, k, std::abs(clause[j]), j)) {
+                    break;
+                }
+                std::size_t slot = rng.uniform(static_cast<std::uint32_t>(std::min<std::size_t>(total, UINT32_MAX)));
+                int* other = literals + slot / k * k;
+                int other_j = static_cast<int>(slot % k);
+                if (other == clause ||
+                    clause_has_var(clause, k, std::abs(other[other_j]), j) ||
+                    clause_has_var(other, k, std::abs(clause[j]), other_j)) {
+                    continue;
+                }
+                std::swap(clause[j], other[other_j]);
+            }
+        }
+    }
+
+    // Tight shapes (k close to num_vars) can defeat the repair
+    if (has_repeated_var(spec, literals)) {
+        deal_by_columns(spec, rng, literals);
+    }
+}
+
+void validate(const PlantedSpec& spec) {
+    InstanceSpec shape;
+    shape.num_vars = spec.num_vars;
+    shape.num_clauses = spec.num_clauses;
+    shape.k = spec.k;
+    validate(shape);
+    if (spec.mode == PlantingMode::QUIET && spec.k < 3) {
+        throw std::invalid_argument("Quiet planting needs clauses of width 3 or more");
+    }
+}
+
+double uniform_real(PhiloxStream& rng) {
+    return rng.next() * (1.0 / 4294967296.0);
+}
+
+/**
+ * Solve sum_{t=1..k} C(k, t) q^t (2t - k) = 0 for q in (0, 1): accepting a
+ * clause with t true literals with weight q^t makes every literal equally
+ * likely to be true or false under the planted model (q = 0.618 for k = 3).
+ */
+double quiet_weight(int k) {
+    auto balance = [k](double q) {
+        double sum = 0.0, binomial = 1.0;
+        for (int t = 1; t <= k; ++t) {
+            binomial = binomial * (k - t + 1) / t;
+            sum += binomial * std::pow(q, t) * (2 * t - k);
+        }
+        return sum;
+    };
+    double lo = 0.0, hi = 1.0;
+    for (int i = 0; i < 60; ++i) {
+        double mid = 0.5 * (lo + hi);
+        (balance(mid) < 0.0 ? lo : hi) = mid;
+    }
+    return 0.5 * (lo + hi);
+}
+
+bool model_satisfies(const std::uint8_t* model, const int* clause, std::size_t size) {
+    for (std::size_t j = 0; j < size; ++j) {
+        int var = std::abs(clause[j]);
+        if ((clause[j] > 0) == (model[var - 1] != 0)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool all_satisfy(const std::uint8_t* models, std::size_t num_models, int num_vars,
+                 const int* clause, std::size_t size) {
+    for (std::size_t m = 0; m < num_models; ++m) {
+        if (!model_satisfies(models + m * num_vars, clause, size)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Build a clause that is falsified by `extra` but satisfied by every planted model.
+ */
+std::vector<int> cutting_clause(const PlantedSpec& spec, const std::uint8_t* models, std::size_t num_models,
+                                const std::vector<bool>& extra, PhiloxStream& rng) {
+    auto falsified_by_extra = [&](int var) { return extra[var - 1] ? -var : var; };
+    std::vector<int> clause(spec.k);
+
+    for (int attempt = 0; attempt < kCutAttempts; ++attempt) {
+        draw_variables(rng, spec.num_vars, spec.k, clause.data());
+        for (int& lit : clause) {
+            lit = falsified_by_extra(lit);
+        }
+        if (all_satisfy(models, num_models, spec.num_vars, clause.data(), clause.size())) {
+            return clause;
+        }
+    }
+
+    // Widen the last attempt: for each planted model it misses, add a variable
+    // on which that model differs from the extra one
+    for (std::size_t m = 0; m < num_models; ++m) {
+        const std::uint8_t* model = models + m * spec.num_vars;
+        if (model_satisfies(model, clause.data(), clause.size())) {
+            continue;
+        }
+        std::vector<int> differing;
+        for (int v = 1; v <= spec.num_vars; ++v) {
+            if ((model[v - 1] != 0) != extra[v - 1]) {
+                differing.push_back(v);
+            }
+        }
+        int var = differing[rng.uniform(static_cast<std::uint32_t>(differing.size()))];
+        clause.push_back(falsified_by_extra(var));
+    }
+    return clause;
+}
+
+/**
+ * Find an assignment that is none of the planted models: a few random draws,
+ * then the first num_models + 1 assignments counting up in binary, one of
+ * which is free because the models are distinct and fewer than 2^num_vars.
+ */
+std::vector<bool> free_assignment(const PlantedSpec& spec, const std::uint8_t* models, std::size_t num_models,
+                                  PhiloxStream& rng) {
+    std::set<std::vector<std::uint8_t>> planted;
+    for (std::size_t m = 0; m < num_models; ++m) {
+        planted.emplace(models + m * spec.num_vars, models + (m + 1) * spec.num_vars);
+    }
+
+    std::vector<std::uint8_t> row(spec.num_vars);
+    for (int attempt = 0; attempt < kCutAttempts; ++attempt) {
+        for (auto& value : row) {
+            value = rng.next() & 1u;
+        }
+        if (!planted.count(row)) {
+            return std::vector<bool>(row.begin(), row.end());
+        }
+    }
+    for (std::size_t x = 0; x <= num_models; ++x) {
+        for (int v = 0; v < spec.num_vars; ++v) {
+            row[v] = v < 64 ? (x >> v) & 1u : 0;
+        }
+        if (!planted.count(row)) {
+            break;
+        }
+    }
+    return std::vector<bool>(row.begin(), row.end());
+}
+
+PlantedFormula plant(const PlantedSpec& spec, const std::uint8_t* models, std::size_t num_models,
+                     PhiloxStream& rng) {
+    if (spec.num_clauses > 0 && spec.num_vars < 31 && num_models >= (static_cast<std::size_t>(1) << spec.num_vars)) {
+        throw std::invalid_argument("Cannot plant clauses when every assignment is a planted model");
+    }
+
+    PlantedFormula result;
+    result.num_vars = spec.num_vars;
+    result.models.assign(models, models + num_models * spec.num_vars);
+    result.num_models = num_models;
+    result.literals.reserve(static_cast<std::size_t>(spec.num_clauses) * spec.k);
+    result.clause_offsets.reserve(spec.num_clauses + 1);
+    result.clause_offsets.push_back(0);
+
+    double q = spec.mode == PlantingMode::QUIET ? quiet_weight(spec.k) : 1.0;
+    std::vector<int> clause(spec.k);
+    auto draw_clause = [&]() {
+        clause.resize(spec.k);
+        draw_variables(rng, spec.num_vars, spec.k, clause.data());
+        int true_literals = 0;
+        for (int& lit : clause) {
+            if (rng.next() & 1u) {
+                lit = -lit;
+            }
+            true_literals += (lit > 0) == (models[std::abs(lit) - 1] != 0);
+        }
+        if (true_literals == 0 || !all_satisfy(models, num_models, spec.num_vars, clause.data(), clause.size())) {
+            return false;
+        }
+        // Quiet planting keeps a clause with t true literals with probability q^(t-1)
+        return q >= 1.0 || uniform_real(rng) < std::pow(q, true_literals - 1);
+    };
+
+    for (int i = 0; i < spec.num_clauses; ++i) {
+        int attempt = 0;
+        while (attempt < kPlantAttempts && !draw_clause()) {
+            ++attempt;
+        }
+        if (attempt == kPlantAttempts) {
+            // Dense model sets leave few or no width-k clauses: cut off a free
+            // assignment instead, widening the clause as far as needed
+            clause = cutting_clause(spec, models, num_models, free_assignment(spec, models, num_models, rng), rng);
+        }
+        result.literals.insert(result.literals.end(), clause.begin(), clause.end());
+        result.clause_offsets.push_back(result.literals.size());
+    }
+
+    if (spec.exact) {
+        // Probe = formula + blocking clauses for the planted models; any model it
+        // still has is an unwanted extra one to cut off
+        CDCLSolver probe;
+        probe.reserve_vars(spec.num_vars);
+        for (int i = 0; i < spec.num_clauses; ++i) {
+            probe.add_clause(result.literals.data() + result.clause_offsets[i],
+                             result.clause_offsets[i + 1] - result.clause_offsets[i]);
+        }
+        std::vector<int> blocking(spec.num_vars);
+        for (std::size_t m = 0; m < num_models; ++m) {
+            for (int v = 0; v < spec.num_vars; ++v) {
+                blocking[v] = models[m * spec.num_vars + v] ? -(v + 1) : v + 1;
+            }
+            probe.add_clause(blocking.data(), blocking.size());
+        }
+
+        while (probe.solve() == SolveStatus::SAT) {
+            std::vector<int> cut = cutting_clause(spec, models, num_models, probe.get_model(), rng);
+            result.literals.insert(result.literals.end(), cut.begin(), cut.end());
+            result.clause_offsets.push_back(result.literals.size());
+            if (!probe.add_clause(cut.data(), cut.size())) {
+                break;
+            }
+        }
+        result.exact = true;
+    }
+
+    return result;
+}
+
+} // namespace
+
+PhiloxStream::PhiloxStream(std::uint64_t seed, std::uint64_t stream) : index_(4) {
+    key_[0] = static_cast<std::uint32_t>(seed);
+    key_[1] = static_cast<std::uint32_t>(seed >> 32);
+    counter_[0] = 0;
+    counter_[1] = 0;
+    counter_[2] = static_cast<std::uint32_t>(stream);
+    counter_[3] = static_cast<std::uint32_t>(stream >> 32);
+}
+
+void PhiloxStream::block(const std::uint32_t counter[4], const std::uint32_t key[2], std::uint32_t out[4]) {
+    std::uint32_t c0 = counter[0], c1 = counter[1], c2 = counter[2], c3 = counter[3];
+    std::uint32_t k0 = key[0], k1 = key[1];
+
+    for (int round = 0; round < 10; ++round) {
+        std::uint64_t p0 = static_cast<std::uint64_t>(kPhiloxM0) * c0;
+        std::uint64_t p1 = static_cast<std::uint64_t>(kPhiloxM1) * c2;
+        std::uint32_t n0 = static_cast<std::uint32_t>(p1 >> 32) ^ c1 ^ k0;
+        std::uint32_t n2 = static_cast<std::uint32_t>(p0 >> 32) ^ c3 ^ k1;
+        c1 = static_cast<std::uint32_t>(p1);
+        c3 = static_cast<std::uint32_t>(p0);
+        c0 = n0;
+        c2 = n2;
+        k0 += kPhiloxW0;
+        k1 += kPhiloxW1;
+    }
+
+    out[0] = c0;
+    out[1] = c1;
+    out[2] = c2;
+    out[3] = c3;
+}
+
+void PhiloxStream::refill() {
+    block(counter_, key_, buffer_);
+    if (++counter_[0] == 0) {
+        ++counter_[1];
+    }
+    index_ = 0;
+}
+
+void generate_instance(const InstanceSpec& spec, std::uint64_t seed, std::uint64_t stream,
+                       int* literals, std::uint8_t* solution) {
+    validate(spec);
+    PhiloxStream rng(seed, stream);
+
+    switch (spec.kind) {
+    case InstanceKind::UNIFORM:
+        generate_uniform(spec, rng, literals);
+        break;
+    case InstanceKind::PLANTED:
+        generate_planted(spec, rng, literals, solution);
+        break;
+    case InstanceKind::REGULAR:
+        generate_regular(spec, rng, literals);
+        break;
+    }
+}
+
+void generate_instances(const InstanceSpec& spec, std::uint64_t seed, std::size_t count,
+                        int* literals, std::uint8_t* solutions, unsigned num_threads) {
+    validate(spec);
+    std::size_t formula_size = static_cast<std::size_t>(spec.num_clauses) * spec.k;
+
+    parallel_for(count, num_threads, [&](std::size_t i) {
+        generate_instance(spec, seed, i, literals + i * formula_size,
+                          solutions ? solutions + i * spec.num_vars : nullptr);
+    });
+}
+
+PlantedFormula plant_solutions(const PlantedSpec& spec, const std::uint8_t* models, std::size_t num_models,
+                               std::uint64_t seed, std::uint64_t stream) {
+    validate(spec);
+    if (num_models == 0) {
+        throw std::invalid_argument("Need at least one model to plant");
+    }
+    std::set<std::vector<std::uint8_t>> distinct;
+    for (std::size_t m = 0; m < num_models; ++m) {
+        std::vector<std::uint8_t> row(models + m * spec.num_vars, models + (m + 1) * spec.num_vars);
+        for (auto& value : row) {
+            if (value > 1) {
+                throw std::invalid_argument("Planted model values must be 0 or 1");
+            }
+        }
+        if (!distinct.insert(row).second) {
+            throw std::invalid_argument("Planted models must be distinct");
+        }
+    }
+
+    PhiloxStream rng(seed, stream);
+    return plant(spec, models, num_models, rng);
+}
+
+PlantedFormula generate_planted_formula(const PlantedSpec& spec, std::uint64_t seed, std::uint64_t stream) {
+    validate(spec);
+    if (spec.num_solutions < 1 ||
+        (spec.num_vars < 31 && spec.num_solutions > (1 << spec.num_vars))) {
+        throw std::invalid_argument("num_solutions must be between 1 and 2^num_vars");
+    }
+
+    PhiloxStream rng(seed, stream);
+    std::set<std::vector<std::uint8_t>> distinct;
+    std::vector<std::uint8_t> models;
+    models.reserve(static_cast<std::size_t>(spec.num_solutions) * spec.num_vars);
+    std::vector<std::uint8_t> row(spec.num_vars);
+    while (distinct.size() < static_cast<std::size_t>(spec.num_solutions)) {
+        for (auto& value : row) {
+            value = rng.next() & 1u;
+        }
+        if (distinct.insert(row).second) {
+            models.insert(models.end(), row.begin(), row.end());
+        }
+    }
+
+    return plant(spec, models.data(), spec.num_solutions, rng);
+}
+
+} // namespace utils
+} // namespace sat_solver
@@ -0,0 +1,525 @@
+#include "lookahead_solver.h"
+#include <algorithm>
+#include <cstdlib>
+
+namespace sat_solver {
+
+namespace {
+
+const std::size_t kMinCandidates = 40;
+const double kCandidateFraction = 0.1;   // share of the free variables looked ahead on
+const double kTriggerDecay = 0.9;        // per node decay of the double lookahead trigger
+const double kProductWeight = 1024.0;    // weight of diff(x) * diff(-x) in the branching score
+
+} // namespace
+
+LookaheadSolver::LookaheadSolver()
+    : num_vars_(0), ok_(true), long_offsets_(1, 0), qhead_(0), root_size_(0), stamp_counter_(0),
+      double_trigger_(0.0), cancel_(nullptr), propagations_(0), propagation_limit_(UINT64_MAX),
+      conflicts_(0), timed_(false), interrupted_(false) {}
+
+void LookaheadSolver::reserve_vars(int num_vars) {
+    if (num_vars <= num_vars_) {
+        return;
+    }
+    std::size_t num_lits = 2 * static_cast<std::size_t>(num_vars);
+    binaries_.resize(num_lits);
+    ternaries_.resize(num_lits);
+    watches_.resize(num_lits);
+    value_.resize(num_lits, 0);
+    diff_.resize(num_lits, 0.0);
+    occurrences_.resize(num_lits, 0);
+    stamp_.resize(num_lits, 0);
+    num_vars_ = num_vars;
+}
+
+bool LookaheadSolver::add_clause(const int* literals, std::size_t size) {
+    if (!ok_) {
+        return false;
+    }
+
+    int max_var = 0;
+    for (std::size_t i = 0; i < size; ++i) {
+        max_var = std::max(max_var, std::abs(literals[i]));
+    }
+    reserve_vars(max_var);
+
+    std::vector<Lit> lits;
+    lits.reserve(size);
+    for (std::size_t i = 0; i < size; ++i) {
+        lits.push_back(to_lit(literals[i]));
+    }
+    std::sort(lits.begin(), lits.end());
+
+    // Drop duplicates and top-level false literals; skip tautologies and satisfied clauses
+    std::size_t j = 0;
+    for (std::size_t i = 0; i < lits.size(); ++i) {
+        Lit lit = lits[i];
+        if (value(lit) > 0 || (j > 0 && lits[j - 1] == neg(lit))) {
+            return true;
+        }
+        if (value(lit) < 0 || (j > 0 && lits[j - 1] == lit)) {
+            continue;
+        }
+        lits[j++] = lit;
+    }
+    lits.resize(j);
+
+    for (Lit lit : lits) {
+        ++occurrences_[lit];
+    }
+    switch (lits.size()) {
+    case 0:
+        ok_ = false;
+        break;
+    case 1:
+        ok_ = assume(lits[0]);
+        root_size_ = trail_.size();
+        break;
+    case 2:
+        binaries_[lits[0]].push_back(lits[1]);
+        binaries_[lits[1]].push_back(lits[0]);
+        break;
+    case 3:
+        ternaries_[lits[0]].push_back({lits[1], lits[2]});
+        ternaries_[lits[1]].push_back({lits[0], lits[2]});
+        ternaries_[lits[2]].push_back({lits[0], lits[1]});
+        break;
+    default: {
+        std::uint32_t index = static_cast<std::uint32_t>(long_offsets_.size() - 1);
+        long_lits_.insert(long_lits_.end(), lits.begin(), lits.end());
+        long_offsets_.push_back(long_lits_.size());
+        watches_[lits[0]].push_back(index);
+        watches_[lits[1]].push_back(index);
+        break;
+    }
+    }
+    return ok_;
+}
+
+void LookaheadSolver::assign(Lit lit) {
+    value_[lit] = 1;
+    value_[neg(lit)] = -1;
+    trail_.push_back(lit);
+}
+
+void LookaheadSolver::undo_until(std::size_t trail_size) {
+    for (std::size_t i = trail_.size(); i-- > trail_size;) {
+        value_[trail_[i]] = 0;
+        value_[neg(trail_[i])] = 0;
+    }
+    trail_.resize(trail_size);
+    qhead_ = trail_size;
+}
+
+bool LookaheadSolver::propagate(double* new_binaries) {
+    while (qhead_ < trail_.size()) {
+        if (++propagations_ >= propagation_limit_ || (cancel_ && cancel_->cancelled()) ||
+            (timed_ && (propagations_ & 1023) == 0 && std::chrono::steady_clock::now() >= deadline_)) {
+            interrupted_ = true;
+            return false;
+        }
+        SAT_STAT_ADD(stats_, propagations, 1);
+        Lit falsified = neg(trail_[qhead_++]);
+
+        for (Lit other : binaries_[falsified]) {
+            std::int8_t v = value(other);
+            if (v < 0) {
+                return false;
+            }
+            if (v == 0) {
+                assign(other);
+            }
+        }
+
+        for (const Pair& rest : ternaries_[falsified]) {
+            std::int8_t a = value(rest.first);
+            std::int8_t b = value(rest.second);
+            if (a > 0 || b > 0) {
+                continue;
+            }
+            if (a < 0 && b < 0) {
+                return false;
+            }
+            if (a < 0) {
+                assign(rest.second);
+            } else if (b < 0) {
+                assign(rest.first);
+            } else if (new_binaries) {
+                *new_binaries += 1.0;   // first literal of this clause to be falsified
+            }
+        }
+
+        std::vector<std::uint32_t>& watchers = watches_[falsified];
+        std::size_t i = 0, j = 0;
+        while (i < watchers.size()) {
+            std::uint32_t index = watchers[i++];
+            Lit* lits = &long_lits_[long_offsets_[index]];
+            std::size_t size = long_offsets_[index + 1] - long_offsets_[index];
+            if (lits[0] == falsified) {
+                std::swap(lits[0], lits[1]);
+            }
+            if (value(lits[0]) > 0) {
+                watchers[j++] = index;
+                continue;
+            }
+
+            bool moved = false;
+            for (std::size_t k = 2; k < size; ++k) {
+                if (value(lits[k]) >= 0) {
+                    std::swap(lits[1], lits[k]);
+                    watches_[lits[1]].push_back(index);
+                    moved = true;
+                    break;
+                }
+            }
+            if (moved) {
+                continue;
+            }
+
+            watchers[j++] = index;
+            if (value(lits[0]) < 0) {
+                while (i < watchers.size()) {
+                    watchers[j++] = watchers[i++];
+                }
+                watchers.resize(j);
+                return false;
+            }
+            assign(lits[0]);
+        }
+        watchers.resize(j);
+    }
+    return true;
+}
+
+bool LookaheadSolver::assume(Lit lit, double* new_binaries) {
+    if (value(lit) != 0) {
+        return value(lit) > 0;
+    }
+    assign(lit);
+    return propagate(new_binaries);
+}
+
+void LookaheadSolver::preselect(std::vector<int>& candidates) const {
+    candidates.clear();
+    for (int v = 0; v < num_vars_; ++v) {
+        Lit pos = 2u * v;
+        if (value(pos) == 0 && occurrences_[pos] + occurrences_[pos + 1] > 0) {
+            candidates.push_back(v);
+        }
+    }
+
+    std::size_t keep = std::max(kMinCandidates, static_cast<std::size_t>(kCandidateFraction * candidates.size()));
+    if (candidates.size() <= keep) {
+        return;
+    }
+
+    // Rank by occurrences, sharpened by the reductions seen at earlier nodes
+    auto score = [this](int v) {
+        Lit pos = 2u * v;
+        return (occurrences_[pos] + diff_[pos]) * (occurrences_[pos + 1] + diff_[pos + 1]);
+    };
+    std::nth_element(candidates.begin(), candidates.begin() + keep, candidates.end(),
+                     [&](int a, int b) { return score(a) > score(b) || (score(a) == score(b) && a < b); });
+    candidates.resize(keep);
+}
+
+bool LookaheadSolver::double_lookahead(const std::vector<int>& candidates) {
+    for (int v : candidates) {
+        for (Lit lit = 2u * v; lit <= 2u * v + 1; ++lit) {
+            if (value(lit) != 0) {
+                continue;
+            }
+            std::size_t mark = trail_.size();
+            bool ok = assume(lit);
+            undo_until(mark);
+            if (interrupted_) {
+                return false;
+            }
+            if (!ok && !assume(neg(lit))) {
+                return !interrupted_;
+            }
+        }
+    }
+    return false;
+}
+
+bool LookaheadSolver::lookahead(Lit& branch) {
+    branch = kNoLit;
+    double_trigger_ *= kTriggerDecay;
+    std::vector<int> candidates;
+
+    // Repeat until a round fixes nothing new
+    bool progress = true;
+    while (progress) {
+        progress = false;
+        preselect(candidates);
+        if (candidates.empty()) {
+            return true;
+        }
+
+        for (int v : candidates) {
+            Lit pos = 2u * v;
+            if (value(pos) != 0) {
+                continue;
+            }
+            std::size_t mark = trail_.size();
+            double reduction[2] = {0.0, 0.0};
+            bool ok[2];
+
+            for (int side = 0; side < 2; ++side) {
+                Lit lit = pos + side;
+                ok[side] = assume(lit, &reduction[side]);
+                if (ok[side] && reduction[side] > double_trigger_) {
+                    bool failed = double_lookahead(candidates);
+                    ok[side] = !failed;
+                    if (!failed) {
+                        double_trigger_ = reduction[side];
+                    }
+                }
+                if (interrupted_) {
+                    undo_until(mark);
+                    return false;
+                }
+
+                // Literals implied by both polarities are necessary
+                if (side == 0) {
+                    ++stamp_counter_;
+                    for (std::size_t i = mark + 1; ok[0] && i < trail_.size(); ++i) {
+                        stamp_[trail_[i]] = stamp_counter_;
+                    }
+                } else {
+                    forced_.clear();
+                    for (std::size_t i = mark + 1; ok[1] && i < trail_.size(); ++i) {
+                        if (stamp_[trail_[i]] == stamp_counter_) {
+                            forced_.push_back(trail_[i]);
+                        }
+                    }
+                }
+                undo_until(mark);
+
+                if (!ok[side]) {
+                    // Failed literal: its negation holds at this node
+                    progress = true;
+                    if (!assume(neg(lit))) {
+                        return false;
+                    }
+                    break;
+                }
+            }
+            if (!ok[0] || !ok[1]) {
+                continue;
+            }
+
+            diff_[pos] = reduction[0];
+            diff_[pos + 1] = reduction[1];
+            for (Lit lit : forced_) {
+                progress = true;
+                if (!assume(lit)) {
+                    return false;
+                }
+            }
+        }
+    }
+
+    // Branch on the variable whose two lookaheads both reduce the formula most
+    double best = -1.0;
+    for (int v : candidates) {
+        Lit pos = 2u * v;
+        if (value(pos) != 0) {
+            continue;
+        }
+        double score = kProductWeight * diff_[pos] * diff_[pos + 1] + diff_[pos] + diff_[pos + 1];
+        if (score > best) {
+            best = score;
+            // Try the polarity that reduces less first; it is more likely to be satisfiable
+            branch = diff_[pos] <= diff_[pos + 1] ? pos : pos + 1;
+        }
+    }
+    return true;
+}
+
+bool LookaheadSolver::backtrack(std::vector<Branch>& branches) {
+    while (!branches.empty()) {
+        Branch& top = branches.back();
+        undo_until(top.trail_size);
+        if (!top.flipped) {
+            top.flipped = true;
+            if (assume(neg(top.lit)) || interrupted_) {
+                return true;
+            }
+            on_conflict();
+            continue;
+        }
+        branches.pop_back();
+    }
+    return false;
+}
+
+void LookaheadSolver::on_conflict() {
+    ++conflicts_;
+    SAT_STAT_ADD(stats_, conflicts, 1);
+}
+
+void LookaheadSolver::begin_search(const SolveLimits& limits) {
+    cancel_ = limits.cancel.get();
+    propagation_limit_ = limits.max_propagations > 0 ? propagations_ + limits.max_propagations : UINT64_MAX;
+    conflicts_ = 0;
+    timed_ = limits.max_seconds > 0.0;
+    deadline_ = std::chrono::steady_clock::now() +
+                std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                    std::chrono::duration<double>(timed_ ? limits.max_seconds : 0.0));
+    interrupted_ = false;
+}
+
+void LookaheadSolver::end_search() {
+    cancel_ = nullptr;
+    propagation_limit_ = UINT64_MAX;
+    timed_ = false;
+    interrupted_ = false;
+}
+
+void LookaheadSolver::record_model() {
+    model_.assign(num_vars_, false);
+    for (int v = 0; v < num_vars_; ++v) {
+        model_[v] = value(2u * v) > 0;
+    }
+}
+
+SolveStatus LookaheadSolver::solve(const SolveLimits& limits) {
+    PhaseTimer timer(stats_.total_seconds);
+    model_.clear();
+    if (!ok_) {
+        return SolveStatus::UNSAT;
+    }
+    begin_search(limits);
+
+    std::vector<Branch> branches;
+    SolveStatus result = SolveStatus::UNKNOWN;
+    for (;;) {
+        if (limits.max_conflicts > 0 && conflicts_ >= limits.max_conflicts) {
+            break;
+        }
+
+        Lit branch;
+        bool alive;
+        {
+            PhaseTimer lookahead_timer(stats_.propagate_seconds);
+            alive = lookahead(branch);
+        }
+        if (interrupted_) {
+            break;
+        }
+        if (branches.empty()) {
+            root_size_ = trail_.size();   // facts found at the root hold for good
+        }
+        if (alive && branch == kNoLit) {
+            record_model();
+            result = SolveStatus::SAT;
+            break;
+        }
+
+        if (alive) {
+            SAT_STAT_ADD(stats_, decisions, 1);
+            branches.push_back({trail_.size(), branch, false});
+            alive = assume(branch);
+            if (interrupted_) {
+                break;
+            }
+        }
+        if (!alive) {
+            on_conflict();
+            if (!backtrack(branches)) {
+                result = SolveStatus::UNSAT;
+                break;
+            }
+        }
+    }
+
+    undo_until(root_size_);
+    end_search();
+    if (result == SolveStatus::UNSAT) {
+        ok_ = false;
+    }
+    return result;
+}
+
+CubeSplit LookaheadSolver::split(int depth, const SolveLimits& limits) {
+    PhaseTimer timer(stats_.total_seconds);
+    CubeSplit result;
+    model_.clear();
+    if (!ok_) {
+        result.status = SolveStatus::UNSAT;
+        return result;
+    }
+    begin_search(limits);
+
+    std::vector<Branch> branches;
+    for (;;) {
+        if (limits.max_conflicts > 0 && conflicts_ >= limits.max_conflicts) {
+            interrupted_ = true;
+            break;
+        }
+
+        Lit branch;
+        bool alive;
+        {
+            PhaseTimer lookahead_timer(stats_.propagate_seconds);
+            alive = lookahead(branch);
+        }
+        if (interrupted_) {
+            break;
+        }
+        if (branches.empty()) {
+            root_size_ = trail_.size();
+        }
+        if (alive && branch == kNoLit) {
+            record_model();
+            result.status = SolveStatus::SAT;
+            result.model = model_;
+            result.cubes.clear();
+            break;
+        }
+
+        bool leaf = !alive;
+        if (alive && static_cast<int>(branches.size()) >= depth) {
+            std::vector<int> cube;
+            cube.reserve(branches.size());
+            for (const Branch& b : branches) {
+                cube.push_back(to_dimacs(b.flipped ? neg(b.lit) : b.lit));
+            }
+            result.cubes.push_back(std::move(cube));
+            leaf = true;
+        } else if (alive) {
+            SAT_STAT_ADD(stats_, decisions, 1);
+            branches.push_back({trail_.size(), branch, false});
+            if (!assume(branch)) {
+                if (interrupted_) {
+                    break;
+                }
+                on_conflict();
+                leaf = true;
+            }
+        } else {
+            on_conflict();
+        }
+
+        if (leaf && !backtrack(branches)) {
+            if (result.cubes.empty()) {
+                result.status = SolveStatus::UNSAT;
+                ok_ = false;
+            }
+            break;
+        }
+    }
+
+    if (interrupted_) {
+        result.status = SolveStatus::UNKNOWN;
+        result.cubes.clear();
+    }
+    undo_until(root_size_);
+    end_search();
+    return result;
+}
+
+} // namespace sat_solver
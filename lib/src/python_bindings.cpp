@@ -2,57 +2,846 @@
 #include <pybind11/stl.h>
 #include <pybind11/numpy.h>
 #include "sat_solver.h"
+#include "batch_solver.h"
+#include "canonical.h"
+#include "cnf_io.h"
+#include "generators.h"
+#include "result_cache.h"
+#include "shared_formula.h"
+#include "thread_pool.h"
+#include <memory>
+#include <mutex>
+#include <type_traits>
 
 namespace py = pybind11;
 
+namespace {
+
+using IntArray = py::array_t<int, py::array::c_style | py::array::forcecast>;
+using OffsetArray = py::array_t<std::int64_t, py::array::c_style | py::array::forcecast>;
+
+/**
+ * Hand a std::vector over to numpy without copying; the array owns the buffer.
+ */
+template <typename T>
+py::array_t<T> to_numpy(std::vector<T>&& values, std::vector<py::ssize_t> shape) {
+    auto* owned = new std::vector<T>(std::move(values));
+    py::capsule owner(owned, [](void* p) { delete static_cast<std::vector<T>*>(p); });
+    return py::array_t<T>(shape, owned->data(), owner);
+}
+
+py::array_t<bool> assignment_to_numpy(const std::vector<bool>& assignment) {
+    py::array_t<bool> result(static_cast<py::ssize_t>(assignment.size()));
+    bool* out = result.mutable_data();
+    for (std::size_t i = 0; i < assignment.size(); ++i) {
+        out[i] = assignment[i];
+    }
+    return result;
+}
+
+py::dict stats_to_dict(const sat_solver::SolverStats& stats) {
+    py::dict result;
+    result["decisions"] = stats.decisions;
+    result["propagations"] = stats.propagations;
+    result["conflicts"] = stats.conflicts;
+    result["restarts"] = stats.restarts;
+    result["learned_clauses"] = stats.learned_clauses;
+    result["deleted_clauses"] = stats.deleted_clauses;
+    result["arena_bytes"] = stats.arena_bytes;
+    result["propagate_seconds"] = stats.propagate_seconds;
+    result["analyze_seconds"] = stats.analyze_seconds;
+    result["reduce_seconds"] = stats.reduce_seconds;
+    result["total_seconds"] = stats.total_seconds;
+    return result;
+}
+
+/**
+ * Split the DIMACS comment block into lines, each keeping its newline,
+ * ready for prepend_comments_to_dimacs().
+ */
+py::list stats_to_comments(const sat_solver::SolverStats& stats) {
+    py::list lines;
+    std::string text = stats.to_dimacs_comments();
+    std::size_t start = 0;
+    while (start < text.size()) {
+        std::size_t end = text.find('\n', start) + 1;
+        lines.append(text.substr(start, end - start));
+        start = end;
+    }
+    return lines;
+}
+
+/**
+ * Bundle the keyword budget arguments shared by solve(), solve_async() and solve_batch().
+ */
+sat_solver::SolveLimits make_limits(std::uint64_t max_conflicts, std::uint64_t max_propagations,
+                                    double max_seconds, std::shared_ptr<sat_solver::CancelToken> cancel) {
+    sat_solver::SolveLimits limits;
+    limits.max_conflicts = max_conflicts;
+    limits.max_propagations = max_propagations;
+    limits.max_seconds = max_seconds;
+    limits.cancel = std::move(cancel);
+    return limits;
+}
+
+std::uint64_t seed_or_random(const py::object& seed) {
+    return seed.is_none() ? sat_solver::utils::random_seed() : seed.cast<std::uint64_t>();
+}
+
+/**
+ * Generate one instance as an (m x k) array or `count` instances as an
+ * (count x m x k) array, plus the planted solutions for PLANTED.
+ */
+py::object generate(sat_solver::utils::InstanceKind kind, int num_vars, int num_clauses, int k,
+                    const py::object& seed, const py::object& count, unsigned threads) {
+    sat_solver::utils::InstanceSpec spec;
+    spec.kind = kind;
+    spec.num_vars = num_vars;
+    spec.num_clauses = num_clauses;
+    spec.k = k;
+    std::uint64_t run_seed = seed_or_random(seed);
+    bool batched = !count.is_none();
+    std::size_t num_formulas = batched ? count.cast<std::size_t>() : 1;
+    bool planted = kind == sat_solver::utils::InstanceKind::PLANTED;
+    if (num_clauses < 0 || num_vars < 0) {
+        throw py::value_error("num_vars and num_clauses must be non-negative");
+    }
+
+    std::vector<int> literals(num_formulas * num_clauses * k);
+    std::vector<std::uint8_t> solutions(planted ? num_formulas * num_vars : 0);
+    {
+        py::gil_scoped_release release;
+        sat_solver::utils::generate_instances(spec, run_seed, num_formulas, literals.data(),
+                                              planted ? solutions.data() : nullptr, threads);
+    }
+
+    std::vector<py::ssize_t> shape = {num_clauses, k};
+    std::vector<py::ssize_t> solution_shape = {num_vars};
+    if (batched) {
+        shape.insert(shape.begin(), static_cast<py::ssize_t>(num_formulas));
+        solution_shape.insert(solution_shape.begin(), static_cast<py::ssize_t>(num_formulas));
+    }
+    py::array formulas = to_numpy(std::move(literals), shape);
+    if (!planted) {
+        return std::move(formulas);
+    }
+    return py::make_tuple(formulas, to_numpy(std::move(solutions), solution_shape));
+}
+
+sat_solver::utils::PlantedSpec planted_spec(int num_vars, int num_clauses, int k, bool quiet, bool exact) {
+    sat_solver::utils::PlantedSpec spec;
+    spec.num_vars = num_vars;
+    spec.num_clauses = num_clauses;
+    spec.k = k;
+    spec.mode = quiet ? sat_solver::utils::PlantingMode::QUIET : sat_solver::utils::PlantingMode::FILTER;
+    spec.exact = exact;
+    return spec;
+}
+
+/**
+ * Return a planted formula as (literals, offsets, models) numpy arrays.
+ */
+py::tuple planted_to_numpy(sat_solver::utils::PlantedFormula&& formula) {
+    py::ssize_t num_literals = formula.literals.size();
+    py::ssize_t num_offsets = formula.clause_offsets.size();
+    py::ssize_t num_models = formula.num_models;
+    py::ssize_t num_vars = formula.num_vars;
+    return py::make_tuple(to_numpy(std::move(formula.literals), {num_literals}),
+                          to_numpy(std::move(formula.clause_offsets), {num_offsets}),
+                          to_numpy(std::move(formula.models), {num_models, num_vars}));
+}
+
+/**
+ * The SATSolver type seen from Python. Several bindings release the GIL while
+ * they work on the solver, so each binding takes the solver's mutex first and
+ * Python threads sharing one solver are serialised. Copies get their own mutex.
+ */
+struct BoundSolver : sat_solver::SATSolver {
+    BoundSolver() = default;
+    explicit BoundSolver(sat_solver::SATSolver&& solver) : sat_solver::SATSolver(std::move(solver)) {}
+    BoundSolver(const BoundSolver& other) : sat_solver::SATSolver(other) {}
+    BoundSolver(BoundSolver&& other) : sat_solver::SATSolver(std::move(other)) {}
+
+    mutable std::mutex mutex;
+};
+
+/**
+ * Hold a solver's mutex until the end of the scope. Called with the GIL held;
+ * if another thread owns the solver the GIL is released while waiting, so a
+ * long solve does not stall the interpreter and the two locks cannot deadlock.
+ */
+class SolverLock {
+public:
+    explicit SolverLock(const BoundSolver& solver) : lock_(solver.mutex, std::try_to_lock) {
+        if (!lock_.owns_lock()) {
+            py::gil_scoped_release release;
+            lock_.lock();
+        }
+    }
+
+private:
+    std::unique_lock<std::mutex> lock_;
+};
+
+/**
+ * Bind a SATSolver method so that it runs under the solver's lock.
+ */
+template <typename R, typename... Args>
+auto locked(R (sat_solver::SATSolver::*method)(Args...)) {
+    return [method](BoundSolver& solver, Args... args) -> typename std::decay<R>::type {
+        SolverLock lock(solver);
+        return (solver.*method)(std::forward<Args>(args)...);
+    };
+}
+
+template <typename R, typename... Args>
+auto locked(R (sat_solver::SATSolver::*method)(Args...) const) {
+    return [method](const BoundSolver& solver, Args... args) -> typename std::decay<R>::type {
+        SolverLock lock(solver);
+        return (solver.*method)(std::forward<Args>(args)...);
+    };
+}
+
+/**
+ * Add clauses given either as an (m x k) integer array, a CSR pair
+ * (literals, offsets) or a plain list of lists.
+ */
+void add_clauses(sat_solver::SATSolver& solver, const py::object& clauses, const py::object& offsets) {
+    if (!offsets.is_none()) {
+        auto lits = IntArray::ensure(clauses);
+        auto offs = OffsetArray::ensure(offsets);
+        if (!lits || !offs || lits.ndim() != 1 || offs.ndim() != 1) {
+            throw py::value_error("CSR clauses need 1-D literal and offset arrays");
+        }
+        if (offs.size() == 0) {
+            throw py::value_error("CSR offsets need num_clauses + 1 entries");
+        }
+        std::size_t num_clauses = static_cast<std::size_t>(offs.size() - 1);
+        if (num_clauses > 0 && offs.data()[num_clauses] != lits.size()) {
+            throw py::value_error("Last CSR offset must equal the number of literals");
+        }
+        solver.add_clauses(lits.data(), offs.data(), num_clauses);
+        return;
+    }
+
+    if (py::isinstance<py::array>(clauses)) {
+        auto lits = IntArray::ensure(clauses);
+        if (!lits || lits.ndim() != 2) {
+            throw py::value_error("Clause arrays must be 2-D (num_clauses x clause_width)");
+        }
+        solver.add_clauses(lits.data(), static_cast<std::size_t>(lits.shape(0)),
+                           static_cast<std::size_t>(lits.shape(1)));
+        return;
+    }
+
+    for (const auto& clause : clauses.cast<std::vector<std::vector<int>>>()) {
+        solver.add_clause(clause);
+    }
+}
+
+/**
+ * Canonicalise the clauses held by a solver (GIL released while searching).
+ */
+sat_solver::utils::CanonicalForm canonical_form(const sat_solver::SATSolver& formula, std::uint64_t max_work) {
+    std::vector<std::int64_t> csr(formula.get_clause_offsets().begin(), formula.get_clause_offsets().end());
+    py::gil_scoped_release release;
+    return sat_solver::utils::canonicalize(formula.get_literals().data(), csr.data(), csr.size() - 1, max_work);
+}
+
+/**
+ * Expose a vector owned by a bound C++ object as a numpy view kept alive by that object.
+ */
+template <typename T>
+py::array_t<T> view_of(const std::vector<T>& values, const py::object& owner) {
+    return py::array_t<T>({static_cast<py::ssize_t>(values.size())}, values.data(), owner);
+}
+
+/**
+ * Solve a batch given as a list of formulas, an (F x m x k) array or a CSR
+ * triple (literals, clause_offsets, formula_offsets).
+ */
+sat_solver::BatchResult solve_batch(const py::object& formulas, unsigned threads,
+                                    const sat_solver::SolveLimits& limits) {
+    std::vector<int> literals;
+    std::vector<std::int64_t> clause_offsets(1, 0);
+    std::vector<std::int64_t> formula_offsets(1, 0);
+
+    auto is_vector = [](const py::handle& obj) {
+        return py::isinstance<py::array>(obj) && obj.cast<py::array>().ndim() == 1;
+    };
+    if (py::isinstance<py::tuple>(formulas) && py::len(formulas) == 3 &&
+        is_vector(formulas[py::int_(0)]) && is_vector(formulas[py::int_(1)]) && is_vector(formulas[py::int_(2)])) {
+        py::tuple csr = formulas.cast<py::tuple>();
+        auto lits = IntArray::ensure(csr[0]);
+        auto clause_offs = OffsetArray::ensure(csr[1]);
+        auto formula_offs = OffsetArray::ensure(csr[2]);
+        if (!lits || !clause_offs || !formula_offs ||
+            lits.ndim() != 1 || clause_offs.ndim() != 1 || formula_offs.ndim() != 1 ||
+            clause_offs.size() == 0 || formula_offs.size() == 0) {
+            throw py::value_error("CSR batches need 1-D literal, clause offset and formula offset arrays");
+        }
+        std::size_t num_formulas = formula_offs.size() - 1;
+        std::int64_t num_clauses = formula_offs.data()[num_formulas];
+        if (num_clauses != clause_offs.size() - 1 || clause_offs.data()[num_clauses] != lits.size()) {
+            throw py::value_error("CSR batch offsets do not match the array lengths");
+        }
+        py::gil_scoped_release release;
+        return sat_solver::solve_batch(lits.data(), clause_offs.data(), formula_offs.data(),
+                                       num_formulas, threads, limits);
+    }
+
+    auto append = [&](const py::handle& formula) {
+        if (py::isinstance<py::array>(formula)) {
+            auto lits = IntArray::ensure(formula);
+            if (!lits || lits.ndim() != 2) {
+                throw py::value_error("Formula arrays must be 2-D (num_clauses x clause_width)");
+            }
+            std::size_t width = lits.shape(1);
+            literals.insert(literals.end(), lits.data(), lits.data() + lits.size());
+            for (py::ssize_t c = 0; c < lits.shape(0); ++c) {
+                clause_offsets.push_back(clause_offsets.back() + width);
+            }
+            formula_offsets.push_back(formula_offsets.back() + lits.shape(0));
+            return;
+        }
+        for (const auto& clause : formula.cast<std::vector<std::vector<int>>>()) {
+            literals.insert(literals.end(), clause.begin(), clause.end());
+            clause_offsets.push_back(literals.size());
+        }
+        formula_offsets.push_back(clause_offsets.size() - 1);
+    };
+
+    if (py::isinstance<py::array>(formulas)) {
+        auto batch = IntArray::ensure(formulas);
+        if (!batch || batch.ndim() != 3) {
+            throw py::value_error("Batch arrays must be 3-D (num_formulas x num_clauses x clause_width)");
+        }
+        std::size_t num_formulas = batch.shape(0);
+        std::size_t num_clauses = batch.shape(1);
+        std::size_t width = batch.shape(2);
+        literals.assign(batch.data(), batch.data() + batch.size());
+        clause_offsets.resize(num_formulas * num_clauses + 1);
+        for (std::size_t c = 0; c < clause_offsets.size(); ++c) {
+            clause_offsets[c] = c * width;
+        }
+        formula_offsets.resize(num_formulas + 1);
+        for (std::size_t f = 0; f <= num_formulas; ++f) {
+            formula_offsets[f] = f * num_clauses;
+        }
+    } else {
+        for (const auto& formula : formulas) {
+            append(formula);
+        }
+    }
+
+    py::gil_scoped_release release;
+    return sat_solver::solve_batch(literals.data(), clause_offsets.data(), formula_offsets.data(),
+                                   formula_offsets.size() - 1, threads, limits);
+}
+
+/**
+ * Solve a snapshot of the solver on the shared C++ thread pool.
+ * The returned concurrent.futures.Future can be cancelled until the solve
+ * starts and awaited from asyncio through asyncio.wrap_future(); a running
+ * solve is stopped through the CancelToken in limits, or by the pool's token
+ * at interpreter exit. If the pool drops the solve, the future is cancelled.
+ */
+py::object solve_async(const sat_solver::SATSolver& solver, const sat_solver::SolveLimits& limits) {
+    py::object future = py::module_::import("concurrent.futures").attr("Future")();
+
+    // The task may be destroyed on a worker thread; drop the reference under the GIL.
+    std::shared_ptr<py::object> handle(new py::object(future), [](py::object* p) {
+        py::gil_scoped_acquire gil;
+        delete p;
+    });
+
+    sat_solver::ThreadPool& pool = sat_solver::ThreadPool::shared();
+    sat_solver::SolveLimits run_limits = limits;
+    run_limits.cancel = std::make_shared<sat_solver::CancelToken>(limits.cancel, pool.cancel_token());
+
+    auto on_drop = [handle]() {
+        py::gil_scoped_acquire gil;
+        handle->attr("cancel")();
+    };
+    pool.submit([snapshot = solver, limits = run_limits, handle]() mutable {
+        {
+            py::gil_scoped_acquire gil;
+            if (!handle->attr("set_running_or_notify_cancel")().cast<bool>()) {
+                return;  // cancelled while queued
+            }
+        }
+
+        sat_solver::SolveResult result;
+        std::string error;
+        try {
+            result = snapshot.solve(limits);
+        } catch (const std::exception& e) {
+            error = e.what();
+        }
+
+        py::gil_scoped_acquire gil;
+        try {
+            if (error.empty()) {
+                handle->attr("set_result")(py::cast(std::move(result)));
+            } else {
+                handle->attr("set_exception")(py::module_::import("builtins").attr("RuntimeError")(error));
+            }
+        } catch (py::error_already_set&) {
+            // The future was resolved elsewhere; nothing left to report
+        }
+    }, on_drop);
+
+    return future;
+}
+
+} // namespace
+
 PYBIND11_MODULE(sat_solver, m) {
     m.doc() = "SAT Solver C++ Library with Python Bindings";
-    
-    // Bind the SATSolver class
-    py::class_<sat_solver::SATSolver>(m, "SATSolver")
+
+    py::enum_<sat_solver::SolveStatus>(m, "SolveStatus")
+        .value("UNSAT", sat_solver::SolveStatus::UNSAT)
+        .value("SAT", sat_solver::SolveStatus::SAT)
+        .value("UNKNOWN", sat_solver::SolveStatus::UNKNOWN);
+
+    py::enum_<sat_solver::SolverMode>(m, "SolverMode")
+        .value("CDCL", sat_solver::SolverMode::CDCL)
+        .value("LOOKAHEAD", sat_solver::SolverMode::LOOKAHEAD)
+        .value("CUBE_AND_CONQUER", sat_solver::SolverMode::CUBE_AND_CONQUER);
+
+    py::class_<sat_solver::CancelToken, std::shared_ptr<sat_solver::CancelToken>>(m, "CancelToken")
         .def(py::init<>())
-        .def("add_clause", &sat_solver::SATSolver::add_clause,
+        .def("cancel", &sat_solver::CancelToken::cancel,
+             "Ask every solve watching this token to stop with status UNKNOWN")
+        .def("reset", &sat_solver::CancelToken::reset,
+             "Clear the cancellation flag")
+        .def_property_readonly("cancelled", &sat_solver::CancelToken::cancelled);
+
+    py::class_<sat_solver::ResultCache, std::shared_ptr<sat_solver::ResultCache>>(m, "ResultCache")
+        .def(py::init<const std::string&>(), "Open or create a persistent result cache file", py::arg("path"))
+        .def_property_readonly("path", &sat_solver::ResultCache::path)
+        .def("__len__", &sat_solver::ResultCache::size, py::call_guard<py::gil_scoped_release>())
+        .def("__repr__", [](const sat_solver::ResultCache& cache) {
+            return "<ResultCache " + cache.path() + ">";
+        });
+
+    // Bind the solve result
+    py::class_<sat_solver::SolveResult>(m, "SolveResult")
+        .def_readonly("status", &sat_solver::SolveResult::status)
+        .def_readonly("satisfiable", &sat_solver::SolveResult::satisfiable)
+        .def_readonly("cached", &sat_solver::SolveResult::cached,
+                      "True if the result came from the attached ResultCache")
+        .def_property_readonly("assignment", [](const sat_solver::SolveResult& result) {
+            return assignment_to_numpy(result.assignment);
+        })
+        .def_property_readonly("stats", [](const sat_solver::SolveResult& result) {
+            return stats_to_dict(result.stats);
+        }, "Solver statistics of this run as a dict")
+        .def("__bool__", [](const sat_solver::SolveResult& result) { return result.satisfiable; })
+        .def("__repr__", [](const sat_solver::SolveResult& result) {
+            const char* status = result.status == sat_solver::SolveStatus::SAT ? "SAT"
+                               : result.status == sat_solver::SolveStatus::UNSAT ? "UNSAT" : "UNKNOWN";
+            return std::string("<SolveResult ") + status + ">";
+        });
+
+    // Bind the batch result
+    py::class_<sat_solver::BatchResult>(m, "BatchResult")
+        .def_property_readonly("status", [](py::object self) {
+            return view_of(self.cast<const sat_solver::BatchResult&>().status, self);
+        }, "int8 array: 1 if formula i is satisfiable, 0 if unsatisfiable, -1 if its budget ran out")
+        .def_property_readonly("models", [](py::object self) {
+            return view_of(self.cast<const sat_solver::BatchResult&>().models, self);
+        }, "uint8 array holding the models of all formulas back to back")
+        .def_property_readonly("model_offsets", [](py::object self) {
+            return view_of(self.cast<const sat_solver::BatchResult&>().model_offsets, self);
+        }, "int64 array: model i is models[model_offsets[i]:model_offsets[i + 1]]")
+        .def("model", [](py::object self, std::size_t i) {
+            const auto& batch = self.cast<const sat_solver::BatchResult&>();
+            if (i >= batch.size()) {
+                throw py::index_error("formula index out of range");
+            }
+            std::int64_t first = batch.model_offsets[i];
+            std::int64_t last = batch.model_offsets[i + 1];
+            return py::array_t<bool>({static_cast<py::ssize_t>(last - first)},
+                                     reinterpret_cast<const bool*>(batch.models.data() + first), self);
+        }, "Get the model of formula i as a bool array (empty if unsatisfiable)", py::arg("i"))
+        .def_property_readonly("stats", [](const sat_solver::BatchResult& batch) {
+            py::list result;
+            for (const auto& stats : batch.stats) {
+                result.append(stats_to_dict(stats));
+            }
+            return result;
+        }, "List of per-formula solver statistics dicts")
+        .def("__len__", &sat_solver::BatchResult::size);
+
+    // Bind the SATSolver class; see BoundSolver for the locking
+    py::class_<BoundSolver>(m, "SATSolver")
+        .def(py::init<>())
+        .def("add_clause", locked(&sat_solver::SATSolver::add_clause),
              "Add a clause to the SAT formula",
              py::arg("clause"))
-        .def("clear", &sat_solver::SATSolver::clear,
+        .def("add_clauses", [](BoundSolver& solver, const py::object& clauses, const py::object& offsets) {
+            SolverLock lock(solver);
+            add_clauses(solver, clauses, offsets);
+        }, "Add many clauses at once from an (m x k) int array, a CSR pair "
+           "(literals, offsets) or a list of lists",
+           py::arg("clauses"), py::arg("offsets") = py::none())
+        .def("clear", locked(&sat_solver::SATSolver::clear),
              "Clear all clauses from the formula")
-        .def("get_num_variables", &sat_solver::SATSolver::get_num_variables,
+        .def("get_num_variables", locked(&sat_solver::SATSolver::get_num_variables),
              "Get the number of variables in the formula")
-        .def("get_num_clauses", &sat_solver::SATSolver::get_num_clauses,
+        .def("get_num_clauses", locked(&sat_solver::SATSolver::get_num_clauses),
              "Get the number of clauses in the formula")
-        .def("is_satisfiable", &sat_solver::SATSolver::is_satisfiable,
-             "Check if the current formula is satisfiable")
-        .def("get_satisfying_assignment", &sat_solver::SATSolver::get_satisfying_assignment,
-             "Get a satisfying assignment if one exists")
-        .def("to_string", &sat_solver::SATSolver::to_string,
+        .def("get_clauses", [](const BoundSolver& solver) {
+            std::vector<std::int64_t> offsets;
+            std::vector<int> literals;
+            {
+                SolverLock lock(solver);
+                offsets.assign(solver.get_clause_offsets().begin(), solver.get_clause_offsets().end());
+                literals = solver.get_literals();
+            }
+            py::ssize_t num_literals = literals.size();
+            py::ssize_t num_offsets = offsets.size();
+            return py::make_tuple(to_numpy(std::move(literals), {num_literals}),
+                                  to_numpy(std::move(offsets), {num_offsets}));
+        }, "Get the formula as a CSR pair (literals, offsets) of numpy arrays")
+        .def("is_satisfiable", [](BoundSolver& solver) {
+            SolverLock lock(solver);
+            py::gil_scoped_release release;
+            return solver.is_satisfiable();
+        }, "Check if the current formula is satisfiable (releases the GIL)")
+        .def("get_satisfying_assignment", [](BoundSolver& solver) {
+            std::vector<bool> assignment;
+            {
+                SolverLock lock(solver);
+                py::gil_scoped_release release;
+                assignment = solver.get_satisfying_assignment();
+            }
+            return assignment_to_numpy(assignment);
+        }, "Get a satisfying assignment if one exists, as a numpy bool array (releases the GIL)")
+        .def("solve", [](BoundSolver& solver, std::uint64_t max_conflicts,
+                         std::uint64_t max_propagations, double max_seconds,
+                         std::shared_ptr<sat_solver::CancelToken> cancel) {
+            auto limits = make_limits(max_conflicts, max_propagations, max_seconds, std::move(cancel));
+            SolverLock lock(solver);
+            py::gil_scoped_release release;
+            return solver.solve(limits);
+        }, "Solve the formula and return a SolveResult (releases the GIL). Budgets of 0 "
+           "are unlimited; the status is UNKNOWN if a budget runs out or the token is cancelled",
+           py::arg("max_conflicts") = 0, py::arg("max_propagations") = 0,
+           py::arg("max_seconds") = 0.0, py::arg("cancel") = py::none())
+        .def("solve_async", [](const BoundSolver& solver, std::uint64_t max_conflicts,
+                               std::uint64_t max_propagations, double max_seconds,
+                               std::shared_ptr<sat_solver::CancelToken> cancel) {
+            SolverLock lock(solver);
+            return solve_async(solver, make_limits(max_conflicts, max_propagations, max_seconds,
+                                                   std::move(cancel)));
+        }, "Solve a snapshot of the formula on the internal thread pool; "
+           "returns a concurrent.futures.Future resolving to a SolveResult",
+           py::arg("max_conflicts") = 0, py::arg("max_propagations") = 0,
+           py::arg("max_seconds") = 0.0, py::arg("cancel") = py::none())
+        .def("set_mode", locked(&sat_solver::SATSolver::set_mode),
+             "Select the search engine (SolverMode); threads sets the workers of CUBE_AND_CONQUER",
+             py::arg("mode"), py::arg("threads") = 0)
+        .def("get_mode", locked(&sat_solver::SATSolver::get_mode),
+             "Get the selected search engine")
+        .def("generate_cubes", [](const BoundSolver& solver, int depth, std::uint64_t max_conflicts,
+                                  std::uint64_t max_propagations, double max_seconds,
+                                  std::shared_ptr<sat_solver::CancelToken> cancel) {
+            auto limits = make_limits(max_conflicts, max_propagations, max_seconds, std::move(cancel));
+            sat_solver::CubeSplit split;
+            {
+                SolverLock lock(solver);
+                py::gil_scoped_release release;
+                split = solver.generate_cubes(depth, limits);
+            }
+            return py::make_tuple(split.status, split.cubes);
+        }, "Split the formula into cubes with the lookahead heuristic. Returns (status, cubes): "
+           "cubes are assumption literal lists of the open branches when status is UNKNOWN; SAT or UNSAT "
+           "means splitting already decided the formula",
+           py::arg("depth"), py::arg("max_conflicts") = 0, py::arg("max_propagations") = 0,
+           py::arg("max_seconds") = 0.0, py::arg("cancel") = py::none())
+        .def("count_models", [](const BoundSolver& solver, std::uint64_t limit) {
+            SolverLock lock(solver);
+            py::gil_scoped_release release;
+            return solver.count_models(limit);
+        }, "Count the models over variables 1..n by enumeration (small formulas only); "
+           "stops at limit if it is non-zero (releases the GIL)",
+           py::arg("limit") = 0)
+        .def("set_cache", locked(&sat_solver::SATSolver::set_cache),
+             "Attach a ResultCache (None detaches it); solves and full model counts of formulas "
+             "isomorphic to cached ones skip the solver",
+             py::arg("cache"))
+        .def("get_cache", locked(&sat_solver::SATSolver::get_cache),
+             "Get the attached ResultCache or None")
+        .def("checkpoint", locked(&sat_solver::SATSolver::checkpoint),
+             "Write the formula and, if the last CDCL solve ran out of budget, its learned clauses, "
+             "activities, saved phases and top-level facts to a checkpoint file",
+             py::arg("path"))
+        .def("restore", locked(&sat_solver::SATSolver::restore),
+             "Replace the formula with the one in a checkpoint file; the next CDCL solve resumes "
+             "the interrupted search it holds",
+             py::arg("path"))
+        .def("checkpoint_on_signal", locked(&sat_solver::SATSolver::checkpoint_on_signal),
+             "Install a process-wide handler for the signal that stops solves of this solver and "
+             "writes a checkpoint to path; an empty path disarms the solver",
+             py::arg("path"), py::arg("signum") = SIGTERM)
+        .def_static("checkpoint_signal_pending", &sat_solver::SATSolver::checkpoint_signal_pending,
+                    "Check whether a checkpoint signal arrived since the last reset")
+        .def_static("reset_checkpoint_signal", &sat_solver::SATSolver::reset_checkpoint_signal,
+                    "Forget a pending checkpoint signal so armed solves can run again")
+        .def("get_stats", [](const BoundSolver& solver) {
+            SolverLock lock(solver);
+            return stats_to_dict(solver.get_stats());
+        }, "Get the statistics of the last solver run as a dict")
+        .def("get_stats_comments", [](const BoundSolver& solver) {
+            SolverLock lock(solver);
+            return stats_to_comments(solver.get_stats());
+        }, "Get the statistics of the last solver run as DIMACS 'c' comment lines")
+        .def("canonical_hash", [](const BoundSolver& solver) {
+            SolverLock lock(solver);
+            return canonical_form(solver, sat_solver::utils::kCacheKeyWork).hash.hex();
+        }, "Get the 128-bit hash (32 hex digits) of the formula's canonical form, the key of the "
+           "result cache; equal for formulas that differ only by variable renaming and clause or literal order")
+        .def("to_string", locked(&sat_solver::SATSolver::to_string),
              "Convert the formula to a string representation")
-        .def("is_3sat", &sat_solver::SATSolver::is_3sat,
+        .def("is_3sat", locked(&sat_solver::SATSolver::is_3sat),
              "Validate that all clauses are 3-SAT clauses")
-        .def("__repr__", [](const sat_solver::SATSolver& solver) {
-            return "<SATSolver with " + std::to_string(solver.get_num_clauses()) + 
+        .def("share", [](const BoundSolver& solver, const std::string& name) {
+            SolverLock lock(solver);
+            return sat_solver::SharedFormula::create(solver, name);
+        }, "Publish the formula in shared memory; the returned SharedFormula pickles by name, "
+           "so workers map it read-only instead of receiving a copy",
+           py::arg("name") = "")
+        .def(py::pickle(
+            [](const BoundSolver& solver) {
+                std::vector<std::uint8_t> data;
+                sat_solver::SolverMode mode;
+                {
+                    SolverLock lock(solver);
+                    solver.serialize(data);
+                    mode = solver.get_mode();
+                }
+                return py::make_tuple(py::bytes(reinterpret_cast<const char*>(data.data()), data.size()), mode);
+            },
+            [](const py::tuple& state) {
+                if (state.size() != 2) {
+                    throw std::runtime_error("Invalid SATSolver state");
+                }
+                char* data = nullptr;
+                py::ssize_t size = 0;
+                if (PYBIND11_BYTES_AS_STRING_AND_SIZE(state[0].ptr(), &data, &size) != 0) {
+                    throw py::error_already_set();
+                }
+                BoundSolver solver;
+                solver.deserialize(reinterpret_cast<const std::uint8_t*>(data), static_cast<std::size_t>(size));
+                solver.set_mode(state[1].cast<sat_solver::SolverMode>());
+                return solver;
+            }))
+        .def("__repr__", [](const BoundSolver& solver) {
+            SolverLock lock(solver);
+            return "<SATSolver with " + std::to_string(solver.get_num_clauses()) +
                    " clauses and " + std::to_string(solver.get_num_variables()) + " variables>";
         });
-    
+
+    py::class_<sat_solver::SharedFormula, std::shared_ptr<sat_solver::SharedFormula>>(m, "SharedFormula")
+        .def(py::init([](const BoundSolver& solver, const std::string& name) {
+            SolverLock lock(solver);
+            return sat_solver::SharedFormula::create(solver, name);
+        }), "Copy the formula of a solver into a new shared-memory segment owned by this object",
+           py::arg("solver"), py::arg("name") = "")
+        .def_static("attach", &sat_solver::SharedFormula::attach,
+                    "Map an existing shared formula read-only by name", py::arg("name"))
+        .def_property_readonly("name", &sat_solver::SharedFormula::name)
+        .def_property_readonly("owner", &sat_solver::SharedFormula::owner)
+        .def("get_num_variables", &sat_solver::SharedFormula::get_num_variables)
+        .def("get_num_clauses", &sat_solver::SharedFormula::get_num_clauses)
+        .def("get_clauses", [](const py::object& self) {
+            const auto& formula = self.cast<const sat_solver::SharedFormula&>();
+            py::array_t<int> literals({static_cast<py::ssize_t>(formula.get_num_literals())},
+                                      formula.literals(), self);
+            py::array_t<std::int64_t> offsets({static_cast<py::ssize_t>(formula.get_num_clauses() + 1)},
+                                              formula.offsets(), self);
+            literals.attr("setflags")(py::arg("write") = false);
+            offsets.attr("setflags")(py::arg("write") = false);
+            return py::make_tuple(literals, offsets);
+        }, "Get the formula as a read-only CSR pair (literals, offsets) of numpy views into shared memory")
+        .def("to_solver", [](const sat_solver::SharedFormula& formula) {
+            return BoundSolver(formula.to_solver());
+        }, "Build a SATSolver holding a private copy of the formula")
+        .def(py::pickle(
+            [](const sat_solver::SharedFormula& formula) {
+                return py::make_tuple(formula.name());
+            },
+            [](const py::tuple& state) {
+                if (state.size() != 1) {
+                    throw std::runtime_error("Invalid SharedFormula state");
+                }
+                return sat_solver::SharedFormula::attach(state[0].cast<std::string>());
+            }))
+        .def("__repr__", [](const sat_solver::SharedFormula& formula) {
+            return "<SharedFormula " + formula.name() + " with " + std::to_string(formula.get_num_clauses()) +
+                   " clauses>";
+        });
+
     // Bind utility functions
     py::module_ utils = m.def_submodule("utils", "Utility functions for SAT manipulation");
-    
-    utils.def("generate_random_3sat", &sat_solver::utils::generate_random_3sat,
-              "Generate a random 3-SAT formula",
-              py::arg("num_vars"), py::arg("num_clauses"));
-              
-    utils.def("are_equivalent", &sat_solver::utils::are_equivalent,
-              "Check if two formulas are equivalent",
-              py::arg("f1"), py::arg("f2"));
-    
-    // Add some convenience functions
-    m.def("create_solver_from_clauses", [](const std::vector<std::vector<int>>& clauses) {
-        auto solver = sat_solver::SATSolver();
-        for (const auto& clause : clauses) {
-            solver.add_clause(clause);
+
+    utils.def("generate_random_3sat", [](int num_vars, int num_clauses, const py::object& seed) {
+        if (num_clauses < 0) {
+            throw py::value_error("num_clauses must be non-negative");
         }
+        return to_numpy(sat_solver::utils::generate_random_3sat_flat(num_vars, num_clauses, seed_or_random(seed)),
+                        {num_clauses, 3});
+    }, "Generate a random 3-SAT formula with distinct variables per clause as an "
+       "(num_clauses x 3) int array; pass a seed for reproducible output",
+       py::arg("num_vars"), py::arg("num_clauses"), py::arg("seed") = py::none());
+
+    utils.def("generate_uniform_ksat", [](int num_vars, int num_clauses, int k, const py::object& seed,
+                                          const py::object& count, unsigned threads) {
+        return generate(sat_solver::utils::InstanceKind::UNIFORM, num_vars, num_clauses, k, seed, count, threads);
+    }, "Generate uniform random k-SAT (k distinct variables per clause). Returns an (m x k) "
+       "array, or (count x m x k) if count is given; instance i depends only on seed and i",
+       py::arg("num_vars"), py::arg("num_clauses"), py::arg("k") = 3, py::arg("seed") = py::none(),
+       py::arg("count") = py::none(), py::arg("threads") = 0);
+
+    utils.def("generate_planted_ksat", [](int num_vars, int num_clauses, int k, const py::object& seed,
+                                          const py::object& count, unsigned threads) {
+        return generate(sat_solver::utils::InstanceKind::PLANTED, num_vars, num_clauses, k, seed, count, threads);
+    }, "Generate random k-SAT satisfied by a hidden assignment. Returns (formulas, solutions) "
+       "where solutions holds one uint8 value per variable",
+       py::arg("num_vars"), py::arg("num_clauses"), py::arg("k") = 3, py::arg("seed") = py::none(),
+       py::arg("count") = py::none(), py::arg("threads") = 0);
+
+    utils.def("generate_regular_ksat", [](int num_vars, int num_clauses, int k, const py::object& seed,
+                                          const py::object& count, unsigned threads) {
+        return generate(sat_solver::utils::InstanceKind::REGULAR, num_vars, num_clauses, k, seed, count, threads);
+    }, "Generate regular random k-SAT where every variable occurs equally often with balanced signs",
+       py::arg("num_vars"), py::arg("num_clauses"), py::arg("k") = 3, py::arg("seed") = py::none(),
+       py::arg("count") = py::none(), py::arg("threads") = 0);
+
+    utils.def("generate_planted_formula", [](int num_vars, int num_clauses, int k, int num_solutions,
+                                             const py::object& seed, bool quiet, bool exact) {
+        auto spec = planted_spec(num_vars, num_clauses, k, quiet, exact);
+        spec.num_solutions = num_solutions;
+        std::uint64_t run_seed = seed_or_random(seed);
+        sat_solver::utils::PlantedFormula formula;
+        {
+            py::gil_scoped_release release;
+            formula = sat_solver::utils::generate_planted_formula(spec, run_seed);
+        }
+        return planted_to_numpy(std::move(formula));
+    }, "Plant num_solutions random models and return (literals, offsets, models). With exact=True "
+       "the planted models are the only models, so the marked-state count is num_solutions; "
+       "quiet=True hides the planted model in the literal statistics",
+       py::arg("num_vars"), py::arg("num_clauses"), py::arg("k") = 3, py::arg("num_solutions") = 1,
+       py::arg("seed") = py::none(), py::arg("quiet") = false, py::arg("exact") = false);
+
+    utils.def("plant_solutions", [](const py::object& models, int num_clauses, int k,
+                                    const py::object& seed, bool quiet, bool exact) {
+        auto rows = py::array_t<std::uint8_t, py::array::c_style | py::array::forcecast>::ensure(models);
+        if (!rows || rows.ndim() != 2) {
+            throw py::value_error("Models must be a 2-D array (num_models x num_vars) of 0/1 values");
+        }
+        auto spec = planted_spec(static_cast<int>(rows.shape(1)), num_clauses, k, quiet, exact);
+        std::uint64_t run_seed = seed_or_random(seed);
+        sat_solver::utils::PlantedFormula formula;
+        {
+            py::gil_scoped_release release;
+            formula = sat_solver::utils::plant_solutions(spec, rows.data(), rows.shape(0), run_seed);
+        }
+        return planted_to_numpy(std::move(formula));
+    }, "Plant the given (num_models x num_vars) 0/1 models and return (literals, offsets, models)",
+       py::arg("models"), py::arg("num_clauses"), py::arg("k") = 3, py::arg("seed") = py::none(),
+       py::arg("quiet") = false, py::arg("exact") = false);
+
+    utils.def("write_binary_cnf", [](const std::string& path, const py::object& clauses,
+                                     const py::object& offsets, const py::object& num_vars) {
+        sat_solver::SATSolver formula;
+        add_clauses(formula, clauses, offsets);
+        std::vector<std::int64_t> csr(formula.get_clause_offsets().begin(), formula.get_clause_offsets().end());
+        int vars = num_vars.is_none() ? formula.get_num_variables() : num_vars.cast<int>();
+        py::gil_scoped_release release;
+        sat_solver::utils::write_binary_cnf(path, vars, formula.get_literals().data(), csr.data(),
+                                            csr.size() - 1);
+    }, "Write clauses (an (m x k) array, a CSR pair or a list of lists) to a binary CNF file",
+       py::arg("path"), py::arg("clauses"), py::arg("offsets") = py::none(), py::arg("num_vars") = py::none());
+
+    utils.def("read_binary_cnf", [](const std::string& path) {
+        sat_solver::utils::BinaryCNF cnf;
+        {
+            py::gil_scoped_release release;
+            cnf = sat_solver::utils::read_binary_cnf(path);
+        }
+        py::ssize_t num_literals = cnf.literals.size();
+        py::ssize_t num_offsets = cnf.clause_offsets.size();
+        return py::make_tuple(to_numpy(std::move(cnf.literals), {num_literals}),
+                              to_numpy(std::move(cnf.clause_offsets), {num_offsets}),
+                              cnf.num_vars);
+    }, "Read a binary CNF file as (literals, offsets, num_vars)", py::arg("path"));
+
+    utils.def("are_equivalent", [](const py::object& f1, const py::object& f2, unsigned threads) {
+        sat_solver::SATSolver first, second;
+        add_clauses(first, f1, py::none());
+        add_clauses(second, f2, py::none());
+        auto formula1 = first.get_formula();
+        auto formula2 = second.get_formula();
+        py::gil_scoped_release release;
+        return sat_solver::utils::are_equivalent(formula1, formula2, threads);
+    }, "Check if two formulas (lists of clauses or (m x k) arrays) have exactly the same models; "
+       "exhaustive bit-sliced check up to 20 variables, SAT-based clause implication beyond",
+       py::arg("f1"), py::arg("f2"), py::arg("threads") = 0);
+
+    utils.def("canonicalize", [](const py::object& clauses, const py::object& offsets, std::uint64_t max_work) {
+        sat_solver::SATSolver formula;
+        add_clauses(formula, clauses, offsets);
+        auto form = canonical_form(formula, max_work);
+        py::ssize_t num_literals = form.literals.size();
+        py::ssize_t num_offsets = form.clause_offsets.size();
+        py::ssize_t map_size = form.var_map.size();
+        py::dict result;
+        result["literals"] = to_numpy(std::move(form.literals), {num_literals});
+        result["offsets"] = to_numpy(std::move(form.clause_offsets), {num_offsets});
+        result["var_map"] = to_numpy(std::move(form.var_map), {map_size});
+        result["num_vars"] = form.num_vars;
+        result["hash"] = form.hash.hex();
+        result["complete"] = form.complete;
+        return result;
+    }, "Relabel clauses (an (m x k) array, a CSR pair or a list of lists) into a canonical form. "
+       "Returns a dict with CSR 'literals' and 'offsets', 'var_map' (input variable -> canonical "
+       "label, 0 if unused), 'num_vars', 'hash' (32 hex digits) and 'complete' (False if the "
+       "search budget ran out on a highly symmetric formula)",
+       py::arg("clauses"), py::arg("offsets") = py::none(), py::arg("max_work") = 1u << 26);
+
+    // Add some convenience functions
+    m.def("create_solver_from_clauses", [](const py::object& clauses, const py::object& offsets) {
+        BoundSolver solver;
+        add_clauses(solver, clauses, offsets);
         return solver;
-    }, "Create a SAT solver from a list of clauses");
-    
+    }, "Create a SAT solver from an (m x k) int array, a CSR pair or a list of clauses",
+       py::arg("clauses"), py::arg("offsets") = py::none());
+
+    m.def("solve_batch", [](const py::object& formulas, unsigned threads, std::uint64_t max_conflicts,
+                            std::uint64_t max_propagations, double max_seconds,
+                            std::shared_ptr<sat_solver::CancelToken> cancel) {
+        return solve_batch(formulas, threads, make_limits(max_conflicts, max_propagations, max_seconds,
+                                                          std::move(cancel)));
+    }, "Solve many formulas in parallel on a work-stealing pool. Accepts a list of "
+       "formulas (lists of clauses or 2-D arrays), an (F x m x k) array, or a CSR "
+       "triple (literals, clause_offsets, formula_offsets). Budgets apply per formula. "
+       "Returns a BatchResult.",
+       py::arg("formulas"), py::arg("threads") = 0, py::arg("max_conflicts") = 0,
+       py::arg("max_propagations") = 0, py::arg("max_seconds") = 0.0, py::arg("cancel") = py::none());
+
+    // Stop running solves and join the pool's workers before the interpreter tears down
+    py::module_::import("atexit").attr("register")(py::cpp_function([]() {
+        py::gil_scoped_release release;
+        sat_solver::ThreadPool::shutdown_shared();
+    }));
+
+    // Whether statistics were compiled in (SAT_SOLVER_ENABLE_STATS)
+    m.attr("STATS_ENABLED") = static_cast<bool>(SAT_SOLVER_STATS);
+
     // Version info
     m.attr("__version__") = "1.0.0";
-}
\ No newline at end of file
+}
@@ -0,0 +1,278 @@
+#include "result_cache.h"
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace sat_solver {
+
+namespace {
+
+const char kMagic[8] = {'S', 'A', 'T', 'C', 'A', 'C', 'H', 'E'};
+const std::uint32_t kVersion = 1;
+const std::size_t kFileHeaderBytes = 16;   // magic, version, reserved
+
+// Record layout (native byte order, 8-byte aligned):
+//   u32 size, u32 checksum of bytes [8, size), u64 key low, u64 key high,
+//   i8 status, 3 bytes padding, u32 model variables, i64 model count,
+//   7 x u64 counters, 4 x f64 timings, model bits (LSB first) padded to 8 bytes
+const std::size_t kRecordHeaderBytes = 128;
+
+/**
+ * Holds a flock() on a file for the lifetime of the object.
+ */
+class FileLock {
+public:
+    FileLock(int fd, int operation, const std::string& path) : fd_(fd) {
+        while (flock(fd_, operation) != 0) {
+            if (errno != EINTR) {
+                throw std::runtime_error("Cannot lock " + path + ": " + std::strerror(errno));
+            }
+        }
+    }
+    ~FileLock() { flock(fd_, LOCK_UN); }
+
+    FileLock(const FileLock&) = delete;
+    FileLock& operator=(const FileLock&) = delete;
+
+private:
+    int fd_;
+};
+
+void write_all(int fd, const void* data, std::size_t size, off_t offset, const std::string& path) {
+    const char* bytes = static_cast<const char*>(data);
+    while (size > 0) {
+        ssize_t written = pwrite(fd, bytes, size, offset);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::runtime_error("Failed to write " + path + ": " + std::strerror(errno));
+        }
+        bytes += written;
+        size -= static_cast<std::size_t>(written);
+        offset += written;
+    }
+}
+
+std::size_t file_size(int fd, const std::string& path) {
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        throw std::runtime_error("Cannot stat " + path + ": " + std::strerror(errno));
+    }
+    return static_cast<std::size_t>(info.st_size);
+}
+
+std::uint32_t checksum(const std::uint8_t* record, std::size_t size) {
+    return static_cast<std::uint32_t>(utils::hash128(record + 8, size - 8).low);
+}
+
+template <typename T>
+void put(std::vector<std::uint8_t>& buffer, std::size_t offset, T value) {
+    std::memcpy(buffer.data() + offset, &value, sizeof(T));
+}
+
+template <typename T>
+T get(const std::uint8_t* record, std::size_t offset) {
+    T value;
+    std::memcpy(&value, record + offset, sizeof(T));
+    return value;
+}
+
+std::vector<std::uint8_t> encode_record(const utils::Hash128& key, const CachedResult& result) {
+    std::size_t model_bytes = (result.model.size() + 63) / 64 * 8;
+    std::vector<std::uint8_t> buffer(kRecordHeaderBytes + model_bytes, 0);
+
+    put<std::uint32_t>(buffer, 0, static_cast<std::uint32_t>(buffer.size()));
+    put<std::uint64_t>(buffer, 8, key.low);
+    put<std::uint64_t>(buffer, 16, key.high);
+    put<std::int8_t>(buffer, 24, static_cast<std::int8_t>(result.status));
+    put<std::uint32_t>(buffer, 28, static_cast<std::uint32_t>(result.model.size()));
+    put<std::int64_t>(buffer, 32, result.model_count);
+
+    const SolverStats& stats = result.stats;
+    const std::uint64_t counters[7] = {stats.decisions, stats.propagations, stats.conflicts, stats.restarts,
+                                       stats.learned_clauses, stats.deleted_clauses, stats.arena_bytes};
+    const double timings[4] = {stats.propagate_seconds, stats.analyze_seconds, stats.reduce_seconds,
+                               stats.total_seconds};
+    std::memcpy(buffer.data() + 40, counters, sizeof(counters));
+    std::memcpy(buffer.data() + 96, timings, sizeof(timings));
+
+    for (std::size_t v = 0; v < result.model.size(); ++v) {
+        if (result.model[v]) {
+            buffer[kRecordHeaderBytes + v / 8] |= static_cast<std::uint8_t>(1u << (v % 8));
+        }
+    }
+
+    put<std::uint32_t>(buffer, 4, checksum(buffer.data(), buffer.size()));
+    return buffer;
+}
+
+} // namespace
+
+ResultCache::ResultCache(const std::string& path)
+    : path_(path), fd_(-1), map_(nullptr), map_size_(0), scanned_(kFileHeaderBytes) {
+    fd_ = open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd_ < 0) {
+        throw std::runtime_error("Cannot open " + path + ": " + std::strerror(errno));
+    }
+
+    try {
+        FileLock lock(fd_, LOCK_EX, path_);
+        std::size_t size = file_size(fd_, path_);
+        if (size == 0) {
+            std::uint8_t header[kFileHeaderBytes] = {};
+            std::memcpy(header, kMagic, sizeof(kMagic));
+            std::memcpy(header + 8, &kVersion, sizeof(kVersion));
+            write_all(fd_, header, sizeof(header), 0, path_);
+        } else {
+            std::uint8_t header[kFileHeaderBytes] = {};
+            bool valid = size >= kFileHeaderBytes &&
+                         pread(fd_, header, sizeof(header), 0) == static_cast<ssize_t>(sizeof(header)) &&
+                         std::memcmp(header, kMagic, sizeof(kMagic)) == 0 &&
+                         get<std::uint32_t>(header, 8) == kVersion;
+            if (!valid) {
+                throw std::runtime_error(path_ + " is not a result cache file");
+            }
+        }
+        refresh();
+    } catch (...) {
+        if (map_) {
+            munmap(const_cast<std::uint8_t*>(map_), map_size_);
+        }
+        close(fd_);
+        throw;
+    }
+}
+
+ResultCache::~ResultCache() {
+    if (map_) {
+        munmap(const_cast<std::uint8_t*>(map_), map_size_);
+    }
+    close(fd_);
+}
+
+void ResultCache::refresh() {
+    std::size_t size = file_size(fd_, path_);
+    if (size != map_size_) {
+        if (map_) {
+            munmap(const_cast<std::uint8_t*>(map_), map_size_);
+            map_ = nullptr;
+            map_size_ = 0;
+        }
+        void* mapped = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd_, 0);
+        if (mapped == MAP_FAILED) {
+            throw std::runtime_error("Cannot map " + path_ + ": " + std::strerror(errno));
+        }
+        map_ = static_cast<const std::uint8_t*>(mapped);
+        map_size_ = size;
+    }
+
+    // Index complete records; stop at a torn or corrupt tail
+    while (scanned_ + kRecordHeaderBytes <= map_size_) {
+        const std::uint8_t* record = map_ + scanned_;
+        std::uint32_t record_size = get<std::uint32_t>(record, 0);
+        if (record_size < kRecordHeaderBytes || record_size % 8 != 0 || record_size > map_size_ - scanned_ ||
+            get<std::uint32_t>(record, 4) != checksum(record, record_size)) {
+            break;
+        }
+        utils::Hash128 key;
+        key.low = get<std::uint64_t>(record, 8);
+        key.high = get<std::uint64_t>(record, 16);
+        index_[key] = scanned_;
+        scanned_ += record_size;
+    }
+}
+
+CachedResult ResultCache::read_record(std::size_t offset) const {
+    const std::uint8_t* record = map_ + offset;
+    CachedResult result;
+    result.status = static_cast<SolveStatus>(get<std::int8_t>(record, 24));
+    result.model_count = get<std::int64_t>(record, 32);
+
+    std::uint64_t counters[7];
+    double timings[4];
+    std::memcpy(counters, record + 40, sizeof(counters));
+    std::memcpy(timings, record + 96, sizeof(timings));
+    SolverStats& stats = result.stats;
+    stats.decisions = counters[0];
+    stats.propagations = counters[1];
+    stats.conflicts = counters[2];
+    stats.restarts = counters[3];
+    stats.learned_clauses = counters[4];
+    stats.deleted_clauses = counters[5];
+    stats.arena_bytes = counters[6];
+    stats.propagate_seconds = timings[0];
+    stats.analyze_seconds = timings[1];
+    stats.reduce_seconds = timings[2];
+    stats.total_seconds = timings[3];
+
+    std::uint32_t num_vars = get<std::uint32_t>(record, 28);
+    result.model.resize(num_vars);
+    for (std::uint32_t v = 0; v < num_vars; ++v) {
+        result.model[v] = (record[kRecordHeaderBytes + v / 8] >> (v % 8)) & 1u;
+    }
+    return result;
+}
+
+bool ResultCache::lookup(const utils::Hash128& key, CachedResult& result) {
+    std::lock_guard<std::mutex> guard(mutex_);
+    FileLock lock(fd_, LOCK_SH, path_);
+    refresh();
+
+    auto it = index_.find(key);
+    if (it == index_.end()) {
+        return false;
+    }
+    result = read_record(it->second);
+    return true;
+}
+
+void ResultCache::store(const utils::Hash128& key, const CachedResult& result) {
+    std::lock_guard<std::mutex> guard(mutex_);
+    FileLock lock(fd_, LOCK_EX, path_);
+    refresh();
+
+    CachedResult merged;
+    auto it = index_.find(key);
+    bool existed = it != index_.end();
+    if (existed) {
+        merged = read_record(it->second);
+    }
+    CachedResult previous = merged;
+    if (result.status != SolveStatus::UNKNOWN) {
+        merged.status = result.status;
+        merged.model = result.model;
+        merged.stats = result.stats;
+    }
+    if (result.model_count >= 0) {
+        merged.model_count = result.model_count;
+    }
+    if (merged.status == previous.status && merged.model_count == previous.model_count &&
+        (existed || merged.status == SolveStatus::UNKNOWN)) {
+        return;
+    }
+
+    // Drop a torn tail left by a writer that died mid-append
+    if (map_size_ > scanned_ && ftruncate(fd_, static_cast<off_t>(scanned_)) != 0) {
+        throw std::runtime_error("Cannot truncate " + path_ + ": " + std::strerror(errno));
+    }
+
+    std::vector<std::uint8_t> record = encode_record(key, merged);
+    write_all(fd_, record.data(), record.size(), static_cast<off_t>(scanned_), path_);
+    index_[key] = scanned_;
+    scanned_ += record.size();
+}
+
+std::size_t ResultCache::size() {
+    std::lock_guard<std::mutex> guard(mutex_);
+    FileLock lock(fd_, LOCK_SH, path_);
+    refresh();
+    return index_.size();
+}
+
+} // namespace sat_solver
@@ -1,21 +1,107 @@
 #include "sat_solver.h"
+#include "canonical.h"
+#include "cdcl_solver.h"
+#include "generators.h"
+#include "lookahead_solver.h"
+#include "result_cache.h"
+#include "thread_pool.h"
 #include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
 #include <random>
 #include <sstream>
-#include <set>
+#include <stdexcept>
+#include <climits>
+#include <cstdlib>
 
 namespace sat_solver {
 
-SATSolver::SATSolver() : num_variables_(0), has_satisfying_assignment_(false) {}
+namespace {
+
+/**
+ * Canonical form of a CSR clause arena, the key of the result cache.
+ */
+utils::CanonicalForm canonical_form(const std::vector<int>& literals, const std::vector<std::size_t>& offsets) {
+    std::vector<std::int64_t> csr(offsets.begin(), offsets.end());
+    return utils::canonicalize(literals.data(), csr.data(), csr.size() - 1, utils::kCacheKeyWork);
+}
+
+/**
+ * Canonical label of variable v, 0 if it does not occur.
+ */
+int canonical_label(const utils::CanonicalForm& canonical, int v) {
+    return static_cast<std::size_t>(v) < canonical.var_map.size() ? canonical.var_map[v] : 0;
+}
+
+/**
+ * Reject literals the engines cannot represent: 0 (the DIMACS clause
+ * terminator) and INT_MIN (no positive counterpart).
+ */
+void check_literals(const int* literals, std::size_t count) {
+    for (std::size_t i = 0; i < count; ++i) {
+        if (literals[i] == 0 || literals[i] == INT_MIN) {
+            throw std::invalid_argument("Invalid literal " + std::to_string(literals[i]) +
+                                        ": literals must be non-zero and greater than INT_MIN");
+        }
+    }
+}
+
+} // namespace
+
+SATSolver::SATSolver()
+    : clause_offsets_(1, 0), num_variables_(0), has_satisfying_assignment_(false), from_cache_(false),
+      mode_(SolverMode::CDCL), num_threads_(0), engine_clauses_(0) {}
 
 SATSolver::~SATSolver() {}
 
 void SATSolver::add_clause(const Clause& clause) {
-    formula_.push_back(clause);
+    check_literals(clause.data(), clause.size());
+    std::size_t first = literals_.size();
+    literals_.insert(literals_.end(), clause.begin(), clause.end());
+    clause_offsets_.push_back(literals_.size());
+    on_literals_added(first);
+}
+
+void SATSolver::add_clauses(const int* literals, const std::int64_t* offsets, std::size_t num_clauses) {
+    if (num_clauses == 0) {
+        return;
+    }
+    if (offsets[0] != 0) {
+        throw std::invalid_argument("CSR offsets must start at 0");
+    }
+    for (std::size_t i = 0; i < num_clauses; ++i) {
+        if (offsets[i + 1] < offsets[i]) {
+            throw std::invalid_argument("CSR offsets must be non-decreasing");
+        }
+    }
     
+    std::size_t first = literals_.size();
+    std::size_t count = static_cast<std::size_t>(offsets[num_clauses]);
+    check_literals(literals, count);
+    literals_.insert(literals_.end(), literals, literals + count);
+    clause_offsets_.reserve(clause_offsets_.size() + num_clauses);
+    for (std::size_t i = 1; i <= num_clauses; ++i) {
+        clause_offsets_.push_back(first + static_cast<std::size_t>(offsets[i]));
+    }
+    on_literals_added(first);
+}
+
+void SATSolver::add_clauses(const int* literals, std::size_t num_clauses, std::size_t width) {
+    check_literals(literals, num_clauses * width);
+    std::size_t first = literals_.size();
+    literals_.insert(literals_.end(), literals, literals + num_clauses * width);
+    clause_offsets_.reserve(clause_offsets_.size() + num_clauses);
+    for (std::size_t i = 1; i <= num_clauses; ++i) {
+        clause_offsets_.push_back(first + i * width);
+    }
+    on_literals_added(first);
+}
+
+void SATSolver::on_literals_added(std::size_t first) {
     // Update number of variables
-    for (int lit : clause) {
-        int var = std::abs(lit);
+    for (std::size_t i = first; i < literals_.size(); ++i) {
+        int var = std::abs(literals_[i]);
         if (var > num_variables_) {
             num_variables_ = var;
         }
@@ -27,10 +113,14 @@ void SATSolver::add_clause(const Clause& clause) {
 }
 
 void SATSolver::clear() {
-    formula_.clear();
+    literals_.clear();
+    clause_offsets_.assign(1, 0);
     num_variables_ = 0;
     assignment_.clear();
     has_satisfying_assignment_ = false;
+    stats_.reset();
+    engine_.reset();
+    engine_clauses_ = 0;
 }
 
 int SATSolver::get_num_variables() const {
@@ -38,25 +128,244 @@ int SATSolver::get_num_variables() const {
 }
 
 int SATSolver::get_num_clauses() const {
-    return formula_.size();
+    return clause_offsets_.size() - 1;
+}
+
+const std::vector<int>& SATSolver::get_literals() const {
+    return literals_;
+}
+
+const std::vector<std::size_t>& SATSolver::get_clause_offsets() const {
+    return clause_offsets_;
+}
+
+SATSolver::Formula SATSolver::get_formula() const {
+    Formula formula;
+    formula.reserve(clause_offsets_.size() - 1);
+    for (std::size_t i = 0; i + 1 < clause_offsets_.size(); ++i) {
+        formula.emplace_back(literals_.begin() + clause_offsets_[i],
+                             literals_.begin() + clause_offsets_[i + 1]);
+    }
+    return formula;
 }
 
 bool SATSolver::is_satisfiable() {
-    if (formula_.empty()) {
-        return true;
+    return run(SolveLimits()) == SolveStatus::SAT;
+}
+
+SolveResult SATSolver::solve(const SolveLimits& limits) {
+    SolveResult result;
+    result.status = run(limits);
+    result.satisfiable = result.status == SolveStatus::SAT;
+    if (result.satisfiable) {
+        result.assignment = get_satisfying_assignment();
     }
-    
+    result.stats = stats_;
+    result.cached = from_cache_;
+    return result;
+}
+
+SolveStatus SATSolver::run(const SolveLimits& limits) {
     // Reset assignment
     assignment_.assign(num_variables_ + 1, false);  // 1-indexed
     has_satisfying_assignment_ = false;
+    from_cache_ = false;
+    
+    utils::CanonicalForm canonical;
+    if (cache_) {
+        canonical = canonical_form(literals_, clause_offsets_);
+        CachedResult entry;
+        if (cache_->lookup(canonical.hash, entry) && entry.status != SolveStatus::UNKNOWN &&
+            (entry.status == SolveStatus::UNSAT || entry.model.size() == static_cast<std::size_t>(canonical.num_vars))) {
+            if (entry.status == SolveStatus::SAT) {
+                for (int v = 1; v <= num_variables_; ++v) {
+                    int label = canonical_label(canonical, v);
+                    assignment_[v] = label > 0 && entry.model[label - 1];
+                }
+                has_satisfying_assignment_ = true;
+            }
+            stats_ = entry.stats;
+            from_cache_ = true;
+            return entry.status;
+        }
+    }
+    
+    // An armed solver also stops on the process-wide checkpoint signal
+    SolveLimits run_limits = limits;
+    if (!checkpoint_path_.empty()) {
+        run_limits.cancel = std::make_shared<CancelToken>(limits.cancel, checkpoint_signal());
+    }
+    
+    // Load the clause arena straight into a fresh engine
+    SolveStatus status;
+    std::vector<bool> model;
+    if (mode_ == SolverMode::LOOKAHEAD) {
+        LookaheadSolver engine;
+        status = load(engine) ? engine.solve(run_limits) : SolveStatus::UNSAT;
+        model = engine.get_model();
+        stats_ = engine.get_stats();
+    } else if (mode_ == SolverMode::CUBE_AND_CONQUER) {
+        status = run_cube_and_conquer(run_limits, model);
+    } else {
+        // Resume an interrupted engine, feeding it the clauses added since
+        if (!engine_) {
+            engine_ = std::make_shared<CDCLSolver>();
+            engine_clauses_ = 0;
+        } else if (engine_.use_count() > 1) {
+            engine_ = std::make_shared<CDCLSolver>(*engine_);
+        }
+        bool consistent = load(*engine_, engine_clauses_);
+        engine_clauses_ = clause_offsets_.size() - 1;
+        status = consistent ? engine_->solve(std::vector<int>(), run_limits) : SolveStatus::UNSAT;
+        model = engine_->get_model();
+        stats_ = engine_->get_stats();
+        if (status != SolveStatus::UNKNOWN) {
+            engine_.reset();
+        }
+    }
     
-    // Make a copy of the formula for DPLL
-    Formula formula_copy = formula_;
+    if (status == SolveStatus::SAT) {
+        std::copy(model.begin(), model.end(), assignment_.begin() + 1);
+        has_satisfying_assignment_ = true;
+    }
     
-    bool result = dpll(formula_copy, assignment_, 1);
-    has_satisfying_assignment_ = result;
+    if (status == SolveStatus::UNKNOWN && !checkpoint_path_.empty() && checkpoint_signal()->cancelled()) {
+        checkpoint(checkpoint_path_);
+    }
     
-    return result;
+    // Budget-limited UNKNOWN verdicts are not worth keeping
+    if (cache_ && status != SolveStatus::UNKNOWN) {
+        CachedResult entry;
+        entry.status = status;
+        entry.stats = stats_;
+        if (status == SolveStatus::SAT) {
+            entry.model.assign(canonical.num_vars, false);
+            for (int v = 1; v <= num_variables_; ++v) {
+                int label = canonical_label(canonical, v);
+                if (label > 0) {
+                    entry.model[label - 1] = assignment_[v];
+                }
+            }
+        } else {
+            entry.model_count = 0;
+        }
+        cache_->store(canonical.hash, entry);
+    }
+    
+    return status;
+}
+
+template <typename Engine>
+bool SATSolver::load(Engine& engine, std::size_t first_clause) const {
+    engine.reserve_vars(num_variables_);
+    for (std::size_t i = first_clause; i + 1 < clause_offsets_.size(); ++i) {
+        if (!engine.add_clause(literals_.data() + clause_offsets_[i], clause_offsets_[i + 1] - clause_offsets_[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+SolveStatus SATSolver::run_cube_and_conquer(const SolveLimits& limits, std::vector<bool>& model) {
+    using Clock = std::chrono::steady_clock;
+    Clock::time_point deadline = Clock::now() + std::chrono::duration_cast<Clock::duration>(
+                                                    std::chrono::duration<double>(std::max(limits.max_seconds, 0.0)));
+    
+    unsigned num_threads = num_threads_ > 0 ? num_threads_ : std::max(1u, std::thread::hardware_concurrency());
+    int depth = 4;   // about 16 cubes per worker
+    for (unsigned n = num_threads; n > 1; n >>= 1) {
+        ++depth;
+    }
+    
+    LookaheadSolver splitter;
+    if (!load(splitter)) {
+        stats_ = splitter.get_stats();
+        return SolveStatus::UNSAT;
+    }
+    CubeSplit split = splitter.split(depth, limits);
+    stats_ = splitter.get_stats();
+    if (split.status != SolveStatus::UNKNOWN || split.cubes.empty()) {
+        model = std::move(split.model);
+        return split.status;
+    }
+    
+    // Workers pull cubes from a shared counter; the child token stops them all
+    // once a cube turns out satisfiable, and inherits the caller's token
+    auto stop = std::make_shared<CancelToken>(limits.cancel);
+    std::atomic<std::size_t> next(0);
+    std::mutex mutex;
+    bool satisfied = false;
+    bool unknown = false;
+    bool refuted = false;   // the formula itself is unsatisfiable
+    num_threads = static_cast<unsigned>(std::min<std::size_t>(num_threads, split.cubes.size()));
+    parallel_for(num_threads, num_threads, [&](std::size_t) {
+        CDCLSolver engine;
+        bool consistent = load(engine);
+        while (consistent) {
+            std::size_t i = next.fetch_add(1);
+            if (i >= split.cubes.size()) {
+                break;
+            }
+            if (stop->cancelled()) {
+                std::lock_guard<std::mutex> lock(mutex);
+                unknown = true;
+                break;
+            }
+            SolveLimits cube_limits = limits;
+            cube_limits.cancel = stop;
+            if (limits.max_seconds > 0.0) {
+                cube_limits.max_seconds = std::chrono::duration<double>(deadline - Clock::now()).count();
+                if (cube_limits.max_seconds <= 0.0) {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    unknown = true;
+                    break;
+                }
+            }
+            
+            SolveStatus status = engine.solve(split.cubes[i], cube_limits);
+            if (status == SolveStatus::SAT) {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (!satisfied) {
+                    satisfied = true;
+                    model = engine.get_model();
+                }
+                stop->cancel();
+                break;
+            }
+            if (status == SolveStatus::UNKNOWN) {
+                // Budgets apply per cube; another cube may still be satisfiable
+                std::lock_guard<std::mutex> lock(mutex);
+                unknown = true;
+            }
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        refuted = refuted || !consistent;
+        stats_ += engine.get_stats();
+    });
+    
+    if (satisfied) {
+        return SolveStatus::SAT;
+    }
+    return unknown && !refuted ? SolveStatus::UNKNOWN : SolveStatus::UNSAT;
+}
+
+void SATSolver::set_mode(SolverMode mode, unsigned num_threads) {
+    mode_ = mode;
+    num_threads_ = num_threads;
+}
+
+SolverMode SATSolver::get_mode() const {
+    return mode_;
+}
+
+CubeSplit SATSolver::generate_cubes(int depth, const SolveLimits& limits) const {
+    LookaheadSolver splitter;
+    if (!load(splitter)) {
+        CubeSplit split;
+        split.status = SolveStatus::UNSAT;
+        return split;
+    }
+    return splitter.split(depth, limits);
 }
 
 std::vector<bool> SATSolver::get_satisfying_assignment() {
@@ -71,15 +380,82 @@ std::vector<bool> SATSolver::get_satisfying_assignment() {
     return result;
 }
 
+std::uint64_t SATSolver::count_models(std::uint64_t limit) const {
+    // The cache counts models over the occurring variables; each unused
+    // variable among 1..n doubles the count
+    utils::CanonicalForm canonical;
+    int unused = 0;
+    if (cache_) {
+        canonical = canonical_form(literals_, clause_offsets_);
+        unused = num_variables_ - canonical.num_vars;
+        CachedResult entry;
+        if (unused < 64 && cache_->lookup(canonical.hash, entry) && entry.model_count >= 0) {
+            std::uint64_t count = static_cast<std::uint64_t>(entry.model_count);
+            if (unused == 0 || (count >> (64 - unused)) == 0) {
+                count <<= unused;
+                return limit > 0 ? std::min(count, limit) : count;
+            }
+        }
+    }
+    
+    CDCLSolver engine;
+    engine.reserve_vars(num_variables_);
+    bool consistent = true;
+    for (std::size_t i = 0; i + 1 < clause_offsets_.size() && consistent; ++i) {
+        consistent = engine.add_clause(literals_.data() + clause_offsets_[i],
+                                       clause_offsets_[i + 1] - clause_offsets_[i]);
+    }
+    
+    std::uint64_t count = 0;
+    std::vector<int> blocking(num_variables_);
+    while (consistent && (limit == 0 || count < limit) && engine.solve() == SolveStatus::SAT) {
+        ++count;
+        
+        // Exclude exactly this model and look for the next one
+        const std::vector<bool>& model = engine.get_model();
+        for (int v = 0; v < num_variables_; ++v) {
+            blocking[v] = model[v] ? -(v + 1) : v + 1;
+        }
+        if (num_variables_ == 0 || !engine.add_clause(blocking.data(), blocking.size())) {
+            break;
+        }
+    }
+    
+    // Only complete counts are cached
+    if (cache_ && unused < 64 && (limit == 0 || count < limit)) {
+        CachedResult entry;
+        entry.model_count = static_cast<std::int64_t>(count >> unused);
+        if (count == 0) {
+            entry.status = SolveStatus::UNSAT;
+        }
+        cache_->store(canonical.hash, entry);
+    }
+    
+    return count;
+}
+
+void SATSolver::set_cache(std::shared_ptr<ResultCache> cache) {
+    cache_ = std::move(cache);
+}
+
+const std::shared_ptr<ResultCache>& SATSolver::get_cache() const {
+    return cache_;
+}
+
+const SolverStats& SATSolver::get_stats() const {
+    return stats_;
+}
+
 std::string SATSolver::to_string() const {
     std::ostringstream oss;
+    std::size_t num_clauses = clause_offsets_.size() - 1;
     
-    for (size_t i = 0; i < formula_.size(); ++i) {
+    for (size_t i = 0; i < num_clauses; ++i) {
         oss << "(";
-        for (size_t j = 0; j < formula_[i].size(); ++j) {
-            if (j > 0) oss << " OR ";
+        for (size_t j = clause_offsets_[i]; j < clause_offsets_[i + 1]; ++j) {
+            if (j > clause_offsets_[i]) oss << " OR ";
             
-            int lit = formula_[i][j];
+            int lit = literals_[j];
             if (lit < 0) {
                 oss << "NOT x" << (-lit);
             } else {
@@ -88,7 +464,7 @@ std::string SATSolver::to_string() const {
         }
         oss << ")";
         
-        if (i < formula_.size() - 1) {
+        if (i < num_clauses - 1) {
             oss << " AND ";
         }
     }
@@ -97,231 +473,169 @@ std::string SATSolver::to_string() const {
 }
 
 bool SATSolver::is_3sat() const {
-    for (const auto& clause : formula_) {
-        if (clause.size() != 3) {
+    for (std::size_t i = 0; i + 1 < clause_offsets_.size(); ++i) {
+        if (clause_offsets_[i + 1] - clause_offsets_[i] != 3) {
             return false;
         }
     }
     return true;
 }
 
-bool SATSolver::dpll(Formula& formula, std::vector<bool>& assignment, int var) {
-    // Base case: if formula is empty, it's satisfied
-    if (formula.empty()) {
-        return true;
-    }
-    
-    // Check for empty clauses (unsatisfiable)
-    for (const auto& clause : formula) {
-        if (clause.empty()) {
-            return false;
-        }
-    }
-    
-    // Unit propagation
-    if (unit_propagate(formula, assignment)) {
-        return false;  // Conflict found
-    }
-    
-    // Pure literal elimination
-    pure_literal_eliminate(formula, assignment);
-    
-    // If formula is empty after simplification, it's satisfied
-    if (formula.empty()) {
-        return true;
-    }
-    
-    // Choose next variable
-    int next_var = choose_variable(formula);
-    if (next_var == -1) {
-        return true;  // No more variables to assign
-    }
-    
-    // Try assigning true
-    assignment[next_var] = true;
-    Formula formula_copy = formula;
-    simplify(formula_copy, assignment);
-    
-    if (dpll(formula_copy, assignment, next_var + 1)) {
-        return true;
-    }
-    
-    // Try assigning false
-    assignment[next_var] = false;
-    formula_copy = formula;
-    simplify(formula_copy, assignment);
-    
-    return dpll(formula_copy, assignment, next_var + 1);
-}
+namespace utils {
 
-bool SATSolver::unit_propagate(Formula& formula, std::vector<bool>& assignment) {
-    bool changed = true;
-    
-    while (changed) {
-        changed = false;
-        
-        for (auto it = formula.begin(); it != formula.end();) {
-            if (it->size() == 1) {
-                // Unit clause found
-                int lit = (*it)[0];
-                int var = std::abs(lit);
-                bool value = lit > 0;
-                
-                assignment[var] = value;
-                
-                // Remove satisfied clauses and literals
-                simplify(formula, assignment);
-                
-                changed = true;
-                break;  // Start over since formula changed
-            } else {
-                ++it;
-            }
-        }
-    }
-    
-    // Check for conflicts (empty clauses)
+namespace {
+
+const int kEnumerationMaxVars = 20;
+const std::size_t kBlocksPerTask = 64;
+
+// Truth tables of variables 1..6 across the 64 lanes of a word
+const std::uint64_t kLaneMasks[6] = {
+    0xAAAAAAAAAAAAAAAAull, 0xCCCCCCCCCCCCCCCCull, 0xF0F0F0F0F0F0F0F0ull,
+    0xFF00FF00FF00FF00ull, 0xFFFF0000FFFF0000ull, 0xFFFFFFFF00000000ull
+};
+
+/**
+ * Largest variable of a formula; throws on literals check_literals rejects,
+ * which would otherwise index before the lane masks.
+ */
+int max_variable(const SATSolver::Formula& formula) {
+    int num_vars = 0;
     for (const auto& clause : formula) {
-        if (clause.empty()) {
-            return true;  // Conflict
+        check_literals(clause.data(), clause.size());
+        for (int lit : clause) {
+            num_vars = std::max(num_vars, std::abs(lit));
         }
     }
-    
-    return false;  // No conflict
+    return num_vars;
 }
 
-bool SATSolver::pure_literal_eliminate(Formula& formula, std::vector<bool>& assignment) {
-    std::set<int> positive_literals, negative_literals;
-    
-    // Collect all literals
+/**
+ * Evaluate a formula on the 64 assignments of one block: lane i of block b is
+ * the assignment whose bits are (b << 6) | i, variable v taking bit v - 1.
+ */
+std::uint64_t evaluate_block(const SATSolver::Formula& formula, std::uint64_t block) {
+    std::uint64_t result = ~0ull;
     for (const auto& clause : formula) {
+        std::uint64_t satisfied = 0;
         for (int lit : clause) {
-            if (lit > 0) {
-                positive_literals.insert(lit);
-            } else {
-                negative_literals.insert(-lit);
-            }
+            int var = std::abs(lit) - 1;
+            std::uint64_t value = var < 6 ? kLaneMasks[var] : (((block >> (var - 6)) & 1u) ? ~0ull : 0ull);
+            satisfied |= lit > 0 ? value : ~value;
         }
-    }
-    
-    // Find pure literals
-    for (int var : positive_literals) {
-        if (negative_literals.find(var) == negative_literals.end()) {
-            // Pure positive literal
-            assignment[var] = true;
-            simplify(formula, assignment);
-            return true;
+        result &= satisfied;
+        if (result == 0) {
+            break;
         }
     }
-    
-    for (int var : negative_literals) {
-        if (positive_literals.find(var) == positive_literals.end()) {
-            // Pure negative literal
-            assignment[var] = false;
-            simplify(formula, assignment);
-            return true;
+    return result;
+}
+
+bool equivalent_by_enumeration(const SATSolver::Formula& f1, const SATSolver::Formula& f2,
+                               int num_vars, unsigned num_threads) {
+    std::uint64_t num_blocks = num_vars > 6 ? 1ull << (num_vars - 6) : 1;
+    std::uint64_t lanes = num_vars >= 6 ? ~0ull : (1ull << (1 << num_vars)) - 1;
+    std::size_t num_tasks = static_cast<std::size_t>((num_blocks + kBlocksPerTask - 1) / kBlocksPerTask);
+    std::atomic<bool> differ(false);
+    
+    parallel_for(num_tasks, num_threads, [&](std::size_t task) {
+        std::uint64_t first = task * kBlocksPerTask;
+        std::uint64_t last = std::min<std::uint64_t>(first + kBlocksPerTask, num_blocks);
+        for (std::uint64_t block = first; block < last && !differ.load(std::memory_order_relaxed); ++block) {
+            if ((evaluate_block(f1, block) ^ evaluate_block(f2, block)) & lanes) {
+                differ.store(true, std::memory_order_relaxed);
+            }
         }
-    }
+    });
     
-    return false;
+    return !differ.load();
 }
 
-int SATSolver::choose_variable(const Formula& formula) {
-    std::set<int> unassigned_vars;
-    
-    for (const auto& clause : formula) {
-        for (int lit : clause) {
-            unassigned_vars.insert(std::abs(lit));
-        }
+/**
+ * Check that every clause of `clauses` is implied by `formula`: formula AND NOT(clause)
+ * must be unsatisfiable. Each task loads `formula` into its own incremental engine
+ * and checks a contiguous slice of the clauses under assumptions.
+ */
+bool implies_all(const SATSolver::Formula& formula, const SATSolver::Formula& clauses,
+                 int num_vars, unsigned num_threads) {
+    if (clauses.empty()) {
+        return true;
     }
     
-    if (unassigned_vars.empty()) {
-        return -1;
-    }
+    unsigned workers = num_threads > 0 ? num_threads : std::max(1u, std::thread::hardware_concurrency());
+    std::size_t num_tasks = std::min<std::size_t>(clauses.size(), 4 * static_cast<std::size_t>(workers));
+    std::atomic<bool> failed(false);
     
-    return *unassigned_vars.begin();
-}
-
-void SATSolver::simplify(Formula& formula, const std::vector<bool>& assignment) {
-    for (auto clause_it = formula.begin(); clause_it != formula.end();) {
-        bool clause_satisfied = false;
-        
-        for (auto lit_it = clause_it->begin(); lit_it != clause_it->end();) {
-            int lit = *lit_it;
-            int var = std::abs(lit);
-            bool var_value = assignment[var];
-            
-            if ((lit > 0 && var_value) || (lit < 0 && !var_value)) {
-                // Literal is satisfied, entire clause is satisfied
-                clause_satisfied = true;
-                break;
-            } else if ((lit > 0 && !var_value) || (lit < 0 && var_value)) {
-                // Literal is falsified, remove it from clause
-                lit_it = clause_it->erase(lit_it);
-            } else {
-                ++lit_it;
+    parallel_for(num_tasks, num_threads, [&](std::size_t task) {
+        CDCLSolver engine;
+        engine.reserve_vars(num_vars);
+        for (const auto& clause : formula) {
+            if (!engine.add_clause(clause.data(), clause.size())) {
+                return;  // formula is unsatisfiable and implies everything
             }
         }
         
-        if (clause_satisfied) {
-            // Remove satisfied clause
-            clause_it = formula.erase(clause_it);
-        } else {
-            ++clause_it;
+        std::vector<int> assumptions;
+        std::size_t first = clauses.size() * task / num_tasks;
+        std::size_t last = clauses.size() * (task + 1) / num_tasks;
+        for (std::size_t i = first; i < last && !failed.load(std::memory_order_relaxed); ++i) {
+            assumptions.clear();
+            for (int lit : clauses[i]) {
+                assumptions.push_back(-lit);
+            }
+            if (engine.solve(assumptions) == SolveStatus::SAT) {
+                failed.store(true, std::memory_order_relaxed);
+            }
         }
-    }
+    });
+    
+    return !failed.load();
 }
 
-namespace utils {
+bool equivalent_by_miter(const SATSolver::Formula& f1, const SATSolver::Formula& f2,
+                         int num_vars, unsigned num_threads) {
+    return implies_all(f2, f1, num_vars, num_threads) && implies_all(f1, f2, num_vars, num_threads);
+}
+
+} // namespace
 
 SATSolver::Formula generate_random_3sat(int num_vars, int num_clauses) {
+    return generate_random_3sat(num_vars, num_clauses, random_seed());
+}
+
+SATSolver::Formula generate_random_3sat(int num_vars, int num_clauses, std::uint64_t seed) {
+    std::vector<int> flat = generate_random_3sat_flat(num_vars, num_clauses, seed);
     SATSolver::Formula formula;
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_int_distribution<> var_dist(1, num_vars);
-    std::uniform_int_distribution<> sign_dist(0, 1);
+    formula.reserve(num_clauses);
     
     for (int i = 0; i < num_clauses; ++i) {
-        SATSolver::Clause clause;
-        
-        for (int j = 0; j < 3; ++j) {
-            int var = var_dist(gen);
-            bool positive = sign_dist(gen);
-            
-            clause.push_back(positive ? var : -var);
-        }
-        
-        formula.push_back(clause);
+        formula.emplace_back(flat.begin() + 3 * i, flat.begin() + 3 * i + 3);
     }
     
     return formula;
 }
 
-bool are_equivalent(const SATSolver::Formula& f1, const SATSolver::Formula& f2) {
-    SATSolver solver1, solver2;
-    
-    for (const auto& clause : f1) {
-        solver1.add_clause(clause);
-    }
-    
-    for (const auto& clause : f2) {
-        solver2.add_clause(clause);
-    }
-    
-    bool sat1 = solver1.is_satisfiable();
-    bool sat2 = solver2.is_satisfiable();
-    
-    if (sat1 != sat2) {
-        return false;
-    }
-    
-    if (!sat1) {
-        return true;  // Both unsatisfiable
+std::vector<int> generate_random_3sat_flat(int num_vars, int num_clauses, std::uint64_t seed) {
+    InstanceSpec spec;
+    spec.num_vars = num_vars;
+    spec.num_clauses = num_clauses;
+    spec.k = 3;
+    
+    std::vector<int> literals(static_cast<std::size_t>(std::max(num_clauses, 0)) * 3);
+    generate_instance(spec, seed, 0, literals.data());
+    return literals;
+}
+
+std::uint64_t random_seed() {
+    std::random_device rd;
+    return (static_cast<std::uint64_t>(rd()) << 32) ^ rd();
+}
+
+bool are_equivalent(const SATSolver::Formula& f1, const SATSolver::Formula& f2, unsigned num_threads) {
+    int num_vars = std::max(max_variable(f1), max_variable(f2));
+    if (num_vars <= kEnumerationMaxVars) {
+        return equivalent_by_enumeration(f1, f2, num_vars, num_threads);
     }
-    
-    // For a more thorough check, we would need to enumerate all satisfying assignments
-    // This is a simplified equivalence check
-    return true;
+    return equivalent_by_miter(f1, f2, num_vars, num_threads);
 }
 
 } // namespace utils
@@ -0,0 +1,155 @@
+#include "shared_formula.h"
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace sat_solver {
+
+namespace {
+
+const char kMagic[4] = {'S', 'H', 'M', 'F'};
+const std::uint32_t kVersion = 1;
+
+// Segment layout (native byte order, offsets 8-byte aligned):
+//   magic, u32 version, u32 variables, u32 reserved, u64 clauses, u64 literals,
+//   i64 offsets[clauses + 1], i32 literals[]
+const std::size_t kHeaderBytes = 32;
+
+template <typename T>
+T get(const std::uint8_t* map, std::size_t offset) {
+    T value;
+    std::memcpy(&value, map + offset, sizeof(T));
+    return value;
+}
+
+std::string unique_name() {
+    static std::atomic<unsigned> counter(0);
+    return "/sat_solver_" + std::to_string(getpid()) + "_" + std::to_string(counter++);
+}
+
+} // namespace
+
+SharedFormula::SharedFormula(const std::string& name, bool owner, void* map, std::size_t size)
+    : name_(name), owner_(owner), owner_pid_(getpid()), map_(static_cast<const std::uint8_t*>(map)),
+      map_size_(size) {}
+
+SharedFormula::~SharedFormula() {
+    munmap(const_cast<std::uint8_t*>(map_), map_size_);
+    // A forked child inherits the handle but must not remove the name
+    if (owner_ && getpid() == owner_pid_) {
+        shm_unlink(name_.c_str());
+    }
+}
+
+std::shared_ptr<SharedFormula> SharedFormula::create(const SATSolver& solver, const std::string& name) {
+    std::string segment = name.empty() ? unique_name() : name;
+    const std::vector<int>& literals = solver.get_literals();
+    const std::vector<std::size_t>& offsets = solver.get_clause_offsets();
+    std::uint64_t num_clauses = offsets.size() - 1;
+    std::uint64_t num_literals = literals.size();
+    std::size_t size = kHeaderBytes + offsets.size() * sizeof(std::int64_t) + literals.size() * sizeof(int);
+
+    int fd = shm_open(segment.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd < 0) {
+        throw std::runtime_error("Cannot create shared memory " + segment + ": " + std::strerror(errno));
+    }
+    void* map = MAP_FAILED;
+    if (ftruncate(fd, static_cast<off_t>(size)) == 0) {
+        map = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    int error = errno;
+    close(fd);
+    if (map == MAP_FAILED) {
+        shm_unlink(segment.c_str());
+        throw std::runtime_error("Cannot map shared memory " + segment + ": " + std::strerror(error));
+    }
+
+    std::uint8_t* bytes = static_cast<std::uint8_t*>(map);
+    std::uint32_t num_vars = static_cast<std::uint32_t>(solver.get_num_variables());
+    std::memset(bytes, 0, kHeaderBytes);
+    std::memcpy(bytes, kMagic, sizeof(kMagic));
+    std::memcpy(bytes + 4, &kVersion, sizeof(kVersion));
+    std::memcpy(bytes + 8, &num_vars, sizeof(num_vars));
+    std::memcpy(bytes + 16, &num_clauses, sizeof(num_clauses));
+    std::memcpy(bytes + 24, &num_literals, sizeof(num_literals));
+    std::int64_t* shared_offsets = reinterpret_cast<std::int64_t*>(bytes + kHeaderBytes);
+    for (std::size_t i = 0; i < offsets.size(); ++i) {
+        shared_offsets[i] = static_cast<std::int64_t>(offsets[i]);
+    }
+    if (!literals.empty()) {
+        std::memcpy(shared_offsets + offsets.size(), literals.data(), literals.size() * sizeof(int));
+    }
+    mprotect(map, size, PROT_READ);
+
+    return std::shared_ptr<SharedFormula>(new SharedFormula(segment, true, map, size));
+}
+
+std::shared_ptr<SharedFormula> SharedFormula::attach(const std::string& name) {
+    int fd = shm_open(name.c_str(), O_RDONLY, 0);
+    if (fd < 0) {
+        throw std::runtime_error("Cannot open shared memory " + name + ": " + std::strerror(errno));
+    }
+    struct stat info;
+    void* map = MAP_FAILED;
+    std::size_t size = 0;
+    if (fstat(fd, &info) == 0) {
+        size = static_cast<std::size_t>(info.st_size);
+        if (size >= kHeaderBytes) {
+            map = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+        }
+    }
+    close(fd);
+    if (map == MAP_FAILED) {
+        throw std::runtime_error("Cannot map shared memory " + name);
+    }
+
+    // Validate before handing out pointers into the mapping
+    std::shared_ptr<SharedFormula> formula(new SharedFormula(name, false, map, size));
+    const std::uint8_t* bytes = formula->map_;
+    std::uint64_t num_clauses = get<std::uint64_t>(bytes, 16);
+    std::uint64_t num_literals = get<std::uint64_t>(bytes, 24);
+    std::size_t available = size - kHeaderBytes;
+    if (std::memcmp(bytes, kMagic, sizeof(kMagic)) != 0 || get<std::uint32_t>(bytes, 4) != kVersion ||
+        num_clauses >= available / sizeof(std::int64_t) ||
+        num_literals > (available - (num_clauses + 1) * sizeof(std::int64_t)) / sizeof(int)) {
+        throw std::runtime_error(name + " is not a shared formula");
+    }
+    const std::int64_t* offsets = formula->offsets();
+    if (offsets[0] != 0 || offsets[num_clauses] != static_cast<std::int64_t>(num_literals)) {
+        throw std::runtime_error(name + " has corrupt clause offsets");
+    }
+    return formula;
+}
+
+int SharedFormula::get_num_variables() const {
+    return static_cast<int>(get<std::uint32_t>(map_, 8));
+}
+
+std::size_t SharedFormula::get_num_clauses() const {
+    return static_cast<std::size_t>(get<std::uint64_t>(map_, 16));
+}
+
+std::size_t SharedFormula::get_num_literals() const {
+    return static_cast<std::size_t>(get<std::uint64_t>(map_, 24));
+}
+
+const std::int64_t* SharedFormula::offsets() const {
+    return reinterpret_cast<const std::int64_t*>(map_ + kHeaderBytes);
+}
+
+const int* SharedFormula::literals() const {
+    return reinterpret_cast<const int*>(offsets() + get_num_clauses() + 1);
+}
+
+SATSolver SharedFormula::to_solver() const {
+    SATSolver solver;
+    solver.add_clauses(literals(), offsets(), get_num_clauses());
+    return solver;
+}
+
+} // namespace sat_solver
@@ -0,0 +1,38 @@
+#include "solver_stats.h"
+#include <algorithm>
+#include <sstream>
+
+namespace sat_solver {
+
+SolverStats& SolverStats::operator+=(const SolverStats& other) {
+    decisions += other.decisions;
+    propagations += other.propagations;
+    conflicts += other.conflicts;
+    restarts += other.restarts;
+    learned_clauses += other.learned_clauses;
+    deleted_clauses += other.deleted_clauses;
+    arena_bytes = std::max(arena_bytes, other.arena_bytes);
+    propagate_seconds += other.propagate_seconds;
+    analyze_seconds += other.analyze_seconds;
+    reduce_seconds += other.reduce_seconds;
+    total_seconds += other.total_seconds;
+    return *this;
+}
+
+std::string SolverStats::to_dimacs_comments() const {
+    std::ostringstream oss;
+    oss << "c stats decisions: " << decisions << "\n";
+    oss << "c stats propagations: " << propagations << "\n";
+    oss << "c stats conflicts: " << conflicts << "\n";
+    oss << "c stats restarts: " << restarts << "\n";
+    oss << "c stats learned_clauses: " << learned_clauses << "\n";
+    oss << "c stats deleted_clauses: " << deleted_clauses << "\n";
+    oss << "c stats arena_bytes: " << arena_bytes << "\n";
+    oss << "c stats propagate_seconds: " << propagate_seconds << "\n";
+    oss << "c stats analyze_seconds: " << analyze_seconds << "\n";
+    oss << "c stats reduce_seconds: " << reduce_seconds << "\n";
+    oss << "c stats total_seconds: " << total_seconds << "\n";
+    return oss.str();
+}
+
+} // namespace sat_solver
@@ -0,0 +1,261 @@
+#include "thread_pool.h"
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <memory>
+#include <pthread.h>
+
+namespace sat_solver {
+
+namespace {
+
+std::mutex shared_mutex;
+std::unique_ptr<ThreadPool> shared_pool;
+
+// Hold shared_mutex across fork() so the child never inherits it locked
+void before_fork() {
+    shared_mutex.lock();
+}
+
+void after_fork_in_parent() {
+    shared_mutex.unlock();
+}
+
+void after_fork_in_child() {
+    // The child has none of the pool's worker threads; destroying the pool
+    // would join threads that do not exist, so leak it and start over
+    shared_pool.release();
+    shared_mutex.unlock();
+}
+
+/**
+ * Run the on_drop callbacks of jobs that will never start, then destroy
+ * the jobs. Called without the pool lock held; the callbacks and captures
+ * may need other locks (e.g. the Python GIL).
+ */
+template <typename Jobs>
+void drop_jobs(Jobs& jobs) {
+    for (auto& job : jobs) {
+        if (job.on_drop) {
+            try {
+                job.on_drop();
+            } catch (...) {
+                // Like tasks, drop callbacks report their own errors
+            }
+        }
+    }
+    jobs.clear();
+}
+
+/**
+ * Slice of the index space owned by one parallel_for worker.
+ */
+struct alignas(64) WorkRange {
+    std::mutex mutex;
+    std::size_t begin = 0;
+    std::size_t end = 0;
+};
+
+} // namespace
+
+ThreadPool::ThreadPool(unsigned num_threads) : stopping_(false), cancel_(std::make_shared<CancelToken>()) {
+    if (num_threads == 0) {
+        num_threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    workers_.reserve(num_threads);
+    for (unsigned i = 0; i < num_threads; ++i) {
+        workers_.emplace_back(&ThreadPool::run, this);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    shutdown();
+}
+
+void ThreadPool::submit(Task task, Task on_drop) {
+    std::vector<Job> rejected;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stopping_) {
+            rejected.push_back(Job{std::move(task), std::move(on_drop)});
+        } else {
+            jobs_.push_back(Job{std::move(task), std::move(on_drop)});
+        }
+    }
+    if (!rejected.empty()) {
+        drop_jobs(rejected);
+        return;
+    }
+    cv_.notify_one();
+}
+
+unsigned ThreadPool::size() const {
+    return workers_.size();
+}
+
+void ThreadPool::shutdown(bool cancel_running) {
+    if (cancel_running) {
+        cancel_->cancel();
+    }
+
+    std::deque<Job> dropped;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stopping_ && workers_.empty()) {
+            return;
+        }
+        stopping_ = true;
+        dropped.swap(jobs_);
+    }
+    cv_.notify_all();
+
+    drop_jobs(dropped);
+
+    for (auto& worker : workers_) {
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+    workers_.clear();
+}
+
+void ThreadPool::run() {
+    for (;;) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cv_.wait(lock, [this] { return stopping_ || !jobs_.empty(); });
+            if (stopping_) {
+                return;
+            }
+            job = std::move(jobs_.front());
+            jobs_.pop_front();
+        }
+
+        try {
+            job.task();
+        } catch (...) {
+            // Tasks report their own errors; never let one kill a worker
+        }
+    }
+}
+
+ThreadPool& ThreadPool::shared() {
+    std::lock_guard<std::mutex> lock(shared_mutex);
+    if (!shared_pool) {
+        static const int fork_handlers = pthread_atfork(before_fork, after_fork_in_parent, after_fork_in_child);
+        (void)fork_handlers;
+        shared_pool.reset(new ThreadPool());
+    }
+    return *shared_pool;
+}
+
+void parallel_for(std::size_t count, unsigned num_threads, const std::function<void(std::size_t)>& body) {
+    if (num_threads == 0) {
+        num_threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    num_threads = static_cast<unsigned>(std::min<std::size_t>(num_threads, count));
+    if (num_threads <= 1) {
+        for (std::size_t i = 0; i < count; ++i) {
+            body(i);
+        }
+        return;
+    }
+
+    std::vector<WorkRange> ranges(num_threads);
+    for (unsigned w = 0; w < num_threads; ++w) {
+        ranges[w].begin = count * w / num_threads;
+        ranges[w].end = count * (w + 1) / num_threads;
+    }
+
+    std::atomic<bool> failed(false);
+    std::exception_ptr error;
+    std::mutex error_mutex;
+
+    auto work = [&](unsigned self) {
+        WorkRange& own = ranges[self];
+        while (!failed.load(std::memory_order_relaxed)) {
+            std::size_t index;
+            {
+                std::lock_guard<std::mutex> lock(own.mutex);
+                if (own.begin < own.end) {
+                    index = own.begin++;
+                } else {
+                    index = count;
+                }
+            }
+
+            if (index == count) {
+                // Out of work: steal the upper half of the fullest range
+                unsigned victim = self;
+                std::size_t most = 0;
+                for (unsigned w = 0; w < num_threads; ++w) {
+                    std::lock_guard<std::mutex> lock(ranges[w].mutex);
+                    std::size_t left = ranges[w].end - ranges[w].begin;
+                    if (left > most) {
+                        most = left;
+                        victim = w;
+                    }
+                }
+                if (most == 0) {
+                    return;
+                }
+
+                std::size_t stolen_begin, stolen_end;
+                {
+                    std::lock_guard<std::mutex> lock(ranges[victim].mutex);
+                    WorkRange& range = ranges[victim];
+                    if (range.begin >= range.end) {
+                        continue;  // drained meanwhile, look again
+                    }
+                    std::size_t mid = range.begin + (range.end - range.begin) / 2;
+                    stolen_begin = mid;
+                    stolen_end = range.end;
+                    range.end = mid;
+                }
+                std::lock_guard<std::mutex> lock(own.mutex);
+                own.begin = stolen_begin;
+                own.end = stolen_end;
+                continue;
+            }
+
+            try {
+                body(index);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(error_mutex);
+                if (!error) {
+                    error = std::current_exception();
+                }
+                failed.store(true, std::memory_order_relaxed);
+            }
+        }
+    };
+
+    std::vector<std::thread> workers;
+    workers.reserve(num_threads - 1);
+    for (unsigned w = 1; w < num_threads; ++w) {
+        workers.emplace_back(work, w);
+    }
+    work(0);
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+void ThreadPool::shutdown_shared() {
+    ThreadPool* pool;
+    {
+        std::lock_guard<std::mutex> lock(shared_mutex);
+        pool = shared_pool.get();
+    }
+    if (pool) {
+        pool->shutdown(true);
+    }
+}
+
+} // namespace sat_solver
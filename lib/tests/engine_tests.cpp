@@ -0,0 +1,85 @@
+// Regression checks for the solver engines that the Python bindings cannot
+// reach: the bindings build a fresh engine for every call, so state left
+// behind between two calls on one engine only shows up here.
+//
+//   ctest -R engine_tests
+
+#include "lookahead_solver.h"
+#include "solve_limits.h"
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+namespace {
+
+using namespace sat_solver;
+
+int failures = 0;
+
+void check(bool condition, const char* what) {
+    if (!condition) {
+        std::fprintf(stderr, "FAILED: %s\n", what);
+        ++failures;
+    }
+}
+
+/**
+ * (1 v 2 v 3)(-1 v 2)(-2 v 3 v 4), satisfiable with or without the unit 2.
+ */
+void load(LookaheadSolver& solver) {
+    const std::vector<std::vector<int>> clauses = {{1, 2, 3}, {-1, 2}, {-2, 3, 4}};
+    for (const auto& clause : clauses) {
+        solver.add_clause(clause.data(), clause.size());
+    }
+}
+
+void lookahead_budget_does_not_outlive_solve() {
+    LookaheadSolver solver;
+    load(solver);
+    SolveLimits limits;
+    limits.max_propagations = 1;
+    check(solver.solve(limits) != SolveStatus::UNSAT, "budgeted solve is not UNSAT");
+
+    const int unit[] = {2};
+    check(solver.add_clause(unit, 1), "unit after a budgeted solve is accepted");
+    check(solver.solve() == SolveStatus::SAT, "solve after a budgeted solve is SAT");
+}
+
+void lookahead_budget_does_not_outlive_split() {
+    LookaheadSolver solver;
+    load(solver);
+    SolveLimits limits;
+    limits.max_propagations = 1;
+    solver.split(2, limits);
+
+    const int unit[] = {2};
+    check(solver.add_clause(unit, 1), "unit after a budgeted split is accepted");
+    check(solver.solve() == SolveStatus::SAT, "solve after a budgeted split is SAT");
+}
+
+void lookahead_token_does_not_outlive_solve() {
+    LookaheadSolver solver;
+    load(solver);
+    {
+        SolveLimits limits;
+        limits.cancel = std::make_shared<CancelToken>();
+        check(solver.solve(limits) == SolveStatus::SAT, "solve with a live token is SAT");
+    }
+
+    // The token is gone; root propagation must not look at it
+    const int unit[] = {2};
+    check(solver.add_clause(unit, 1), "unit after the token is destroyed is accepted");
+    check(solver.solve() == SolveStatus::SAT, "solve after the token is destroyed is SAT");
+}
+
+}  // namespace
+
+int main() {
+    lookahead_budget_does_not_outlive_solve();
+    lookahead_budget_does_not_outlive_split();
+    lookahead_token_does_not_outlive_solve();
+    if (failures == 0) {
+        std::printf("engine_tests: all checks passed\n");
+    }
+    return failures == 0 ? 0 : 1;
+}
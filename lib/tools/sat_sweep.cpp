@@ -0,0 +1,331 @@
+// Phase-transition sweep: solve random k-SAT instances over a grid of variable
+// counts and clause/variable ratios and write per-instance and per-point CSV.
+//
+//   sat_sweep --nvars_min=50 --nvars_max=150 --nvars_step=25
+//             --ratio_min=3.5 --ratio_max=5.0 --ratio_step=0.1 --samples=200
+//             --mode=cdcl --max_seconds=10 --out=sweep.csv --summary=summary.csv
+
+#include "generators.h"
+#include "sat_solver.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+using namespace sat_solver;
+
+struct Options {
+    int nvars_min = 50;
+    int nvars_max = 50;
+    int nvars_step = 10;
+    double ratio_min = 3.0;
+    double ratio_max = 6.0;
+    double ratio_step = 0.1;
+    int k = 3;
+    int samples = 100;
+    std::uint64_t seed = 1;
+    utils::InstanceKind kind = utils::InstanceKind::UNIFORM;
+    SolverMode mode = SolverMode::CDCL;
+    unsigned threads = 0;
+    SolveLimits limits;
+    std::string out = "sweep.csv";
+    std::string summary = "sweep_summary.csv";
+};
+
+/**
+ * Outcome of one instance of the sweep.
+ */
+struct Row {
+    int num_vars;
+    int num_clauses;
+    double ratio;
+    int sample;
+    SolveStatus status;
+    double seconds;
+    SolverStats stats;
+};
+
+const char* const kUsage =
+    "usage: sat_sweep [options]\n"
+    "  --nvars_min=N --nvars_max=N --nvars_step=N   variable counts (default 50, max = min, step 10)\n"
+    "  --ratio_min=A --ratio_max=A --ratio_step=A   clause/variable ratios (default 3.0..6.0 step 0.1)\n"
+    "  --k=K                                        clause width (default 3)\n"
+    "  --samples=S                                  instances per grid point (default 100)\n"
+    "  --seed=S                                     generator seed (default 1)\n"
+    "  --kind=uniform|planted|regular               instance family (default uniform)\n"
+    "  --mode=cdcl|lookahead|cube                   search engine (default cdcl)\n"
+    "  --threads=T                                  worker threads, 0 = all cores (default 0)\n"
+    "  --max_conflicts=C --max_propagations=P --max_seconds=S   per-instance budget (default none)\n"
+    "  --out=FILE                                   per-instance CSV (default sweep.csv)\n"
+    "  --summary=FILE                               per-grid-point CSV (default sweep_summary.csv)\n";
+
+long long parse_integer(const std::string& name, const std::string& value) {
+    char* end = nullptr;
+    long long parsed = std::strtoll(value.c_str(), &end, 10);
+    if (value.empty() || *end != '\0') {
+        throw std::invalid_argument("--" + name + " expects an integer, got '" + value + "'");
+    }
+    return parsed;
+}
+
+double parse_number(const std::string& name, const std::string& value) {
+    char* end = nullptr;
+    double parsed = std::strtod(value.c_str(), &end);
+    if (value.empty() || *end != '\0') {
+        throw std::invalid_argument("--" + name + " expects a number, got '" + value + "'");
+    }
+    return parsed;
+}
+
+Options parse_options(int argc, char** argv) {
+    Options options;
+    bool nvars_max_given = false;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.compare(0, 2, "--") != 0) {
+            throw std::invalid_argument("Unexpected argument '" + arg + "'");
+        }
+        std::string name = arg.substr(2);
+        std::string value;
+        std::size_t eq = name.find('=');
+        if (eq != std::string::npos) {
+            value = name.substr(eq + 1);
+            name.resize(eq);
+        } else if (name != "help") {
+            if (i + 1 >= argc) {
+                throw std::invalid_argument("--" + name + " needs a value");
+            }
+            value = argv[++i];
+        }
+
+        if (name == "help") {
+            std::fputs(kUsage, stdout);
+            std::exit(0);
+        } else if (name == "nvars_min") {
+            options.nvars_min = static_cast<int>(parse_integer(name, value));
+        } else if (name == "nvars_max") {
+            options.nvars_max = static_cast<int>(parse_integer(name, value));
+            nvars_max_given = true;
+        } else if (name == "nvars_step") {
+            options.nvars_step = static_cast<int>(parse_integer(name, value));
+        } else if (name == "ratio_min") {
+            options.ratio_min = parse_number(name, value);
+        } else if (name == "ratio_max") {
+            options.ratio_max = parse_number(name, value);
+        } else if (name == "ratio_step") {
+            options.ratio_step = parse_number(name, value);
+        } else if (name == "k") {
+            options.k = static_cast<int>(parse_integer(name, value));
+        } else if (name == "samples") {
+            options.samples = static_cast<int>(parse_integer(name, value));
+        } else if (name == "seed") {
+            options.seed = static_cast<std::uint64_t>(parse_integer(name, value));
+        } else if (name == "kind") {
+            if (value == "uniform") {
+                options.kind = utils::InstanceKind::UNIFORM;
+            } else if (value == "planted") {
+                options.kind = utils::InstanceKind::PLANTED;
+            } else if (value == "regular") {
+                options.kind = utils::InstanceKind::REGULAR;
+            } else {
+                throw std::invalid_argument("Unknown instance kind '" + value + "'");
+            }
+        } else if (name == "mode") {
+            if (value == "cdcl") {
+                options.mode = SolverMode::CDCL;
+            } else if (value == "lookahead") {
+                options.mode = SolverMode::LOOKAHEAD;
+            } else if (value == "cube") {
+                options.mode = SolverMode::CUBE_AND_CONQUER;
+            } else {
+                throw std::invalid_argument("Unknown solver mode '" + value + "'");
+            }
+        } else if (name == "threads") {
+            options.threads = static_cast<unsigned>(parse_integer(name, value));
+        } else if (name == "max_conflicts") {
+            options.limits.max_conflicts = static_cast<std::uint64_t>(parse_integer(name, value));
+        } else if (name == "max_propagations") {
+            options.limits.max_propagations = static_cast<std::uint64_t>(parse_integer(name, value));
+        } else if (name == "max_seconds") {
+            options.limits.max_seconds = parse_number(name, value);
+        } else if (name == "out") {
+            options.out = value;
+        } else if (name == "summary") {
+            options.summary = value;
+        } else {
+            throw std::invalid_argument("Unknown option --" + name);
+        }
+    }
+
+    if (!nvars_max_given) {
+        options.nvars_max = options.nvars_min;
+    }
+    if (options.nvars_min < options.k || options.nvars_max < options.nvars_min || options.nvars_step < 1) {
+        throw std::invalid_argument("Need k <= nvars_min <= nvars_max and nvars_step >= 1");
+    }
+    if (options.ratio_min < 0.0 || options.ratio_max < options.ratio_min || options.ratio_step <= 0.0) {
+        throw std::invalid_argument("Need 0 <= ratio_min <= ratio_max and ratio_step > 0");
+    }
+    if (options.samples < 1 || options.k < 1) {
+        throw std::invalid_argument("Need samples >= 1 and k >= 1");
+    }
+    return options;
+}
+
+/**
+ * Solve the samples of one grid point in parallel. Sample s of the whole
+ * sweep uses generator stream first_stream + s, so results do not depend on
+ * the thread count.
+ */
+void solve_point(const Options& options, int num_vars, double ratio, std::uint64_t first_stream,
+                 std::vector<Row>& rows) {
+    utils::InstanceSpec spec;
+    spec.kind = options.kind;
+    spec.num_vars = num_vars;
+    spec.num_clauses = static_cast<int>(std::lround(ratio * num_vars));
+    spec.k = options.k;
+
+    std::size_t first_row = rows.size();
+    rows.resize(first_row + options.samples);
+    parallel_for(options.samples, options.threads, [&](std::size_t sample) {
+        std::vector<int> literals(static_cast<std::size_t>(spec.num_clauses) * spec.k);
+        utils::generate_instance(spec, options.seed, first_stream + sample, literals.data());
+
+        SATSolver solver;
+        solver.add_clauses(literals.data(), spec.num_clauses, spec.k);
+        solver.set_mode(options.mode, 1);   // the sweep is already parallel across instances
+
+        auto start = std::chrono::steady_clock::now();
+        SolveResult result = solver.solve(options.limits);
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+        Row& row = rows[first_row + sample];
+        row.num_vars = num_vars;
+        row.num_clauses = spec.num_clauses;
+        row.ratio = ratio;
+        row.sample = static_cast<int>(sample);
+        row.status = result.status;
+        row.seconds = elapsed.count();
+        row.stats = result.stats;
+    });
+}
+
+/**
+ * Value at quantile q of sorted values (nearest rank).
+ */
+double quantile(const std::vector<double>& sorted, double q) {
+    std::size_t rank = static_cast<std::size_t>(std::ceil(q * sorted.size()));
+    return sorted[std::min(sorted.size() - 1, rank > 0 ? rank - 1 : 0)];
+}
+
+struct FileCloser {
+    void operator()(std::FILE* file) const { std::fclose(file); }
+};
+using File = std::unique_ptr<std::FILE, FileCloser>;
+
+File open_output(const std::string& path) {
+    File file(std::fopen(path.c_str(), "w"));
+    if (!file) {
+        throw std::runtime_error("Cannot open " + path);
+    }
+    return file;
+}
+
+void write_instances(const std::string& path, const std::vector<Row>& rows) {
+    File file = open_output(path);
+    std::fprintf(file.get(), "n,m,ratio,sample,status,seconds,decisions,propagations,conflicts,restarts,"
+                             "learned_clauses,deleted_clauses,arena_bytes\n");
+    for (const Row& row : rows) {
+        const SolverStats& stats = row.stats;
+        std::fprintf(file.get(), "%d,%d,%.4f,%d,%d,%.9f,%llu,%llu,%llu,%llu,%llu,%llu,%llu\n", row.num_vars,
+                     row.num_clauses, row.ratio, row.sample, static_cast<int>(row.status), row.seconds,
+                     static_cast<unsigned long long>(stats.decisions),
+                     static_cast<unsigned long long>(stats.propagations),
+                     static_cast<unsigned long long>(stats.conflicts),
+                     static_cast<unsigned long long>(stats.restarts),
+                     static_cast<unsigned long long>(stats.learned_clauses),
+                     static_cast<unsigned long long>(stats.deleted_clauses),
+                     static_cast<unsigned long long>(stats.arena_bytes));
+    }
+    if (std::fflush(file.get()) != 0) {
+        throw std::runtime_error("Failed to write " + path);
+    }
+}
+
+void write_summary(const std::string& path, const std::vector<Row>& rows, std::size_t samples) {
+    // The samples of a grid point are contiguous
+    File file = open_output(path);
+    std::fprintf(file.get(), "n,m,ratio,samples,sat_fraction,unknown_fraction,median_seconds,p90_seconds,"
+                             "p99_seconds,max_seconds,mean_decisions,mean_conflicts,mean_propagations\n");
+    for (std::size_t first = 0; first < rows.size(); first += samples) {
+        std::size_t last = std::min(rows.size(), first + samples);
+
+        std::vector<double> seconds;
+        std::size_t sat = 0, unknown = 0;
+        double decisions = 0.0, conflicts = 0.0, propagations = 0.0;
+        for (std::size_t i = first; i < last; ++i) {
+            seconds.push_back(rows[i].seconds);
+            sat += rows[i].status == SolveStatus::SAT;
+            unknown += rows[i].status == SolveStatus::UNKNOWN;
+            decisions += rows[i].stats.decisions;
+            conflicts += rows[i].stats.conflicts;
+            propagations += rows[i].stats.propagations;
+        }
+        std::sort(seconds.begin(), seconds.end());
+        double count = static_cast<double>(last - first);
+        std::fprintf(file.get(), "%d,%d,%.4f,%zu,%.6f,%.6f,%.9f,%.9f,%.9f,%.9f,%.1f,%.1f,%.1f\n",
+                     rows[first].num_vars, rows[first].num_clauses, rows[first].ratio, last - first, sat / count,
+                     unknown / count, quantile(seconds, 0.5), quantile(seconds, 0.9), quantile(seconds, 0.99),
+                     seconds.back(), decisions / count, conflicts / count, propagations / count);
+    }
+    if (std::fflush(file.get()) != 0) {
+        throw std::runtime_error("Failed to write " + path);
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    try {
+        options = parse_options(argc, argv);
+    } catch (const std::invalid_argument& e) {
+        std::fprintf(stderr, "sat_sweep: %s\n%s", e.what(), kUsage);
+        return 2;
+    }
+
+    try {
+        std::vector<Row> rows;
+        std::uint64_t stream = 0;
+        for (int n = options.nvars_min; n <= options.nvars_max; n += options.nvars_step) {
+            // Step by index so the grid does not drift with rounding errors
+            for (int i = 0; options.ratio_min + i * options.ratio_step <= options.ratio_max + 1e-9; ++i) {
+                double ratio = options.ratio_min + i * options.ratio_step;
+                std::size_t first = rows.size();
+                solve_point(options, n, ratio, stream, rows);
+                stream += options.samples;
+
+                std::size_t sat = 0;
+                for (std::size_t r = first; r < rows.size(); ++r) {
+                    sat += rows[r].status == SolveStatus::SAT;
+                }
+                std::fprintf(stderr, "n=%d ratio=%.3f sat=%zu/%d\n", n, ratio, sat, options.samples);
+            }
+        }
+        write_instances(options.out, rows);
+        write_summary(options.summary, rows, options.samples);
+    } catch (const std::exception& e) {
+        std::fprintf(stderr, "sat_sweep: %s\n", e.what());
+        return 1;
+    }
+    return 0;
+}
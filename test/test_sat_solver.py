@@ -5,6 +5,7 @@ Test suite for the SAT solver C++ library Python bindings.
 import pytest
 import sys
 import os
+import numpy as np
 
 # Add src directory to path so we can import the compiled module
 sys.path.insert(0, os.path.join(os.path.dirname(__file__), '..', 'src'))
@@ -36,6 +37,24 @@ class TestSATSolver:
         assert solver.get_num_clauses() == 2
         assert solver.get_num_variables() == 3
         
+    def test_add_clause_rejects_invalid_literals(self):
+        """Test that 0 and INT_MIN are rejected on every ingestion path."""
+        solver = sat_solver.SATSolver()
+        solver.add_clause([1, 2])
+        with pytest.raises(ValueError):
+            solver.add_clause([1, -2, 0])
+        with pytest.raises(ValueError):
+            solver.add_clause([-2**31])
+        with pytest.raises(ValueError):
+            solver.add_clauses(np.array([[1, 0, 3]], dtype=np.int32))
+        with pytest.raises(ValueError):
+            solver.add_clauses(np.array([1, 2, 0], dtype=np.int32), np.array([0, 2, 3]))
+        with pytest.raises(ValueError):
+            sat_solver.solve_batch([[[1, 2]], [[3, 0]]])
+        
+        assert solver.get_num_clauses() == 1
+        assert solver.is_satisfiable() == True
+        
     def test_satisfiable_formula(self):
         """Test with a satisfiable formula."""
         solver = sat_solver.SATSolver()
@@ -59,6 +78,24 @@ class TestSATSolver:
         assignment = solver.get_satisfying_assignment()
         assert len(assignment) == 0
         
+    def test_matches_brute_force(self):
+        """Test verdicts and models against exhaustive enumeration on small random formulas."""
+        import itertools
+        import random
+        rng = random.Random(2024)
+        for _ in range(300):
+            n = rng.randint(3, 7)
+            clauses = [[rng.choice([-1, 1]) * v for v in rng.sample(range(1, n + 1), 3)]
+                       for _ in range(rng.randint(1, 6 * n))]
+            expected = any(all(any((l > 0) == bits[abs(l) - 1] for l in c) for c in clauses)
+                           for bits in itertools.product([False, True], repeat=n))
+            
+            solver = sat_solver.create_solver_from_clauses(clauses)
+            assert solver.is_satisfiable() == expected
+            if expected:
+                model = solver.get_satisfying_assignment()
+                assert all(any((l > 0) == model[abs(l) - 1] for l in c) for c in clauses)
+        
     def test_3sat_validation(self):
         """Test 3-SAT validation."""
         solver = sat_solver.SATSolver()
@@ -124,6 +161,181 @@ class TestSATSolverUtils:
         assert solver.get_num_clauses() == 5
         assert solver.is_3sat() == True
         
+    def test_seeded_generation(self):
+        """Test that seeded generation is reproducible and uses distinct variables."""
+        a = sat_solver.utils.generate_random_3sat(10, 40, seed=123)
+        b = sat_solver.utils.generate_random_3sat(10, 40, seed=123)
+        assert np.array_equal(a, b)
+        assert all(len(set(np.abs(clause))) == 3 for clause in a)
+        
+        with pytest.raises(ValueError):
+            sat_solver.utils.generate_random_3sat(2, 5)
+            
+    def test_batch_generation_is_thread_independent(self):
+        """Test that batch output depends only on the seed, not the thread count."""
+        one = sat_solver.utils.generate_uniform_ksat(30, 100, k=4, seed=7, count=64, threads=1)
+        many = sat_solver.utils.generate_uniform_ksat(30, 100, k=4, seed=7, count=64, threads=8)
+        assert one.shape == (64, 100, 4)
+        assert np.array_equal(one, many)
+        assert np.array_equal(one[5], sat_solver.utils.generate_uniform_ksat(30, 100, k=4, seed=7, count=6)[5])
+        
+    def test_planted_generation(self):
+        """Test that planted instances are satisfied by their hidden assignment."""
+        formulas, solutions = sat_solver.utils.generate_planted_ksat(20, 100, seed=3, count=10)
+        assert solutions.shape == (10, 20)
+        for formula, solution in zip(formulas, solutions):
+            values = solution[np.abs(formula) - 1] == 1
+            assert np.all(np.any(values == (formula > 0), axis=1))
+            
+    def test_regular_generation(self):
+        """Test that regular instances use every variable equally often."""
+        formula = sat_solver.utils.generate_regular_ksat(20, 40, seed=11)
+        counts = np.bincount(np.abs(formula).ravel(), minlength=21)[1:]
+        assert counts.min() == counts.max() == 6
+        assert all(len(set(np.abs(clause))) == 3 for clause in formula)
+        
+    def test_regular_generation_tight(self):
+        """Test that clauses keep distinct variables when k is close to num_vars."""
+        for num_vars, num_clauses, k in ((3, 40, 3), (8, 30, 7), (10, 1000, 9)):
+            batch = sat_solver.utils.generate_regular_ksat(num_vars, num_clauses, k=k, seed=1, count=50)
+            variables = np.sort(np.abs(batch), axis=2)
+            assert np.all(variables[:, :, 1:] != variables[:, :, :-1])
+            for formula in batch:
+                counts = np.bincount(np.abs(formula).ravel(), minlength=num_vars + 1)[1:]
+                assert counts.max() - counts.min() <= 1
+        
+    def test_count_models(self):
+        """Test model counting by enumeration."""
+        solver = sat_solver.create_solver_from_clauses([[1, 2], [-1, -2], [3, -3]])
+        assert solver.count_models() == 4
+        assert solver.count_models(limit=3) == 3
+        assert sat_solver.create_solver_from_clauses([[1], [-1]]).count_models() == 0
+        
+    def test_planted_formula_exact(self):
+        """Test that exact planting leaves exactly the planted models."""
+        for quiet in (False, True):
+            literals, offsets, models = sat_solver.utils.generate_planted_formula(
+                12, 30, num_solutions=4, seed=21, quiet=quiet, exact=True)
+            assert models.shape == (4, 12)
+            assert len(np.unique(models, axis=0)) == 4
+            
+            solver = sat_solver.create_solver_from_clauses(literals, offsets)
+            assert solver.get_num_variables() == 12
+            assert solver.count_models() == 4
+            
+    def test_plant_chosen_solutions(self):
+        """Test planting a caller-chosen set of models."""
+        chosen = np.array([[0, 1, 0, 1, 1, 0, 0, 1], [1, 1, 1, 0, 0, 0, 1, 0]], dtype=np.uint8)
+        literals, offsets, models = sat_solver.utils.plant_solutions(chosen, 20, seed=4, exact=True)
+        assert np.array_equal(models, chosen)
+        
+        solver = sat_solver.create_solver_from_clauses(literals, offsets)
+        assert solver.count_models() == 2
+        with pytest.raises(ValueError):
+            sat_solver.utils.plant_solutions(np.vstack([chosen, chosen]), 20)
+        
+    def test_plant_dense_models(self):
+        """Test that planting terminates when almost every assignment is a model."""
+        for num_solutions in (256, 1023):
+            literals, offsets, models = sat_solver.utils.generate_planted_formula(
+                10, 5, num_solutions=num_solutions, seed=6, exact=True)
+            solver = sat_solver.create_solver_from_clauses(literals, offsets)
+            assert solver.count_models() == num_solutions
+        
+        every = (np.arange(8)[:, None] >> np.arange(3)) & 1
+        with pytest.raises(ValueError):
+            sat_solver.utils.plant_solutions(every.astype(np.uint8), 1)
+        
+    def test_are_equivalent(self):
+        """Test exact equivalence on small formulas (exhaustive check)."""
+        f = [[1, 2], [-1, 3]]
+        assert sat_solver.utils.are_equivalent(f, [[-1, 3], [1, 2], [2, 3]]) == True  # adds the resolvent
+        assert sat_solver.utils.are_equivalent(f, [[1, 2]]) == False
+        assert sat_solver.utils.are_equivalent([[1, 2, 3]], [[1, 2, 3, 4]]) == False
+        assert sat_solver.utils.are_equivalent([[1], [-1]], [[2], [-2], [3]]) == True
+        
+    def test_are_equivalent_rejects_invalid_literals(self):
+        """Test that 0 and INT_MIN are rejected in either formula."""
+        with pytest.raises(ValueError):
+            sat_solver.utils.are_equivalent([[1, 0]], [[1]])
+        with pytest.raises(ValueError):
+            sat_solver.utils.are_equivalent([[1]], [[-2**31]])
+        with pytest.raises(ValueError):
+            sat_solver.utils.are_equivalent(np.array([[1, 2, 0]], dtype=np.int32), [[1, 2]])
+        
+    def test_are_equivalent_large(self):
+        """Test exact equivalence beyond the enumeration limit (SAT miter)."""
+        f = sat_solver.utils.generate_random_3sat(40, 120, seed=8)
+        weakened = np.hstack([f[:1], [[40]]])
+        assert sat_solver.utils.are_equivalent(f, np.vstack([f[::-1], f[:5]]), threads=4) == True
+        assert sat_solver.utils.are_equivalent(f.tolist(), f.tolist() + weakened.tolist()) == True
+        assert sat_solver.utils.are_equivalent(f, np.vstack([f, [[41, 41, 41]]])) == False
+        
+    def test_canonicalize(self):
+        """Test that renamed and reordered copies share a canonical form and hash."""
+        f = sat_solver.utils.generate_random_3sat(30, 100, seed=9)
+        perm = np.random.default_rng(3).permutation(30) + 1
+        renamed = np.sign(f) * perm[np.abs(f) - 1]
+        shuffled = renamed[::-1, ::-1].copy()
+        
+        a = sat_solver.utils.canonicalize(f)
+        b = sat_solver.utils.canonicalize(np.vstack([shuffled, shuffled[:4]]))
+        assert a["complete"] and b["complete"]
+        assert a["hash"] == b["hash"] and len(a["hash"]) == 32
+        assert np.array_equal(a["literals"], b["literals"])
+        assert np.array_equal(a["offsets"], b["offsets"])
+        assert a["var_map"][0] == 0 and sorted(a["var_map"][1:]) == list(range(1, 31))
+        
+        flipped = f.copy()
+        flipped[0, 0] = -flipped[0, 0]
+        assert sat_solver.utils.canonicalize(flipped)["hash"] != a["hash"]
+        
+        solver = sat_solver.create_solver_from_clauses(shuffled)
+        assert solver.canonical_hash() == a["hash"]
+        
+    def test_canonicalize_symmetric(self):
+        """Test canonical forms of formulas with many automorphisms."""
+        php = [[1, 2], [3, 4], [5, 6], [-1, -3], [-1, -5], [-3, -5], [-2, -4], [-2, -6], [-4, -6]]
+        relabelled = [[(1 if l > 0 else -1) * (abs(l) % 6 + 1) for l in c][::-1] for c in reversed(php)]
+        a = sat_solver.utils.canonicalize(php)
+        b = sat_solver.utils.canonicalize(relabelled)
+        assert a["complete"] and a["hash"] == b["hash"]
+        
+    def test_canonicalize_disjoint_copies(self):
+        """Test that automorphisms prune the search on disjoint copies of a clause."""
+        import time
+        copies = [[3 * k + 1, -(3 * k + 2), 3 * k + 3] for k in range(8)]
+        relabelled = [[l + 3 if l > 0 else l - 3 for l in c][::-1] for c in copies[:-1]] + [[-2, 1, 3]]
+        start = time.perf_counter()
+        a = sat_solver.utils.canonicalize(copies)
+        elapsed = time.perf_counter() - start
+        b = sat_solver.utils.canonicalize(relabelled)
+        assert a["complete"] and b["complete"]
+        assert a["hash"] == b["hash"]
+        assert elapsed < 0.5
+        
+    def test_binary_cnf_round_trip(self, tmp_path):
+        """Test writing and reading the binary CNF format."""
+        path = str(tmp_path / "formula.bcnf")
+        formula = sat_solver.utils.generate_random_3sat(8, 30, seed=5)
+        sat_solver.utils.write_binary_cnf(path, formula)
+        literals, offsets, num_vars = sat_solver.utils.read_binary_cnf(path)
+        
+        assert num_vars == np.abs(formula).max()
+        assert np.array_equal(literals, formula.ravel())
+        assert list(offsets[:3]) == [0, 3, 6]
+        
+        with pytest.raises(RuntimeError):
+            sat_solver.utils.read_binary_cnf(str(tmp_path / "missing.bcnf"))
+        
+        # A header claiming more clauses than the file holds is rejected before allocating
+        data = bytearray(open(path, "rb").read())
+        data[12:20] = (1 << 60).to_bytes(8, "little")
+        forged = tmp_path / "forged.bcnf"
+        forged.write_bytes(bytes(data))
+        with pytest.raises(RuntimeError):
+            sat_solver.utils.read_binary_cnf(str(forged))
+        
     def test_create_solver_from_clauses(self):
         """Test convenience function for creating solver from clauses."""
         clauses = [[1, 2, 3], [-1, 2, -3], [1, -2, 3]]
@@ -133,6 +345,563 @@ class TestSATSolverUtils:
         assert solver.get_num_variables() == 3
         assert solver.is_3sat() == True
 
+@pytest.mark.skipif(not SAT_SOLVER_AVAILABLE, reason="SAT solver C++ library not compiled")
+class TestSATSolverNumpy:
+    """Test bulk clause ingestion and numpy outputs."""
+    
+    def test_add_clauses_from_array(self):
+        """Test adding an (m x 3) array of clauses in one call."""
+        solver = sat_solver.SATSolver()
+        solver.add_clauses(np.array([[1, 2, 3], [-1, 2, -3]], dtype=np.int32))
+        solver.add_clauses(np.array([[1, -2, 4]], dtype=np.int64))
+        
+        assert solver.get_num_clauses() == 3
+        assert solver.get_num_variables() == 4
+        assert solver.is_3sat() == True
+        
+    def test_add_clauses_from_csr(self):
+        """Test adding variable-width clauses as a CSR pair."""
+        solver = sat_solver.SATSolver()
+        literals = np.array([1, 2, -1, 3, -2, -3], dtype=np.int32)
+        offsets = np.array([0, 2, 3, 6], dtype=np.int64)
+        solver.add_clauses(literals, offsets)
+        
+        assert solver.get_num_clauses() == 3
+        assert solver.get_num_variables() == 3
+        assert solver.is_3sat() == False
+        
+        lits, offs = solver.get_clauses()
+        assert np.array_equal(lits, literals)
+        assert np.array_equal(offs, offsets)
+        
+    def test_add_clauses_rejects_bad_offsets(self):
+        """Test that malformed CSR input is rejected."""
+        solver = sat_solver.SATSolver()
+        with pytest.raises(ValueError):
+            solver.add_clauses(np.array([1, 2, 3], dtype=np.int32), np.array([0, 2, 1, 3]))
+        with pytest.raises(ValueError):
+            solver.add_clauses(np.array([1, 2, 3], dtype=np.int32), np.array([0, 4]))
+        assert solver.get_num_clauses() == 0
+        
+    def test_numpy_outputs(self):
+        """Test that generators and models come back as numpy arrays."""
+        formula = sat_solver.utils.generate_random_3sat(4, 6)
+        assert isinstance(formula, np.ndarray)
+        assert formula.shape == (6, 3)
+        assert np.all(np.abs(formula) >= 1) and np.all(np.abs(formula) <= 4)
+        
+        solver = sat_solver.create_solver_from_clauses(np.array([[1, 2, 3]]))
+        assignment = solver.get_satisfying_assignment()
+        assert isinstance(assignment, np.ndarray)
+        assert assignment.dtype == np.bool_
+        assert assignment.shape == (3,)
+
+@pytest.mark.skipif(not SAT_SOLVER_AVAILABLE, reason="SAT solver C++ library not compiled")
+class TestSATSolverAsync:
+    """Test GIL-releasing and background solve calls."""
+    
+    def test_solve_result(self):
+        """Test the synchronous solve() result object."""
+        solver = sat_solver.create_solver_from_clauses([[1, 2, 3]])
+        result = solver.solve()
+        assert result.satisfiable == True
+        assert bool(result) == True
+        assert result.assignment.shape == (3,)
+        
+    def test_solve_async(self):
+        """Test solving several formulas concurrently through futures."""
+        sat = sat_solver.create_solver_from_clauses([[1, 2, 3], [-1, 2, -3]])
+        unsat = sat_solver.create_solver_from_clauses([[1, 1, 1], [-1, -1, -1]])
+        futures = [s.solve_async() for s in (sat, unsat, sat, unsat)]
+        
+        results = [f.result(timeout=30) for f in futures]
+        assert [r.satisfiable for r in results] == [True, False, True, False]
+        assert len(results[1].assignment) == 0
+        
+    def test_solve_async_snapshots_formula(self):
+        """Test that later edits do not affect an already submitted solve."""
+        solver = sat_solver.create_solver_from_clauses([[1, 2, 3]])
+        future = solver.solve_async()
+        solver.add_clauses([[1, 1, 1], [-1, -1, -1]])
+        assert future.result(timeout=30).satisfiable == True
+        
+    def test_shared_solver_threads(self):
+        """Test that threads sharing one solver are serialised instead of racing."""
+        import threading
+        
+        formula = sat_solver.utils.generate_random_3sat(60, 240, seed=12)
+        solver = sat_solver.create_solver_from_clauses(formula)
+        expected = solver.is_satisfiable()
+        errors = []
+        
+        def worker(offset):
+            try:
+                for i in range(20):
+                    result = solver.solve()
+                    assert result.satisfiable == expected
+                    solver.add_clause(formula[(offset + i) % len(formula)].tolist())
+                    solver.get_satisfying_assignment()
+                    solver.get_stats()
+            except Exception as e:
+                errors.append(e)
+        
+        threads = [threading.Thread(target=worker, args=(t,)) for t in range(4)]
+        for t in threads:
+            t.start()
+        for t in threads:
+            t.join()
+        assert errors == []
+        assert solver.get_num_clauses() == 240 + 4 * 20
+        assert solver.is_satisfiable() == expected
+        
+    def test_solve_async_cancel(self):
+        """Test that queued solves can be cancelled."""
+        solver = sat_solver.create_solver_from_clauses([[1, 2, 3]])
+        futures = [solver.solve_async() for _ in range(64)]
+        for f in futures:
+            f.cancel()
+        for f in futures:
+            assert f.cancelled() or f.result(timeout=30).satisfiable
+            
+    def test_solve_async_asyncio(self):
+        """Test awaiting a solve from asyncio."""
+        import asyncio
+        
+        async def run():
+            solver = sat_solver.create_solver_from_clauses([[1, -2, 3]])
+            return await asyncio.wrap_future(solver.solve_async())
+        
+        assert asyncio.run(run()).satisfiable == True
+        
+    def test_solve_async_at_exit(self):
+        """Test that interpreter exit stops running solves and resolves every future."""
+        import subprocess
+        script = """if True:
+            import atexit, sys
+            sys.path.insert(0, %r)
+            import sat_solver
+            holes = 12
+            var = lambda p, h: p * holes + h + 1
+            clauses = [[var(p, h) for h in range(holes)] for p in range(holes + 1)]
+            clauses += [[-var(p, h), -var(q, h)] for h in range(holes)
+                        for p in range(holes + 1) for q in range(p + 1, holes + 1)]
+            solver = sat_solver.create_solver_from_clauses(clauses)
+            futures = [solver.solve_async() for _ in range(64)]
+            atexit._run_exitfuncs()
+            late = solver.solve_async()
+            assert all(f.done() for f in futures)
+            assert all(f.cancelled() or f.result().status == sat_solver.SolveStatus.UNKNOWN for f in futures)
+            assert late.cancelled()
+        """ % os.path.dirname(os.path.abspath(sat_solver.__file__))
+        subprocess.run([sys.executable, "-c", script], check=True, timeout=60)
+        
+    def test_solve_async_after_fork(self):
+        """Test that a forked child gets a working pool of its own."""
+        import multiprocessing
+        assert sat_solver.create_solver_from_clauses([[1]]).solve_async().result(timeout=30)
+        with multiprocessing.get_context("fork").Pool(1) as pool:
+            assert pool.apply(solve_async_in_child)
+
+def solve_async_in_child():
+    """Worker for the fork test: solve on the shared pool of a forked process."""
+    solver = sat_solver.create_solver_from_clauses([[1, 2], [-1]])
+    return solver.solve_async().result(timeout=30).satisfiable
+
+@pytest.mark.skipif(not SAT_SOLVER_AVAILABLE, reason="SAT solver C++ library not compiled")
+class TestSATSolverBatch:
+    """Test the batched multi-formula solve API."""
+    
+    def test_solve_batch_lists(self):
+        """Test a batch given as a list of formulas."""
+        formulas = [[[1, 2, 3]], [[1, 1, 1], [-1, -1, -1]], np.array([[1, -2, 3], [2, 3, 4]])]
+        result = sat_solver.solve_batch(formulas, threads=2)
+        
+        assert len(result) == 3
+        assert list(result.status) == [1, 0, 1]
+        assert list(result.model_offsets) == [0, 3, 3, 7]
+        assert result.model(0).shape == (3,)
+        assert result.model(1).shape == (0,)
+        
+    def test_solve_batch_array(self):
+        """Test a uniform batch given as an (F x m x k) array."""
+        batch = np.array([[[1, 2, 3], [-1, 2, 3]]] * 50 + [[[1, 1, 1], [-1, -1, -1]]] * 50)
+        result = sat_solver.solve_batch(batch, threads=4)
+        
+        assert result.status.dtype == np.int8
+        assert result.status.sum() == 50
+        assert np.all(result.status[:50] == 1) and np.all(result.status[50:] == 0)
+        
+    def test_solve_batch_csr(self):
+        """Test a batch given as a CSR triple."""
+        literals = np.array([1, 2, 3, 1, 1, 1, -1, -1, -1, 2, -3], dtype=np.int32)
+        clause_offsets = np.array([0, 3, 6, 9, 11])
+        formula_offsets = np.array([0, 1, 3, 4])
+        result = sat_solver.solve_batch((literals, clause_offsets, formula_offsets))
+        
+        assert list(result.status) == [1, 0, 1]
+        with pytest.raises(ValueError):
+            sat_solver.solve_batch((literals, clause_offsets, np.array([0, 1, 5])))
+
+@pytest.mark.skipif(not SAT_SOLVER_AVAILABLE, reason="SAT solver C++ library not compiled")
+class TestSATSolverStats:
+    """Test solver statistics reporting."""
+    
+    STAT_KEYS = {"decisions", "propagations", "conflicts", "restarts", "learned_clauses",
+                 "deleted_clauses", "arena_bytes", "propagate_seconds", "analyze_seconds",
+                 "reduce_seconds", "total_seconds"}
+    
+    def pigeonhole(self, holes):
+        """Build the unsatisfiable pigeonhole formula for holes + 1 pigeons."""
+        var = lambda p, h: p * holes + h + 1
+        clauses = [[var(p, h) for h in range(holes)] for p in range(holes + 1)]
+        for h in range(holes):
+            for p in range(holes + 1):
+                for q in range(p + 1, holes + 1):
+                    clauses.append([-var(p, h), -var(q, h)])
+        return clauses
+    
+    def test_stats_dict(self):
+        """Test that stats are reported as a dict after solving."""
+        solver = sat_solver.create_solver_from_clauses(self.pigeonhole(5))
+        result = solver.solve()
+        stats = solver.get_stats()
+        
+        assert result.satisfiable == False
+        assert set(stats) == self.STAT_KEYS
+        assert result.stats == stats
+        if sat_solver.STATS_ENABLED:
+            assert stats["conflicts"] > 0
+            assert stats["learned_clauses"] > 0
+            assert stats["arena_bytes"] > 0
+            assert stats["total_seconds"] >= stats["propagate_seconds"]
+        
+    def test_stats_reset_on_clear(self):
+        """Test that clearing the solver resets the statistics."""
+        solver = sat_solver.create_solver_from_clauses(self.pigeonhole(4))
+        solver.is_satisfiable()
+        solver.clear()
+        assert all(value == 0 for value in solver.get_stats().values())
+        
+    def test_stats_comments(self):
+        """Test the DIMACS comment rendering of the statistics."""
+        solver = sat_solver.create_solver_from_clauses([[1, 2, 3], [-1, -2, 3]])
+        solver.solve()
+        lines = solver.get_stats_comments()
+        
+        assert len(lines) == len(self.STAT_KEYS)
+        assert all(line.startswith("c stats ") and line.endswith("\n") for line in lines)
+        assert "c stats decisions: %d\n" % solver.get_stats()["decisions"] in lines
+        
+    def test_batch_stats(self):
+        """Test per-formula statistics of a batch solve."""
+        result = sat_solver.solve_batch([[[1, 2, 3]], self.pigeonhole(4)], threads=2)
+        assert len(result.stats) == 2
+        assert set(result.stats[1]) == self.STAT_KEYS
+        if sat_solver.STATS_ENABLED:
+            assert result.stats[1]["conflicts"] > 0
+
+@pytest.mark.skipif(not SAT_SOLVER_AVAILABLE, reason="SAT solver C++ library not compiled")
+class TestSATSolverLimits:
+    """Test solve budgets and cooperative cancellation."""
+    
+    def hard_solver(self):
+        """Pigeonhole formula with 9 pigeons and 8 holes: unsatisfiable and slow to refute."""
+        return sat_solver.create_solver_from_clauses(TestSATSolverStats().pigeonhole(8))
+    
+    def test_conflict_budget(self):
+        """Test that running out of conflicts yields UNKNOWN."""
+        result = self.hard_solver().solve(max_conflicts=10)
+        assert result.status == sat_solver.SolveStatus.UNKNOWN
+        assert result.satisfiable == False
+        assert len(result.assignment) == 0
+        if sat_solver.STATS_ENABLED:
+            assert result.stats["conflicts"] == 10
+        
+    def test_propagation_and_time_budget(self):
+        """Test the propagation and wall-time budgets."""
+        solver = self.hard_solver()
+        assert solver.solve(max_propagations=100).status == sat_solver.SolveStatus.UNKNOWN
+        assert solver.solve(max_seconds=0.05).status == sat_solver.SolveStatus.UNKNOWN
+        
+    def test_budget_not_reached(self):
+        """Test that easy formulas finish normally under a budget."""
+        solver = sat_solver.create_solver_from_clauses([[1, 2, 3], [-1, -2, 3]])
+        result = solver.solve(max_conflicts=1000, max_seconds=10.0)
+        assert result.status == sat_solver.SolveStatus.SAT
+        assert solver.is_satisfiable() == True
+        
+    def test_cancel_token(self):
+        """Test cancelling a running background solve."""
+        token = sat_solver.CancelToken()
+        future = self.hard_solver().solve_async(cancel=token)
+        token.cancel()
+        assert token.cancelled
+        assert future.result(timeout=30).status == sat_solver.SolveStatus.UNKNOWN
+        
+        token.reset()
+        easy = sat_solver.create_solver_from_clauses([[1, 2, 3]])
+        assert easy.solve(cancel=token).status == sat_solver.SolveStatus.SAT
+        
+    def test_batch_budget(self):
+        """Test that a budget in a batch only marks the hard formula UNKNOWN."""
+        formulas = [[[1, 2, 3]], [[1, 1, 1], [-1, -1, -1]], TestSATSolverStats().pigeonhole(8)]
+        result = sat_solver.solve_batch(formulas, threads=2, max_conflicts=10)
+        assert list(result.status) == [1, 0, -1]
+
+@pytest.mark.skipif(not SAT_SOLVER_AVAILABLE, reason="SAT solver C++ library not compiled")
+class TestSATSolverModes:
+    """Test the lookahead and cube-and-conquer engines."""
+    
+    MODES = ["CDCL", "LOOKAHEAD", "CUBE_AND_CONQUER"]
+    
+    def test_modes_agree(self):
+        """Test that every engine reaches the same verdict with valid models."""
+        formulas = [sat_solver.utils.generate_random_3sat(60, 256, seed=s) for s in range(6)]
+        formulas.append(TestSATSolverStats().pigeonhole(5))
+        for formula in formulas:
+            verdicts = set()
+            for name in self.MODES:
+                solver = sat_solver.create_solver_from_clauses(formula)
+                solver.set_mode(getattr(sat_solver.SolverMode, name), threads=2)
+                assert solver.get_mode() == getattr(sat_solver.SolverMode, name)
+                result = solver.solve()
+                verdicts.add(result.status)
+                if result.satisfiable:
+                    model = result.assignment
+                    assert all(any(model[abs(l) - 1] == (l > 0) for l in clause) for clause in formula)
+            assert len(verdicts) == 1
+            
+    def test_lookahead_budget(self):
+        """Test that the lookahead engine honours budgets and cancellation."""
+        solver = sat_solver.create_solver_from_clauses(sat_solver.utils.generate_random_3sat(400, 1704, seed=1))
+        solver.set_mode(sat_solver.SolverMode.LOOKAHEAD)
+        assert solver.solve(max_seconds=0.05).status == sat_solver.SolveStatus.UNKNOWN
+        
+        token = sat_solver.CancelToken()
+        token.cancel()
+        solver.set_mode(sat_solver.SolverMode.CUBE_AND_CONQUER, threads=2)
+        assert solver.solve(cancel=token).status == sat_solver.SolveStatus.UNKNOWN
+        
+    def test_generate_cubes(self):
+        """Test that the cubes cover every model of the formula."""
+        formula = sat_solver.utils.generate_random_3sat(50, 200, seed=4)
+        solver = sat_solver.create_solver_from_clauses(formula)
+        status, cubes = solver.generate_cubes(2)
+        if status == sat_solver.SolveStatus.UNKNOWN:
+            assert 0 < len(cubes) <= 4
+            total = 0
+            for cube in cubes:
+                sub = sat_solver.create_solver_from_clauses(formula.tolist() + [[l] for l in cube])
+                total += sub.count_models()
+            assert total == solver.count_models()
+        
+        status, cubes = sat_solver.create_solver_from_clauses([[1], [-1, 2], [-2]]).generate_cubes(3)
+        assert status == sat_solver.SolveStatus.UNSAT and cubes == []
+
+@pytest.mark.skipif(not SAT_SOLVER_AVAILABLE, reason="SAT solver C++ library not compiled")
+class TestSATSolverCache:
+    """Test the persistent result cache."""
+    
+    def test_solve_hits_on_isomorphic_formula(self, tmp_path):
+        """Test that a renamed, reordered copy is answered from the cache."""
+        cache = sat_solver.ResultCache(str(tmp_path / "results.cache"))
+        formula = sat_solver.utils.generate_random_3sat(40, 150, seed=11)
+        
+        first = sat_solver.create_solver_from_clauses(formula)
+        first.set_cache(cache)
+        result = first.solve()
+        assert result.satisfiable and not result.cached
+        assert len(cache) == 1
+        
+        renamed = (41 - np.abs(formula)) * np.sign(formula)
+        second = sat_solver.create_solver_from_clauses(renamed[::-1].copy())
+        second.set_cache(cache)
+        hit = second.solve()
+        assert hit.cached and hit.satisfiable
+        model = hit.assignment
+        assert all(any(model[abs(l) - 1] == (l > 0) for l in clause) for clause in renamed)
+        assert hit.stats == result.stats
+        
+        second.set_cache(None)
+        assert second.get_cache() is None
+        assert not second.solve().cached
+        
+    def test_budget_results_not_cached(self, tmp_path):
+        """Test that UNKNOWN verdicts are not stored."""
+        cache = sat_solver.ResultCache(str(tmp_path / "results.cache"))
+        solver = sat_solver.create_solver_from_clauses(TestSATSolverStats().pigeonhole(8))
+        solver.set_cache(cache)
+        assert solver.solve(max_conflicts=10).status == sat_solver.SolveStatus.UNKNOWN
+        assert len(cache) == 0
+        
+    def test_model_counts_persist(self, tmp_path):
+        """Test that model counts survive reopening the cache file."""
+        path = str(tmp_path / "results.cache")
+        solver = sat_solver.create_solver_from_clauses([[1, 2], [-1, 5]])
+        solver.set_cache(sat_solver.ResultCache(path))
+        assert solver.count_models() == 16
+        
+        reopened = sat_solver.create_solver_from_clauses([[3, 1], [-3, 2]])
+        reopened.set_cache(sat_solver.ResultCache(path))
+        assert len(reopened.get_cache()) == 1
+        assert reopened.count_models() == 4
+        assert reopened.count_models(limit=3) == 3
+        
+    def test_rejects_foreign_file(self, tmp_path):
+        """Test that a file that is not a cache is refused."""
+        path = tmp_path / "not_a_cache"
+        path.write_bytes(b"hello world, not a cache")
+        with pytest.raises(RuntimeError):
+            sat_solver.ResultCache(str(path))
+
+@pytest.mark.skipif(not SAT_SOLVER_AVAILABLE, reason="SAT solver C++ library not compiled")
+class TestSATSolverCheckpoint:
+    """Test checkpointing and resuming interrupted solves."""
+    
+    def test_resume_from_checkpoint(self, tmp_path):
+        """Test that an interrupted solve can be restored and finished elsewhere."""
+        path = str(tmp_path / "solver.ckpt")
+        solver = sat_solver.create_solver_from_clauses(TestSATSolverStats().pigeonhole(7))
+        assert solver.solve(max_conflicts=500).status == sat_solver.SolveStatus.UNKNOWN
+        solver.checkpoint(path)
+        
+        restored = sat_solver.SATSolver()
+        restored.restore(path)
+        assert restored.get_num_variables() == solver.get_num_variables()
+        assert restored.get_num_clauses() == solver.get_num_clauses()
+        assert restored.get_formula() == solver.get_formula()
+        result = restored.solve()
+        assert result.status == sat_solver.SolveStatus.UNSAT
+        
+    def test_resume_in_place(self):
+        """Test that repeated budgeted solves continue the same search."""
+        solver = sat_solver.create_solver_from_clauses(TestSATSolverStats().pigeonhole(6))
+        result = solver.solve(max_conflicts=50)
+        runs = 1
+        while result.status == sat_solver.SolveStatus.UNKNOWN:
+            result = solver.solve(max_conflicts=50)
+            runs += 1
+        assert result.status == sat_solver.SolveStatus.UNSAT
+        assert runs > 1
+        
+    def test_clauses_added_after_checkpoint(self, tmp_path):
+        """Test that clauses added to a restored solver are taken into account."""
+        path = str(tmp_path / "solver.ckpt")
+        formula = sat_solver.utils.generate_random_3sat(60, 255, seed=3)
+        solver = sat_solver.create_solver_from_clauses(formula)
+        solver.solve(max_conflicts=1)
+        solver.checkpoint(path)
+        
+        restored = sat_solver.SATSolver()
+        restored.restore(path)
+        restored.add_clause([1])
+        restored.add_clause([-1])
+        assert restored.solve().status == sat_solver.SolveStatus.UNSAT
+        
+    def test_checkpoint_on_signal(self, tmp_path):
+        """Test that a handled signal stops armed solves and writes a checkpoint."""
+        import signal
+        path = tmp_path / "signal.ckpt"
+        solver = sat_solver.create_solver_from_clauses(TestSATSolverStats().pigeonhole(6))
+        solver.checkpoint_on_signal(str(path), signal.SIGUSR1)
+        try:
+            os.kill(os.getpid(), signal.SIGUSR1)
+            assert sat_solver.SATSolver.checkpoint_signal_pending()
+            assert solver.solve().status == sat_solver.SolveStatus.UNKNOWN
+            assert path.exists()
+        finally:
+            sat_solver.SATSolver.reset_checkpoint_signal()
+            solver.checkpoint_on_signal("")
+        assert solver.solve().status == sat_solver.SolveStatus.UNSAT
+        
+    def test_rejects_foreign_file(self, tmp_path):
+        """Test that a file that is not a checkpoint is refused."""
+        path = tmp_path / "not_a_checkpoint"
+        path.write_bytes(b"SCKP but not really")
+        solver = sat_solver.create_solver_from_clauses([[1, 2]])
+        with pytest.raises(RuntimeError):
+            solver.restore(str(path))
+        assert solver.get_num_clauses() == 1
+        
+    def test_rejects_mismatched_engine_state(self, tmp_path):
+        """Test that an engine state that does not belong to the formula is refused."""
+        import struct
+        path = tmp_path / "solver.ckpt"
+        solver = sat_solver.create_solver_from_clauses(TestSATSolverStats().pigeonhole(6))
+        assert solver.solve(max_conflicts=100).status == sat_solver.SolveStatus.UNKNOWN
+        solver.checkpoint(str(path))
+        data = path.read_bytes()
+        
+        # Header: magic, version, variables, clauses, literals; then offsets and literals
+        num_vars, num_clauses, num_literals = struct.unpack_from("=IQQ", data, 8)
+        first_literal = 28 + 8 * (num_clauses + 1)
+        engine_clauses = first_literal + 4 * num_literals
+        tampered = [
+            data[:8] + struct.pack("=I", num_vars - 1) + data[12:],
+            data[:first_literal] + struct.pack("=i", -data[first_literal]) + data[first_literal + 4:],
+            data[:engine_clauses] + struct.pack("=Q", num_clauses - 1) + data[engine_clauses + 8:],
+        ]
+        for corrupt in tampered:
+            path.write_bytes(corrupt)
+            with pytest.raises(RuntimeError, match="Corrupt engine state"):
+                sat_solver.SATSolver().restore(str(path))
+
+def solve_shared(shared):
+    """Worker for the multiprocessing test: solve a formula attached by name."""
+    return shared.to_solver().solve().status == sat_solver.SolveStatus.SAT
+
+@pytest.mark.skipif(not SAT_SOLVER_AVAILABLE, reason="SAT solver C++ library not compiled")
+class TestSATSolverPickle:
+    """Test pickling and shared-memory formulas."""
+    
+    def test_pickle_round_trip(self):
+        """Test that a pickled solver keeps its formula and mode."""
+        import pickle
+        solver = sat_solver.create_solver_from_clauses(sat_solver.utils.generate_random_3sat(50, 200, seed=8))
+        solver.set_mode(sat_solver.SolverMode.LOOKAHEAD)
+        copy = pickle.loads(pickle.dumps(solver))
+        assert copy.get_formula() == solver.get_formula()
+        assert copy.get_mode() == sat_solver.SolverMode.LOOKAHEAD
+        assert copy.solve().status == solver.solve().status
+        
+    def test_pickle_keeps_interrupted_search(self):
+        """Test that a solver pickled after running out of budget resumes its search."""
+        import pickle
+        solver = sat_solver.create_solver_from_clauses(TestSATSolverStats().pigeonhole(6))
+        assert solver.solve(max_conflicts=100).status == sat_solver.SolveStatus.UNKNOWN
+        copy = pickle.loads(pickle.dumps(solver))
+        assert copy.solve().status == sat_solver.SolveStatus.UNSAT
+        
+    def test_shared_formula(self):
+        """Test that a shared formula pickles by name and maps read-only."""
+        import pickle
+        solver = sat_solver.create_solver_from_clauses([[1, -2, 3], [-1, 2], [4]])
+        shared = solver.share()
+        assert shared.owner
+        assert len(pickle.dumps(shared)) < 100
+        
+        attached = pickle.loads(pickle.dumps(shared))
+        assert not attached.owner and attached.name == shared.name
+        literals, offsets = attached.get_clauses()
+        assert literals.tolist() == [1, -2, 3, -1, 2, 4]
+        assert offsets.tolist() == [0, 3, 5, 6]
+        with pytest.raises(ValueError):
+            literals[0] = 5
+        assert attached.to_solver().get_formula() == solver.get_formula()
+        
+    def test_shared_formula_in_workers(self):
+        """Test that worker processes solve a formula they attach to."""
+        import multiprocessing
+        formula = sat_solver.utils.generate_planted_ksat(80, 300, seed=9)[0]
+        shared = sat_solver.SharedFormula(sat_solver.create_solver_from_clauses(formula))
+        with multiprocessing.get_context("fork").Pool(2) as pool:
+            assert all(pool.map(solve_shared, [shared] * 4))
+        
+    def test_attach_missing(self):
+        """Test that attaching to an unknown name fails."""
+        with pytest.raises(RuntimeError):
+            sat_solver.SharedFormula.attach("/sat_solver_does_not_exist")
+
 @pytest.mark.skipif(not SAT_SOLVER_AVAILABLE, reason="SAT solver C++ library not compiled")
 class TestSATSolverIntegration:
     """Integration tests combining quantum and classical SAT solving."""